@@ -8,10 +8,17 @@ return {
     romfs = true,
     shell = { advanced = true },
     term = { lines = 25, cols = 80 },
-    mmcfs = { spi = 0, cs_port = 0, cs_pin = 0 },
+    mmcfs = { spi = 0, cs_port = 0, cs_pin = 0, cache_sectors = 8 },
+    cints = true,
+    luaints = true,
+    luaprof = true,
+    reqcache = true
+  },
+  config = {
+    vtmr = { num = 4, freq = 10 }
   },
   modules = {
-    generic = { 'pd', 'all_lua', 'term', 'elua' }
+    generic = { 'pd', 'all_lua', 'term', 'elua', 'sched', 'tmr', 'cpu' }
   }
 }
 
@@ -115,13 +115,14 @@ local function check_cmdline_vs_conf( argname, comp, bd )
   end
 end
 
-builder:add_option( 'target', 'build "regular" float lua, 32 bit integer-only "lualong" or 64-bit integer only lua "lualonglong"', 'lua', { 'lua', 'lualong', 'lualonglong' } )
+builder:add_option( 'target', 'build "regular" float lua, 32 bit integer-only "lualong", 64-bit integer only lua "lualonglong" or float lua with an integer subtype "luadual"', 'lua', { 'lua', 'lualong', 'lualonglong', 'luadual' } )
 builder:add_option( 'allocator', 'select memory allocator', 'auto', { 'newlib', 'multiple', 'simple', 'auto' } )
 builder:add_option( 'board', 'selects board for target (cpu will be inferred)', nil, board_list )
 builder:add_option( 'toolchain', 'specifies toolchain to use (auto=search for usable toolchain)', 'auto', { bd.get_all_toolchains(), 'auto' } )
 builder:add_option( 'optram', 'enables Lua Tiny RAM enhancements', true )
 builder:add_option( 'boot', 'boot mode, standard will boot to shell, luarpc boots to an rpc server', 'standard', { 'standard' , 'luarpc' } )
 builder:add_option( 'romfs', 'ROMFS compilation mode', 'verbatim', { 'verbatim' , 'compress', 'compile' } )
+builder:add_option( 'romfs_opt', 'optimize the bytecode in the "compile" ROMFS compilation mode', false )
 builder:add_option( 'cpumode', 'ARM CPU compilation mode (only affects certain ARM targets)', nil, { 'arm', 'thumb' } )
 builder:add_option( 'bootloader', 'Build for bootloader usage (AVR32 only)', 'none', { 'none', 'emblod' } )
 builder:add_option( 'debug', 'Enable debug build', false )
@@ -267,7 +268,9 @@ if comp.romfs == 'compile' then
     print "Build it by running 'lua cross-lua.lua'"
     os.exit( -1 )
   end
-  local cmdpath = { lfs.currentdir(), sf( 'luac.cross%s -ccn %s -cce %s -o %%s -s %%s', suffix, toolset[ "cross_" .. comp.target:lower() ], toolset.cross_cpumode:lower() ) }
+  -- 'luadual' uses the same bytecode format as 'lua'
+  local crosstarget = comp.target == 'luadual' and 'lua' or comp.target:lower()
+  local cmdpath = { lfs.currentdir(), sf( 'luac.cross%s -ccn %s -cce %s%s -o %%s -s %%s', suffix, toolset[ "cross_" .. crosstarget ], toolset.cross_cpumode:lower(), comp.romfs_opt and ' -O' or '' ) }
   dprint( "Cross compile command: " .. cmdpath[ 2 ] )
   fscompcmd = table.concat( cmdpath, utils.dir_sep )
 elseif comp.romfs == 'compress' then
@@ -347,14 +350,15 @@ end
 if comp.boot == 'luarpc' then addm( "ELUA_BOOT_RPC" ) end
 if comp.target == 'lualong' or comp.target == 'lualonglong' then addm( "LUA_NUMBER_INTEGRAL" ) end
 if comp.target == 'lualonglong' then addm( "LUA_INTEGRAL_LONGLONG" ) end
-if comp.target ~= 'lualong' and comp.target ~= "lualonglong" then addm( "LUA_PACK_VALUE" ) end
+if comp.target == 'luadual' then addm( "LUA_NUMBER_DUAL" ) end
+if comp.target == 'lua' then addm( "LUA_PACK_VALUE" ) end
 if bd.get_endianness_of_platform( platform ) == "big" then addm( "ELUA_ENDIAN_BIG" ) else addm( "ELUA_ENDIAN_LITTLE" ) end
 
 -- Special macro definitions for the SIM target
 if platform == 'sim' then addm( { "ELUA_SIMULATOR", "ELUA_SIM_" .. cnorm( comp.cpu ) } ) end
 
 -- Lua source files and include path
-exclude_patterns = { "^src/platform", "^src/uip", "^src/serial", "^src/luarpc_desktop_serial.c", "^src/linenoise_posix.c", "^src/lua/print.c", "^src/lua/luac.c" }
+exclude_patterns = { "^src/platform", "^src/uip", "^src/serial", "^src/luarpc_desktop_serial.c", "^src/linenoise_posix.c", "^src/lua/print.c", "^src/lua/luac.c", "^src/lua/lopt.c" }
 local source_files = utils.get_files( "src", function( fname )
   fname = fname:gsub( "\\", "/" )
   local include = fname:find( ".*%.c$" )
@@ -22,7 +22,7 @@ function validate( desc, platform )
   local res, err = validate_one( bd.allocator, 'allocator', { 'newlib', 'multiple', 'simple' } )
   if not res then return nil, err end
   -- Check target
-  res, err = validate_one( bd.target, 'target', { 'lua', 'lualong', 'lualonglong' } )
+  res, err = validate_one( bd.target, 'target', { 'lua', 'lualong', 'lualonglong', 'luadual' } )
   if not res then return nil, err end
   -- Check optram
   if bd.optram then
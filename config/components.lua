@@ -32,9 +32,9 @@ local function mmcfs_auxcheck( eldesc, data, enabled )
   return true
 end
 
-local function mmcfs_gen( eldesc, data, generated )
-  local ports, pins, spis = data.MMCFS_CS_PORT.value, data.MMCFS_CS_PIN.value, data.MMCFS_SPI_NUM.value
-  local data = ''
+local function mmcfs_gen( eldesc, conf, generated )
+  local ports, pins, spis = conf.MMCFS_CS_PORT.value, conf.MMCFS_CS_PIN.value, conf.MMCFS_SPI_NUM.value
+  local data = gen.simple_gen( 'MMCFS_MAX_FDS', conf, generated ) .. gen.simple_gen( 'MMCFS_CACHE_SECTORS', conf, generated )
   if #ports == 1 then -- single card
     data = data .. gen.print_define( 'MMCFS_CS_PORT', ports[ 1 ] )
     data = data .. gen.print_define( 'MMCFS_CS_PIN', pins[ 1 ] )
@@ -97,7 +97,8 @@ function init()
       speed = at.int_attr( 'CON_UART_SPEED' ),
       timer = at.timer_attr( 'CON_TIMER_ID' ),
       flow = at.flow_control_attr( 'CON_FLOW_TYPE' ),
-      buf_size = at.make_optional( at.int_log2_attr( 'CON_BUF_SIZE' ) )
+      buf_size = at.make_optional( at.int_log2_attr( 'CON_BUF_SIZE' ) ),
+      tx_buf_size = at.make_optional( at.int_attr( 'STD_TX_BUF_SIZE', 0, 32768 ) )
     }
   }
   -- TCP/IP console
@@ -149,6 +150,10 @@ function init()
     },
     needs = 'cints'
   }
+  -- Lua VM profiler
+  components.luaprof = { macro = 'BUILD_LUA_PROFILER' }
+  -- Cache for the 'require' file searches
+  components.reqcache = { macro = 'BUILD_REQUIRE_CACHE' }
   -- Linenoise
   components.linenoise = {
     macro = 'BUILD_LINENOISE',
@@ -178,7 +183,9 @@ function init()
     attrs = {
       cs_port = at.array_of( at.int_attr( 'MMCFS_CS_PORT' ), true ),
       cs_pin = at.array_of( at.int_attr( 'MMCFS_CS_PIN' ), true ),
-      spi = at.array_of( at.int_attr( 'MMCFS_SPI_NUM' ), true )
+      spi = at.array_of( at.int_attr( 'MMCFS_SPI_NUM' ), true ),
+      max_fds = at.make_optional( at.int_attr( 'MMCFS_MAX_FDS', 1, 256 ) ),
+      cache_sectors = at.make_optional( at.int_attr( 'MMCFS_CACHE_SECTORS', 0, 256 ) )
     }
   }
   -- RPC
@@ -134,6 +134,10 @@ local sanity_code = [[
   #ifndef INT_TMR_MATCH
   #define INT_TMR_MATCH         ELUA_INT_INVALID_INTERRUPT
   #endif
+
+  #ifndef INT_ADC_READY
+  #define INT_ADC_READY         ELUA_INT_INVALID_INTERRUPT
+  #endif
 #endif // #if defined( BUILD_LUA_INT_HANDLERS ) || defined( BUILD_C_INT_HANDLERS )
 
 #ifndef VTMR_NUM_TIMERS
@@ -31,6 +31,7 @@ local elua_generic_modules = {
   i2c = { guards = { "NUM_I2C > 0" } },
   pack = {}, 
   rpc = { guards = { "BUILD_RPC" } },
+  sched = {},
   net = { guards = { "BUILD_UIP" } },
   pd = {}, 
   pio = { guards = { "NUM_PIO > 0" } },
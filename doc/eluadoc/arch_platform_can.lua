@@ -62,7 +62,9 @@ enum
     },
 
      {  sig = "int #platform_can_recv#( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data );",
-        desc = "Receive CAN bus message.",
+        desc = [[Receive CAN bus message. This function is "split" in two parts: a platform-independent part implemented in %src/common_can.c% (that handles the receive buffer and the software acceptance filters) and a 
+platform-dependent part that must be implemented by each platform in a function named @#platform_s_can_recv@platform_s_can_recv@. If a receive buffer is set (see @#platform_can_set_buffer@platform_can_set_buffer@) the message is read from the buffer, 
+otherwise it is read directly from the hardware. Messages that don't pass the acceptance filters are discarded.]],
         args =
        {
           "$id$ - CAN interface ID.",
@@ -73,6 +75,56 @@ enum
        },
        ret = "PLATFORM_OK for success, PLATFORM_UNDERFLOW for error. (see @arch_platform_ll.html@here@ for details)"
     },
+
+    {  sig = "int #platform_s_can_recv#( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data );",
+       desc = [[Receive a CAN bus message directly from the hardware, without blocking. This is the platform-dependent part of @#platform_can_recv@platform_can_recv@ and it is also called from the CAN RX interrupt handler 
+when a receive buffer is used, so it must not block.]],
+       args =
+       {
+          "$id$ - CAN interface ID.",
+          "$canid$ - pointer where CAN identifier number will be written.",
+          "$canidtype$ - pointer where identifier type as defined @#can_id_types@here@ will be written",
+          "$len$ - pointer where message length in bytes will be written",
+          "$message$ - pointer to message buffer (8 bytes in lenth)"
+       },
+       ret = "PLATFORM_OK for success, PLATFORM_UNDERFLOW if no message is available."
+    },
+
+    {  sig = "int #platform_can_set_buffer#( unsigned id, unsigned log2size );",
+       desc = [[Sets the receive buffer of a CAN interface. If the platform defines the $INT_CAN_RX$ interrupt and $BUILD_C_INT_HANDLERS$ is enabled the buffer is filled from the CAN RX interrupt, 
+otherwise it is filled with all the pending messages every time it is read. When the buffer is full new messages are discarded and counted (see @#platform_can_get_dropped@platform_can_get_dropped@). This function is 
+platform independent and is implemented in %src/common_can.c%.]],
+       args =
+       {
+          "$id$ - CAN interface ID.",
+          "$log2size$ - the base 2 logarithm of the buffer size (in messages), or 0 to disable the receive buffer."
+       },
+       ret = "PLATFORM_OK for success, PLATFORM_ERR if the buffer could not be allocated."
+    },
+
+    {  sig = "int #platform_can_add_filter#( unsigned id, u32 canid, u32 mask, int idtype );",
+       desc = [[Adds a software acceptance filter to a CAN interface. A message is accepted if it matches at least one filter (or if there are no filters). A message matches a filter if $( msgid & mask ) == ( canid & mask )$ and its 
+identifier type is $idtype$. At most $PLATFORM_CAN_MAX_FILTERS$ filters can be set on an interface. This function is platform independent and is implemented in %src/common_can.c%.]],
+       args =
+       {
+          "$id$ - CAN interface ID.",
+          "$canid$ - CAN identifier.",
+          "$mask$ - the bits of the identifier that must match $canid$.",
+          "$idtype$ - identifier type as defined @#can_id_types@here@ or $PLATFORM_CAN_ID_ANY$ to match both types."
+       },
+       ret = "PLATFORM_OK for success, PLATFORM_ERR if there are too many filters."
+    },
+
+    {  sig = "void #platform_can_clear_filters#( unsigned id );",
+       desc = "Removes all the acceptance filters of a CAN interface, so that all the messages are accepted. This function is platform independent and is implemented in %src/common_can.c%.",
+       args = "$id$ - CAN interface ID."
+    },
+
+    {  sig = "u32 #platform_can_get_dropped#( unsigned id );",
+       desc = "Returns the number of messages discarded because the receive buffer was full. This function is platform independent and is implemented in %src/common_can.c%.",
+       args = "$id$ - CAN interface ID.",
+       ret = "the number of discarded messages since the system was started."
+    },
   }
 }
 
@@ -79,6 +79,11 @@ data_en =
       desc = "Get the CPU frequency.",
       ret = "the CPU $core$ frequency (in Hertz)."
     },
+
+    { sig = "void #platform_cpu_idle#( timer_data_type us );",
+      desc = [[Put the CPU to sleep until the next interrupt, but for at most $us$ microseconds. It is called by the @refman_gen_sched.html@sched@ module with the global interrupts disabled when all its tasks are waiting for events. The CPU must still wake up for an interrupt that is pending (but masked), and it may wake up earlier than requested. The generic implementation in %src/common.c% returns immediately. A platform that can sleep (for example with the $WFI$ instruction on Cortex-M CPUs) can define $PLATFORM_HAS_CPU_IDLE$ in its $platform_generic.h$ file and implement this function itself.]],
+      args = "$us$ - the maximum sleep time in microseconds ($PLATFORM_TIMER_INF_TIMEOUT$ if there is no limit)."
+    },
   }
 }
 
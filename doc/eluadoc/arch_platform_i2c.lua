@@ -98,6 +98,20 @@ enum
         "$ack$ - 1 to send ACK, 0 to send NAK. If $ACK$ is 0 a STOP condition will automatically be generated after the NAK."
       },
       ret = "1 for success, 0 for error."
+    },
+
+    { sig = "int #platform_i2c_transfer#( unsigned id, u16 address, const u8 *wdata, u32 wsize, u8 *rdata, u32 rsize );",
+      desc = [[Run a complete I2C transaction: START, address (transmitter), send $wsize$ bytes, repeated START, address (receiver), receive $rsize$ bytes, STOP. The write part is skipped if $wsize$ is 0 and the read part is skipped if $rsize$ is 0. A generic implementation that uses the other I2C functions is provided in %src/common.c%. A platform that can do better (for example using DMA) can define $PLATFORM_HAS_I2C_TRANSFER$ in its $platform_generic.h$ file and implement this function itself.]],
+      args =
+      {
+        "$id$ - I2C interface ID.",
+        "$address$ - I2C peripheral address.",
+        "$wdata$ - the data to send.",
+        "$wsize$ - the number of bytes to send.",
+        "$rdata$ - buffer for the received data.",
+        "$rsize$ - the number of bytes to receive."
+      },
+      ret = "1 for success, 0 for error (the address or one of the bytes sent were not acknowledged)."
     }
   }
 }
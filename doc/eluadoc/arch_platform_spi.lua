@@ -78,6 +78,17 @@ data_en =
         "$id$ - SPI interface ID.",
         "$is_select$ - $PLATFORM_SPI_SELECT_ON$ to select, $PLATFORM_SPI_SELECT_OFF$ to deselect , see @#chip_select@here@." 
       },
+    },
+
+    { sig = "void #platform_spi_transfer#( unsigned id, const u8 *out, u8 *in, u32 len );",
+      desc = [[Executes $len$ SPI read/write cycles with 8 bit data. This is used by drivers that move blocks of data (for example the SD card driver of the @arch_fatfs.html@MMC file system@). A generic implementation that calls @#platform_spi_send_recv@platform_spi_send_recv@ for each byte is provided in %src/common.c%. A platform that can do better (for example using DMA or direct register access) can define $PLATFORM_HAS_SPI_TRANSFER$ in its $platform_generic.h$ file and implement this function itself.]],
+      args =
+      {
+        "$id$ - SPI interface ID.",
+        "$out$ - the data to send, or NULL to send 0xFF for each byte.",
+        "$in$ - buffer for the received data, or NULL to discard it.",
+        "$len$ - the number of bytes to transfer."
+      },
     }
   }
 }
@@ -54,6 +54,25 @@ data_en =
         "$count$ - number of samples to return. If not enough samples are available (after blocking, if enabled) remaining values will be nil."
       }
     },
+    { sig = "count = #adc.readsamples#( id, array, [idx], [count] )",
+      desc = "Get multiple conversion values from a channel's buffer and copy them directly into a preallocated @refman_gen_bitarray.html@bitarray@. Unlike $adc.getsamples$ this doesn't create any Lua objects, so it's suited for high sample rates.",
+      args = 
+      {
+        "$id$ - ADC channel ID.",
+        "$array$ - bitarray to write samples to. Its element size must be 8, 16 or 32 bits (samples are truncated if the element size is 8 bits).",
+        "$idx$ - optional first index in $array$ to use for writing samples (defaults to 1).",
+        "$count$ - optional number of samples to copy. If not specified, the array is filled from $idx$ to its end."
+      },
+      ret = "$count$ - number of samples actually copied (might be less than requested if not enough samples are available after blocking, if enabled)."
+    },
+    { sig = "#adc.setnotify#( id, count )",
+      desc = "Request a $cpu.INT_ADC_READY$ interrupt when at least $count$ samples are available in a channel's buffer. The interrupt fires once each time the threshold is reached and is re-armed after the buffer is drained below $count$ samples. Use $cpu.sei( cpu.INT_ADC_READY, id )$ to enable it. Only available on platforms that implement $INT_ADC_READY$.",
+      args = 
+      {
+        "$id$ - ADC channel ID.",
+        "$count$ - number of samples that triggers the interrupt (0 to disable notifications). Must not exceed the size of the channel's buffer."
+      }
+    },
     { sig = "maxval = #adc.maxval#( id )",
       desc = "Get the maximum value (corresponding to the maximum voltage) that can be returned on a given channel.",
       args = 
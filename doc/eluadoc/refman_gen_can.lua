@@ -62,8 +62,50 @@ enum
         "$canidtype$ - identifier type as defined @#can_id_types@here@.",
         "$message$ - message in string format, 8 or fewer bytes."
       }
+    },
+
+    { sig = "data, count, dropped = #can.recvmany#( id, max )",
+      desc = [[Receive up to $max$ CAN bus messages with a single call. The messages are returned packed in a single string, 14 bytes per message: the CAN identifier (4 bytes, little endian), the identifier type (1 byte), the message length 
+(1 byte) and the message data (8 bytes, padded with zeros). They can be decoded with the @refman_gen_pack.html@pack@ module. For example:
+~local data, count = can.recvmany( 0, 32 )
+local pos, canid, idtype, len, msg = 1
+for i = 1, count do
+  pos, canid, idtype, len, msg = pack.unpack( data, "<IbbA8", pos )
+  handle( canid, msg:sub( 1, len ) )
+end~]],
+      args =
+      {
+        "$id$ - the ID of the CAN interface.",
+        "$max$ - the maximum number of messages to receive."
+      },
+      ret =
+      {
+        "$data$ - the received messages (an empty string if there are no messages).",
+        "$count$ - the number of messages in $data$.",
+        "$dropped$ - the number of messages discarded since the system was started because the receive buffer was full (see @#can.set_buffer@can.set_buffer@)."
+      }
+    },
+
+    { sig = "#can.set_buffer#( id, bufsize )",
+      desc = [[Sets the receive buffer of a CAN interface. If the CAN RX interrupt is available on the platform the buffer is filled from the interrupt handler, so the messages are not lost while Lua code is running, 
+otherwise it is filled with the pending messages every time it is read. Messages that arrive when the buffer is full are discarded.]],
+      args =
+      {
+        "$id$ - the ID of the CAN interface.",
+        "$bufsize$ - the size of the buffer in messages (must be a power of 2 greater than 1) or 0 to disable the receive buffer."
+      }
+    },
+
+    { sig = "#can.set_filters#( id, [filters] )",
+      desc = [[Sets the software acceptance filters of a CAN interface. Messages that don't match any of the filters are discarded before they are added to the receive buffer. A message matches a filter if 
+$bit.band( msgid, mask ) == bit.band( canid, mask )$ and its identifier type matches $canidtype$. All the messages are accepted if there are no filters.]],
+      args =
+      {
+        "$id$ - the ID of the CAN interface.",
+        "$filters (optional)$ - an array of filters, each one a table ${ canid, mask, [canidtype] }$ ($canidtype$ is an identifier type as defined @#can_id_types@here@; if it is not specified the filter matches both types). At most 8 filters can be set. If not specified, all the filters are removed. If a filter is invalid an error is raised and the current filters are not changed."
+      }
     }
-   
+
   },
 }
 
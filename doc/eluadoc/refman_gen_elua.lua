@@ -29,6 +29,64 @@ data_en =
       args = "$filename$ - the name of the file where the history will be saved. $CAUTION$: the file will be overwritten.",
     },    
 
+    { sig = "#elua.snapshot#( filename )",
+      desc = [[Save a snapshot of the Lua state to a file, so that it can be restored later with @#elua.restore@elua.restore@. The snapshot contains all the global variables and the modules loaded with $require$ that are written in Lua, together with all the tables, strings and Lua functions (including their upvalues) that can be reached from them. Functions, tables and other values provided by the firmware (for example $print$, $pio.pin.setval$ or $io.stdout$) are saved by name and looked up again when the snapshot is restored. This is useful when the initialization of an application takes a long time (for example when it loads many Lua modules from the file system): it can be done once and then replaced with a single pass over the snapshot file at boot:
+~local fname = "/wo/app.snap"
+if not elua.restore( fname ) then
+  dofile( "/rom/init.lua" )
+  elua.snapshot( fname )
+end~
+Some limitations apply: upvalues shared by different functions are restored as separate copies, changes to the tables of the C modules (for example new fields added to $string$) are not saved and coroutines and userdata that are not provided by the firmware can't be saved (an error is raised in this case).]],
+      args = "$filename$ - the name of the snapshot file (for example a file on the WOFS or NIFFS file system). $CAUTION$: the file will be overwritten.",
+    },
+
+    { sig = "res = #elua.restore#( filename )",
+      desc = "Restore a Lua state snapshot saved by @#elua.snapshot@elua.snapshot@. The saved global variables and modules are added to the current Lua state. An error is raised if the file is not a valid snapshot (for example if it is corrupted or if it was truncated by an interrupted @#elua.snapshot@elua.snapshot@) or if it was saved by an incompatible firmware. The whole file is checked before the Lua state is changed, so in this case nothing is restored.",
+      args = "$filename$ - the name of the snapshot file.",
+      ret = "$true$ if the snapshot was restored, $false$ if the file can't be opened."
+    },
+
+    { sig = "[report] = #elua.profile#( cmd )",
+      desc = [[Control the Lua VM profiler and get its results. The profiler counts the executed VM instructions and measures the time spent in each Lua and C function, for each call path, using the @arch_platform_timers.html#the_system_timer@system timer@ (so the resolution is 1us). It must be enabled at build time with the $luaprof$ component (see @configurator.html@here@). Example:
+~elua.profile( "start" )
+control_loop()
+elua.profile( "stop" )
+print( elua.profile( "flat" ) )~
+The time spent in a coroutine is attributed to the function that resumed it. The call tree has a fixed size ($ELUA_PROFILE_MAX_NODES$ call paths, 256 by default, and $ELUA_PROFILE_MAX_DEPTH$ nested calls, 48 by default); calls that don't fit are not recorded (their number is given in the header of the flat profile). The Lua functions that appear in the results are not garbage collected until the profiler is started again.]],
+      args =
+      {
+        [[$cmd$ - the command:
+<ul>
+  <li>$"start"$: clears the previous results and starts profiling.</li>
+  <li>$"stop"$: stops profiling.</li>
+  <li>$"flat"$: returns the flat profile, one line per function sorted by the time spent in the function itself, with tab separated fields: $self_us$, $total_us$, $calls$ and $name$. Lua functions are named by their source and line ($file.lua:12$), C functions by their module and key ($string.format$).</li>
+  <li>$"folded"$: returns the time spent in each call path, one line per call path: $name1;name2;...;namen self_us$ (the input format of the flame graph tools).</li>
+  <li>$"opcodes"$: returns the number of times each VM instruction was executed, one line per instruction with tab separated fields: $OPCODE$ and $count$.</li>
+</ul>]]
+      },
+      ret = "the report (a string) for the $flat$, $folded$ and $opcodes$ commands."
+    },
+
+    { sig = "prevmode = #elua.con_buffer#( [mode] )",
+      desc = [[Get or set the buffering mode of the console output (stdout). When the console output is buffered, the data written with $print$ or $io.write$ is added to an output buffer and the functions return as soon as the data is in the buffer. The buffer is sent in background 
+when the platform supports it (for example from the UART TX interrupt, if $BUILD_C_INT_HANDLERS$ is enabled and the platform defines $INT_UART_TX$), or with a single host write on the simulator. Otherwise it is sent when it is flushed. The buffer size is set with the $tx_buf_size$ 
+attribute of the $sercon$ component (see @configurator.html@here@). $stderr$ is never buffered and the buffer is always flushed before reading from the console. Only available with the serial console.]],
+      args = 
+      {
+        [[$mode (optional)$ - the new buffering mode:
+<ul>
+  <li>$"no"$: the output is not buffered (the default).</li>
+  <li>$"line"$: the buffer is sent at the end of each line.</li>
+  <li>$"full"$: the buffer is sent only when it is full or when it is flushed with @#elua.con_flush@elua.con_flush@.</li>
+</ul>]]
+      },
+      ret = "the previous buffering mode."
+    },
+
+    { sig = "#elua.con_flush#()",
+      desc = "Send all the buffered console output and wait until it is sent. Only available with the serial console.",
+    },
+
     { sig = "version = #elua.version#()",
       desc = "Returns the current eLua version as a string",
       ret = "the eLua version currently running."
@@ -67,6 +67,29 @@ data_en =
         "$numbytes$ - the number of bytes to read."
       },
       ret = "a string with all the data read from the I2C interface."
+    },
+
+    { sig = "data = #i2c.transfer#( id, address, [wdata], [numbytes] )",
+      desc = [[Runs a complete transaction with a slave: START, address, write the data (if any), repeated START, address, read the data (if any), STOP. This replaces a sequence of @#i2c.start@i2c.start@, @#i2c.address@i2c.address@, @#i2c.write@i2c.write@, @#i2c.read@i2c.read@ and @#i2c.stop@i2c.stop@ calls (for example a register read: $data = i2c.transfer( 0, 0x48, reg, 2 )$).]],
+      args =
+      {
+        "$id$ - the ID of the I2C interface.",
+        "$address$ - the address of the slave.",
+        "$wdata (optional)$ - the data to send. It can be either a number between 0 and 255, a string or a table (array) of numbers.",
+        "$numbytes (optional)$ - the number of bytes to read, 0 by default."
+      },
+      ret = "a string with the data read from the slave (an empty string if $numbytes$ is 0) or $nil$ if the transaction failed (the slave didn't acknowledge its address or the data)."
+    },
+
+    { sig = "results = #i2c.transfer#( id, transfers )",
+      desc = [[Runs a list of transactions in a single call. Each transaction is run as in the form above and a failed transaction doesn't stop the other ones. Example:
+~local res = i2c.transfer( 0, { { 0x48, 0, 2 }, { 0x49, 0, 2 }, { 0x20, { 0x12, 0xFF } } } )~]],
+      args =
+      {
+        "$id$ - the ID of the I2C interface.",
+        "$transfers$ - an array of transactions, each one an array ${ address, [wdata], [numbytes] }$ with the same meaning as the arguments of the single transaction form."
+      },
+      ret = "an array with the result of each transaction: a string with the data read or $false$ if the transaction failed."
     }
    
   },
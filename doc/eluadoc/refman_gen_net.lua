@@ -26,7 +26,10 @@ enum
   ELUA_NET_ERR_TIMEDOUT,          // exported as $net.ERR_TIMEDOUT$
   ELUA_NET_ERR_CLOSED,            // exported as $net.ERR_CLOSED$
   ELUA_NET_ERR_ABORTED,           // exported as $net.ERR_ABORTED$
-  ELUA_NET_ERR_OVERFLOW           // exported as $net.ERR_OVERFLOW$
+  ELUA_NET_ERR_OVERFLOW,          // exported as $net.ERR_OVERFLOW$
+  ELUA_NET_ERR_LIMIT_EXCEEDED,    // exported as $net.ERR_LIMIT_EXCEEDED$
+  ELUA_NET_ERR_WAIT_TIMEDOUT,     // exported as $net.ERR_WAIT_TIMEDOUT$
+  ELUA_NET_ERR_WOULDBLOCK         // exported as $net.ERR_WOULDBLOCK$
 };]],
       name = "Error codes",
       desc = "These are the error codes defined by the eLua networking layer and they are also returned by a number of functions in this module.",
@@ -155,6 +158,34 @@ blocking operation, or a positive number that specifies the timeout in microseco
         "$res$ - the number of bytes read.",
         "$err$ - the error code, as defined @#error_codes@here@."
       }
+    },
+    { sig = "res = #net.setblocking#( sock, blocking )",
+      desc = [[Switch a socket between blocking (the default) and non-blocking mode. A non-blocking socket buffers incoming data as soon as it arrives and queues outgoing data, so 
+$net.send$ and $net.recv$ return immediately: $net.send$ returns the number of bytes queued and $net.recv$ returns the data that is already buffered (in $"*l"$ mode, only a 
+complete line). When nothing can be transferred the error code is $net.ERR_WOULDBLOCK$. Switching back to blocking mode fails while data is still queued for sending and discards 
+any buffered incoming data. Accepted sockets always start in blocking mode.]],
+      args = 
+      {
+        "$sock$ - the socket.",
+        "$blocking$ - $true$ for blocking mode, $false$ for non-blocking mode."
+      },
+      ret = "$res$ - 0 for success, -1 for error (invalid socket, not enough memory for the socket buffers or data still queued for sending)."
+    },
+    { sig = "readable, writable = #net.select#( readset, writeset, [timer_id, timeout] )",
+      desc = "Wait until at least one socket from a list of non-blocking sockets is ready for reading or writing. A socket is readable if it has buffered data or if its connection was closed (so that $net.recv$ can report the error) and writable if more data can be queued on it.",
+      args = 
+      {
+        "$readset$ - array of non-blocking sockets to check for reading (can be $nil$).",
+        "$writeset$ - array of non-blocking sockets to check for writing (can be $nil$).",
+        [[$timer_id (optional)$ - the ID of the timer used for measuring the timeout. Use $nil$ or $tmr.SYS_TIMER$ to specify the @arch_platform_timers.html#the_system_timer@system timer@.]],
+        [[$timeout (optional)$ - timeout of the operation, can be either $net.NO_TIMEOUT$ or 0 to only poll the sockets, $net.INF_TIMEOUT$ to wait until a socket is ready, 
+or a positive number that specifies the timeout in microseconds. The default value of this argument is $net.INF_TIMEOUT$.]],
+      },
+      ret =
+      {
+        "$readable$ - array with the sockets from $readset$ that are ready for reading.",
+        "$writable$ - array with the sockets from $writeset$ that are ready for writing."
+      }
     }
   },
 }
@@ -99,7 +99,14 @@ data specifier is applied to a single variable that must be packed/unpacked. The
   </table></li>
   <li>$count$ is an optional counter for the $format specifier$. For example, $i5$ instructs the code to pack/unpack 5 integer variables, as opposed to $i$ that specifies a
   single integer variable.</li>
-</ul><p>]],
+</ul>
+<p>A format string can also be compiled once with @#compile@pack.compile@ and then used in place of the format string in @#pack@pack@ and @#unpack@unpack@. This is faster when the
+same format is used many times (for example to decode the frames of a binary protocol), since the format isn't parsed again in each call, the fixed size data is packed in a buffer of the
+compiled format and the unpacked values can be stored in an existing table instead of being returned:</p>
+~local frame = pack.compile( "<<H2b4i" )
+local t = {}
+local nextpos, n = pack.unpack( data, frame, 1, t )~
+<p>]],
 
   -- Functions
   funcs = 
@@ -108,7 +115,7 @@ data specifier is applied to a single variable that must be packed/unpacked. The
       desc = "Packs variables in a string.",
       args = 
       {
-        "$format$ - format specifier (as described @#overview@here@).",
+        "$format$ - format specifier (as described @#overview@here@) or a compiled format returned by @#compile@pack.compile@.",
         "$val1$ - first variable to pack.",
         "$val2$ - second variable to pack.",
         "$valn$ - nth variable to pack.",
@@ -116,21 +123,28 @@ data specifier is applied to a single variable that must be packed/unpacked. The
       ret = "$packed$ - a string containing the packed representation of all variables according to the format."
     },
 
-    { sig = "nextpos, val1, val2, ..., valn = #pack.unpack#( string, format, [ init ] )",
+    { sig = "nextpos, val1, val2, ..., valn = #pack.unpack#( string, format, [ init ], [ t ] )",
       desc = "Unpacks a string",
       args = 
       {
         "$string$ - the string to unpack.",
-        "$format$ - format specifier (as described @#overview@here@).",
-        "$init$ - $(optional)$ marks where in $string$ the unpacking should start (1 if not specified)."
+        "$format$ - format specifier (as described @#overview@here@) or a compiled format returned by @#compile@pack.compile@.",
+        "$init$ - $(optional)$ marks where in $string$ the unpacking should start (1 if not specified).",
+        "$t$ - $(optional, only with a compiled format)$ a table that receives the unpacked values (in $t[1]$ to $t[n]$) instead of returning them. The other entries of the table are not changed."
       },
       ret = 
       {
         "$nextpos$ - the position in the string after unpacking.",
-        "$val1$ - the first unpacked value.",
+        "$val1$ - the first unpacked value (or $n$, the number of unpacked values, if $t$ is given).",
         "$val2$ - the second unpacked value.",
         "$valn$ - the nth unpacked value."
       }
+    },
+
+    { sig = "cformat = #pack.compile#( format )",
+      desc = "Compiles a format string, so that it can be used by @#pack@pack@ and @#unpack@unpack@ without being parsed again in each call.",
+      args = "$format$ - format specifier (as described @#overview@here@).",
+      ret = "$cformat$ - the compiled format (an userdata)."
     }
   },
 }
@@ -67,6 +67,10 @@ data_en =
       <td>$val1$, $val2$, $valn$ = $handle$.$remote_func$()</td>
       <td>call $remote_func$ on the server side, and return values to local state</td>
     </tr>
+    <tr>
+      <td>$future$ = $handle$.$remote_func$:async()</td>
+      <td>call $remote_func$ on the server side without waiting for it to return. Any number of async calls can be in progress at the same time. The results are obtained with @#rpc.wait@rpc.wait@.</td>
+    </tr>
     <tr>
       <td>$helper$ = $handle$.$remote_var$</td>
       <td>create a $helper$ which points to $remote_var$, and can be used as shorthand later (e.g.: $helper$:get() would get the contents of the remote variable. If $remote_var$ were a table with functions on it: $helper$.$funcname$() would call $funcname$, on table $remote_var$ on the server, and return any results.)</td>
@@ -81,6 +85,18 @@ data_en =
       args = "$handle$ - handle associated with the connection.",
     },
 
+    { sig = "val1, val2, ... valn = #rpc.wait#( future )",
+      desc = "Wait for an async call (started with $handle$.$remote_func$:async()) to finish and return its results. Errors are reported like the errors of a normal remote call.",
+      args = "$future$ - the value returned by the async call.",
+      ret = "the values returned by the remote function"
+    },
+
+    { sig = "done = #rpc.poll#( future )",
+      desc = "Check if an async call has finished, without blocking.",
+      args = "$future$ - the value returned by the async call.",
+      ret = "$done$ - true if the results of the call are available (in which case @#rpc.wait@rpc.wait@ returns immediately), false otherwise"
+    },
+
     { sig = "#rpc.server#( transport_identifiers )",
       desc = "Start a blocking/captive RPC server, which will wait for incoming connections.",
       args = "$transport_identifiers$ - platform-specific serial port identification (see @#overview@overview@)",
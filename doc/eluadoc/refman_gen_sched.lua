@@ -0,0 +1,98 @@
+-- eLua reference manual - sched module
+
+data_en =
+{
+
+  -- Title
+  title = "eLua reference manual - sched module",
+
+  -- Menu name
+  menu_name = "sched",
+
+  -- Overview
+  overview = [[This module implements a cooperative scheduler for Lua coroutines (tasks). A task runs until it waits for an event (a delay, an interrupt,
+  data on an UART or a socket that becomes readable or writable) using one of the $wait$ functions in this module, then the scheduler runs the other
+  tasks until the event happens. This way, a single Lua program can service many peripherals at the same time without polling loops. Interrupts are
+  taken from the same queue as the @inthandlers.html@Lua interrupt handlers@ and timeouts are measured with the
+  @arch_platform_timers.html#the_system_timer@system timer@. When all the tasks are waiting, the scheduler checks for events without running any Lua code.</p>
+  <p>A simple example that blinks a LED while echoing the data received on an UART:</p>
+~sched.spawn( function()
+  while true do
+    pio.pin.sethigh( led ); sched.sleep( 500000 )
+    pio.pin.setlow( led ); sched.sleep( 500000 )
+  end
+end )
+sched.spawn( function()
+  while true do
+    uart.write( 0, sched.wait_uart( 0 ) )
+  end
+end )
+sched.run()~
+  <p>All the $wait$ functions ($sched.yield$, $sched.sleep$, $sched.wait_int$, $sched.wait_uart$, $sched.wait_socket$) can only be called from a task
+  (not from a coroutine created by a task). The maximum number of tasks is given by the $SCHED_MAX_TASKS$ macro (16 by default).]],
+
+  -- Functions
+  funcs =
+  {
+    { sig = "co = #sched.spawn#( f, [arg1], [arg2], ..., [argn] )",
+      desc = "Creates a new task. The task will start running the next time the scheduler runs (see @#sched.run@sched.run@).",
+      args =
+      {
+        "$f$ - the task function.",
+        "$arg1 - argn$ - arguments for $f$.",
+      },
+      ret = "the coroutine of the task."
+    },
+
+    { sig = "#sched.run#()",
+      desc = "Runs the tasks until all of them finish. If a task raises an error, the scheduler stops and the error is propagated to the caller of this function (the other tasks are kept and can be resumed by calling $sched.run$ again).",
+    },
+
+    { sig = "#sched.yield#()",
+      desc = "Suspends the current task and lets the other tasks run.",
+    },
+
+    { sig = "#sched.sleep#( period )",
+      desc = "Suspends the current task for the given period. The other tasks run in the meantime.",
+      args = "$period$ - how long to wait (in us).",
+    },
+
+    { sig = "resnum = #sched.wait_int#( id, [resnum], [timeout] )",
+      desc = [[Suspends the current task until the given interrupt happens. The interrupt must be enabled with @refman_gen_cpu.html#cpu.sei@cpu.sei@. If the
+interrupt happened after the last call to this function, but while no task was waiting for it, the function returns immediately. A Lua handler for
+the same interrupt (set with @refman_gen_cpu.html#cpu.set_int_handler@cpu.set_int_handler@) is still called. Only available if Lua interrupt support
+is enabled (see @inthandlers.html@here@ for details).]],
+      args =
+      {
+        "$id$ - the interrupt ID (for example $cpu.INT_GPIO_POSEDGE$ or $cpu.INT_TMR_MATCH$).",
+        "$resnum (optional)$ - the resource ID (for example the timer ID or the pin). If not specified, any resource will match.",
+        "$timeout (optional)$ - timeout (in us). If not specified, wait forever.",
+      },
+      ret = "the resource ID of the interrupt or $nil$ if the timeout expired."
+    },
+
+    { sig = "data = #sched.wait_uart#( id, [timeout] )",
+      desc = "Suspends the current task until a character is received on the given UART.",
+      args =
+      {
+        "$id$ - the UART ID.",
+        "$timeout (optional)$ - timeout (in us). If not specified, wait forever.",
+      },
+      ret = "the received character (as a string) or $nil$ if the timeout expired."
+    },
+
+    { sig = "res = #sched.wait_socket#( sock, mode, [timeout] )",
+      desc = "Suspends the current task until the given socket is ready. The socket must be in non-blocking mode (see @refman_gen_net.html#net.setblocking@net.setblocking@). Only available if networking support is enabled.",
+      args =
+      {
+        "$sock$ - the socket.",
+        "$mode$ - $\"r\"$ to wait until the socket is readable or $\"w\"$ to wait until it is writable.",
+        "$timeout (optional)$ - timeout (in us). If not specified, wait forever.",
+      },
+      ret = "$true$ if the socket is ready, $nil$ if the timeout expired."
+    },
+  },
+}
+
+data_pt = data_en
+
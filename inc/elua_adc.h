@@ -2,6 +2,7 @@
 #define __ELUA_ADC_H__
 
 #include "platform_conf.h"
+#include "elua_int.h"
 
 
 typedef struct 
@@ -11,7 +12,9 @@ typedef struct
                   blocking: 1, // Are we in blocking or non-blocking mode? (0 - blocking, 1 - nonblocking)
                   freerunning: 1, // If true, we don't stop when we've acquired the requested number of samples
                   smooth_ready: 1, // Has smoothing filter warmed up (i.e. smoothlen samples collected)
-                  value_fresh: 1; // Whether the value pointed to by value_ptr is fresh
+                  value_fresh: 1, // Whether the value pointed to by value_ptr is fresh
+                  notify_enabled: 1, // Is the INT_ADC_READY interrupt enabled for this channel?
+                  notify_armed: 1; // Will the next threshold crossing fire INT_ADC_READY?
                     
   unsigned        id;
 
@@ -22,6 +25,8 @@ typedef struct
 
   volatile u16    reqsamples;
   volatile u16    *value_ptr;
+
+  u16             notifysamples; // INT_ADC_READY threshold (0 - disabled)
 } elua_adc_ch_state;
 
 typedef struct
@@ -56,6 +61,12 @@ void adc_flush_smoothing( unsigned id );
 u16 adc_samples_requested( unsigned id );
 u16 adc_samples_available( unsigned id );
 u16 adc_wait_samples( unsigned id, unsigned samples );
+u16 adc_read_samples( unsigned id, void *dest, u16 count, u8 dsize );
+void adc_set_notify( unsigned id, u16 count );
+void adc_check_notify( unsigned id );
+int adc_int_ready_set_status( elua_int_resnum resnum, int status );
+int adc_int_ready_get_status( elua_int_resnum resnum );
+int adc_int_ready_get_flag( elua_int_resnum resnum, int clear );
 
 #endif
 
@@ -35,6 +35,12 @@ typedef struct
 // C interrupt handlers
 typedef void( *elua_int_c_handler )( elua_int_resnum resnum );
 
+// Interrupt notification function (called from the Lua hook for every 
+// interrupt taken from the queue, before the Lua handler)
+typedef void( *elua_int_notify_func )( elua_int_id inttype, elua_int_resnum resnum );
+
+struct lua_State;
+
 // Handler key in the registry
 #define LUA_INT_HANDLER_KEY             ( int )&elua_int_add
 
@@ -51,6 +57,8 @@ void elua_int_cleanup(void);
 void elua_int_disable_all(void);
 elua_int_c_handler elua_int_set_c_handler( elua_int_id inttype, elua_int_c_handler phandler );
 elua_int_c_handler elua_int_get_c_handler( elua_int_id inttype );
+elua_int_notify_func elua_int_set_notify( elua_int_notify_func pfunc );
+void elua_int_poll( struct lua_State *L );
 
 #endif
 
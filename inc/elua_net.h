@@ -18,7 +18,8 @@ enum
   ELUA_NET_ERR_ABORTED,
   ELUA_NET_ERR_OVERFLOW,
   ELUA_NET_ERR_LIMIT_EXCEEDED, // New TH
-  ELUA_NET_ERR_WAIT_TIMEDOUT // New TH
+  ELUA_NET_ERR_WAIT_TIMEDOUT, // New TH
+  ELUA_NET_ERR_WOULDBLOCK
 };
 
 // eLua IP address type
@@ -39,6 +40,10 @@ typedef union
 // 'no lastchar' for read to char (recv)
 #define ELUA_NET_NO_LASTCHAR          ( -1 )
 
+// Socket readiness flags (elua_net_get_ready)
+#define ELUA_NET_READY_READ           1
+#define ELUA_NET_READY_WRITE          2
+
 // eLua TCP/IP functions
 int elua_net_socket( int type );
 int elua_net_close( int s );
@@ -52,5 +57,7 @@ int elua_listen( u16 port,BOOL flisten ); // Added TH
 
 int elua_net_get_last_err( int s );
 int elua_net_get_telnet_socket( void );
+int elua_net_set_blocking( int s, int blocking );
+int elua_net_get_ready( int s );
 
 #endif
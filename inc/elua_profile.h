@@ -0,0 +1,59 @@
+// Lua VM profiler (opcode counters and time spent in Lua/C functions)
+
+#ifndef __ELUA_PROFILE_H__
+#define __ELUA_PROFILE_H__
+
+#ifdef BUILD_LUA_PROFILER
+
+#include "lua.h"
+#include "type.h"
+
+// Maximum number of nodes in the call tree (a node is a function called
+// from a given call path)
+#ifndef ELUA_PROFILE_MAX_NODES
+#define ELUA_PROFILE_MAX_NODES        256
+#endif
+
+// Maximum call depth tracked by the profiler
+#ifndef ELUA_PROFILE_MAX_DEPTH
+#define ELUA_PROFILE_MAX_DEPTH        48
+#endif
+
+extern int elua_prof_active;
+extern u32 elua_prof_opcodes[];
+
+// Hooks called by the Lua core (see ldo.c and lvm.c)
+void elua_prof_enter( lua_State *L, const void *key, int isc );
+void elua_prof_exit( lua_State *L );
+void elua_prof_tailcall( lua_State *L );
+
+#define elua_prof_opcode( op )\
+  do { if( elua_prof_active ) elua_prof_opcodes[ op ] ++; } while( 0 )
+#define elua_prof_call( L, key, isc )\
+  do { if( elua_prof_active ) elua_prof_enter( L, key, isc ); } while( 0 )
+#define elua_prof_return( L )\
+  do { if( elua_prof_active ) elua_prof_exit( L ); } while( 0 )
+#define elua_prof_tail( L )\
+  do { if( elua_prof_active ) elua_prof_tailcall( L ); } while( 0 )
+
+// Called by the GC in its atomic phase to keep alive the Lua functions in
+// the call tree (the reports use them) until the profiler is restarted
+void elua_prof_mark( void ( *mark )( const void *p, void *ud ), void *ud );
+
+// Interface for the 'elua' module
+void elua_prof_start( void );
+void elua_prof_stop( void );
+void elua_prof_push_flat( lua_State *L );
+void elua_prof_push_folded( lua_State *L );
+void elua_prof_push_opcodes( lua_State *L );
+
+#else // #ifdef BUILD_LUA_PROFILER
+
+#define elua_prof_opcode( op )          ( ( void )0 )
+#define elua_prof_call( L, key, isc )   ( ( void )0 )
+#define elua_prof_return( L )           ( ( void )0 )
+#define elua_prof_tail( L )             ( ( void )0 )
+
+#endif // #ifdef BUILD_LUA_PROFILER
+
+#endif
@@ -0,0 +1,20 @@
+// Lua state snapshots (save the globals to a file, restore them at boot)
+
+#ifndef __ELUA_SNAPSHOT_H__
+#define __ELUA_SNAPSHOT_H__
+
+#include "lua.h"
+
+// Maximum nesting level of tables/functions in a snapshot
+#define ELUA_SNAPSHOT_MAX_DEPTH       64
+
+// Save all the global variables of 'L' (and everything reachable from them)
+// to 'fname'. Raises a Lua error on failure.
+void elua_snapshot_save( lua_State *L, const char *fname );
+
+// Restore a snapshot saved by elua_snapshot_save in 'L'. Returns 0 if the
+// file can't be opened, 1 if the snapshot was restored. Raises a Lua error
+// (without changing 'L') if the snapshot is invalid or can't be restored.
+int elua_snapshot_restore( lua_State *L, const char *fname );
+
+#endif
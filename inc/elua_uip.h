@@ -34,4 +34,7 @@ void elua_uip_udp_appcall();
 void elua_uip_init( const struct uip_eth_addr* paddr );
 void elua_uip_mainloop();
 
+// Word-at-a-time Internet checksum (elua_chksum.c)
+u16 elua_chksum( u16 sum, const u8 *data, u16 len );
+
 #endif
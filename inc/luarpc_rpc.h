@@ -9,8 +9,18 @@
 
 #define MAX_LINK_ERRS ( 2 ) // Maximum number of framing errors before connection reset
 
+#define RPC_MAX_PATH_IDS ( 64 ) // Maximum number of remote paths with an id (per connection)
+
 #define LUARPC_MODE "elua"
 
+// Transport buffer sizes (outgoing messages are assembled in the write buffer)
+#ifndef LUARPC_WBUF_SIZE
+#define LUARPC_WBUF_SIZE ( 128 )
+#endif
+#ifndef LUARPC_RBUF_SIZE
+#define LUARPC_RBUF_SIZE ( 128 )
+#endif
+
 // a kind of silly way to get the maximum int, but oh well ...
 #define MAXINT ((int)((((unsigned int)(-1)) << 1) >> 1))
 
@@ -89,6 +99,10 @@ struct _Transport
          net_little: 1,               // Network is little endian?
          net_intnum: 1;               // Network is integer only?
   u8     lnum_bytes;
+  u16    wpos;                        // Bytes waiting in wbuf
+  u16    rpos, rlen;                  // Read position and data length in rbuf
+  u8     wbuf[ LUARPC_WBUF_SIZE ];
+  u8     rbuf[ LUARPC_RBUF_SIZE ];
 };
 
 typedef struct _Handle Handle;
@@ -96,8 +110,11 @@ struct _Handle
 {
   Transport tpt;                      // the handle socket
   int error_handler;                  // function reference
-  int async;                          // nonzero if async mode being used
-  int read_reply_count;               // number of async call return values to read
+  u32 seq;                            // sequence number of the next async call
+  int npending;                       // number of async calls waiting for a reply
+  int pending_ref;                    // registry ref: table of pending futures, by sequence number
+  int paths_ref;                      // registry ref: table of path ids, by remote path
+  u32 npaths;                         // number of path ids defined
 };
 
 typedef struct _Helper Helper;
@@ -109,11 +126,30 @@ struct _Helper {
   char funcname[NUM_FUNCNAME_CHARS + 1];  // name of the function
 };
 
+// Async call states
+enum
+{
+  RPC_FUTURE_PENDING,
+  RPC_FUTURE_DONE,
+  RPC_FUTURE_ERROR
+};
+
+typedef struct _Future Future;
+struct _Future {
+  Handle *handle;                         // pointer to handle object
+  int href;                               // handle reference idx in registry
+  int rref;                               // results table reference idx in registry
+  u32 seq;                                // sequence number of the call
+  u8 state;                               // RPC_FUTURE_xxx
+};
+
 typedef struct _ServerHandle ServerHandle;
 struct _ServerHandle {
   Transport ltpt;   // listening transport, always valid if no error
   Transport atpt;   // accepting transport, valid if connection established
   int link_errs;
+  int paths_ref;    // registry ref: table of paths, by path id
+  int values_ref;   // registry ref: table of resolved paths, by path id
 };
 
 
@@ -155,6 +191,10 @@ void transport_accept (Transport *tpt, Transport *atpt);
 void transport_read_buffer (Transport *tpt, u8 *buffer, int length);
 void transport_write_buffer (Transport *tpt, const u8 *buffer, int length);
 
+// Read at least 1 and at most maxlen bytes (whatever is already available
+// after the first byte), returns number of bytes read
+int transport_read_some (Transport *tpt, u8 *buffer, int maxlen);
+
 // Check if data is available on connection without reading:
 //     - 1 = data available, 0 = no data available
 int transport_readable (Transport *tpt);
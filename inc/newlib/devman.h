@@ -65,6 +65,7 @@ typedef struct
   int ( *p_unlink_r )( struct _reent *r, const char *fname, void *pdata );
   int ( *p_rmdir_r )( struct _reent *r, const char *fname, void *pdata );
   int ( *p_rename_r )( struct _reent *r, const char *oldname, const char *newname, void *pdata );
+  const char* ( *p_map_r )( struct _reent *r, int fd, off_t off, size_t *plen, void *pdata );
 } DM_DEVICE;
 
 // Additional registration data for each FS (per FS instance)
@@ -104,12 +105,25 @@ const DM_INSTANCE_DATA* dm_get_instance_at( int idx );
 int dm_get_num_devices(void);
 // Initialize device manager
 int dm_init(void);
+// Mark the content of a device as changed (files added/removed)
+void dm_set_changed( int idx );
+// Called after a file was opened (the device is marked as changed if the
+// file might have been created)
+void dm_notify_open( int idx, int flags );
+// Get the generation of the device that contains 'path' (the value of a
+// global counter at the time of its last change or registration). If
+// there is no such device, returns the generation of the last device
+// registration/removal.
+u32 dm_get_generation( const char *path );
+// Get the current value of the generation counter
+u32 dm_get_current_generation(void);
 
 // DM specific functions (uniform over all the installed filesystems)
 DM_DIR *dm_opendir( const char* dirname );
 struct dm_dirent* dm_readdir( DM_DIR *d );
 int dm_closedir( DM_DIR *d );
 const char* dm_getaddr( int fd );
+const char* dm_map( int fd, off_t off, size_t *plen );
 
 #endif
 
@@ -13,13 +13,32 @@
 #define STD_INFINITE_TIMEOUT    PLATFORM_TIMER_INF_TIMEOUT
 #define STD_INTER_CHAR_TIMEOUT  10000
 
+// Size of the console output buffer (must be a power of 2, 0 to disable)
+#ifndef STD_TX_BUF_SIZE
+#define STD_TX_BUF_SIZE         512
+#endif
+
+// Console output buffering modes
+enum
+{
+  STD_BUF_NONE = 0,         // each character is sent when it is written
+  STD_BUF_LINE,             // the buffer is sent at the end of each line
+  STD_BUF_FULL              // the buffer is sent when it is full
+};
+
 // Send/receive function types
 typedef void ( *p_std_send_char )( int fd, char c );
 typedef int ( *p_std_get_char )( timer_data_type to );
+typedef void ( *p_std_tx_start )( void );
 
 // STD functions
 void std_set_send_func( p_std_send_char pfunc );
 void std_set_get_func( p_std_get_char pfunc );
+void std_set_tx_start_func( p_std_tx_start pfunc );
+int std_set_buffer_mode( int mode );
+int std_get_buffer_mode(void);
+void std_flush(void);
+int std_tx_get_char(void);
 int std_register(void);
 
 #endif
@@ -145,6 +145,12 @@ void platform_timer_sys_disable_int(void);
 // Maximum length for any CAN message
 #define PLATFORM_CAN_MAXLEN                   8
 
+// Maximum number of software acceptance filters on a CAN interface
+#define PLATFORM_CAN_MAX_FILTERS              8
+
+// Receive any CAN ID type (for platform_can_add_filter)
+#define PLATFORM_CAN_ID_ANY                   ( -1 )
+
 // eLua CAN ID types
 enum
 {
@@ -156,6 +162,13 @@ int platform_can_exists( unsigned id );
 u32 platform_can_setup( unsigned id, u32 clock );
 int platform_can_send( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data );
 int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data );
+int platform_can_set_buffer( unsigned id, unsigned log2size );
+int platform_can_add_filter( unsigned id, u32 canid, u32 mask, int idtype );
+void platform_can_clear_filters( unsigned id );
+u32 platform_can_get_dropped( unsigned id );
+
+// Platform specific CAN receive function (used by the common CAN layer)
+int platform_s_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data );
 
 // *****************************************************************************
 // SPI subsection
@@ -182,6 +195,7 @@ int platform_spi_exists( unsigned id );
 u32 platform_spi_setup( unsigned id, int mode, u32 clock, unsigned cpol, unsigned cpha, unsigned databits );
 spi_data_type platform_spi_send_recv( unsigned id, spi_data_type data );
 void platform_spi_select( unsigned id, int is_select );
+void platform_spi_transfer( unsigned id, const u8 *out, u8 *in, u32 len );
 
 // *****************************************************************************
 // UART subsection
@@ -262,6 +276,7 @@ int platform_cpu_set_interrupt( elua_int_id id, elua_int_resnum resnum, int stat
 int platform_cpu_get_interrupt( elua_int_id id, elua_int_resnum resnum );
 int platform_cpu_get_interrupt_flag( elua_int_id id, elua_int_resnum resnum, int clear );
 u32 platform_cpu_get_frequency(void);
+void platform_cpu_idle( timer_data_type us );
 
 // *****************************************************************************
 // The platform ADC functions
@@ -306,6 +321,7 @@ void platform_i2c_send_stop( unsigned id );
 int platform_i2c_send_address( unsigned id, u16 address, int direction );
 int platform_i2c_send_byte( unsigned id, u8 data );
 int platform_i2c_recv_byte( unsigned id, int ack );
+int platform_i2c_transfer( unsigned id, u16 address, const u8 *wdata, u32 wsize, u8 *rdata, u32 rsize );
 
 // *****************************************************************************
 // Ethernet specific functions
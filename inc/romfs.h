@@ -13,6 +13,11 @@ following structure (repeated for each file):
 Filename: ASCIIZ, max length is DM_MAX_FNAME_LENGTH, first byte is 0xFF if last file
 File size: (4 bytes), aligned to ROMFS_ALIGN bytes 
 File data: (file size bytes)
+Terminator: a single 0 byte (not included in the file size)
+
+The terminator allows the contents of a file (or any part of it that extends
+to the end of the file) to be used in place as a read-only Lua string (see
+the 'map' operation of the device manager).
 
 The WOFS (Write Once File System) uses much of the ROMFS functions, thuss it is
 also implemented in romfs.c. It resides in a contiguous zone of memory, with a
@@ -24,6 +29,9 @@ File deleted flag: (WOFS_DEL_FIELD_SIZE bytes), aligned to ROMFS_ALIGN bytes
 File size: (4 bytes), aligned to ROMFS_ALIGN bytes
 File data: (file size bytes)
 
+WOFS files are not terminated and they can't be mapped, since a WOFS can be
+formatted while the mapped data is still in use.
+
 *******************************************************************************/
 
 enum
@@ -7,8 +7,7 @@
 #include "platform.h"
 
 // XMODEM constants
-#define XMODEM_INITIAL_BUFFER_SIZE    4096 // TH
-#define XMODEM_INCREMENT_AMMOUNT      4096 // TH
+#define XMODEM_MAX_BLOCK_SIZE         1024
 
 // xmodem timeout/retry parameters
 #define XMODEM_TIMEOUT                1000000
@@ -18,12 +17,25 @@
 #define XMODEM_ERROR_REMOTECANCEL     (-1)
 #define XMODEM_ERROR_OUTOFSYNC        (-2)
 #define XMODEM_ERROR_RETRYEXCEED      (-3)
-#define XMODEM_ERROR_OUTOFMEM         (-4)
+#define XMODEM_ERROR_OUTOFMEM         (-4) // reserved, the receiver uses a fixed buffer
 #define XMODEM_ERROR_INTERNAL         (-5) // TH
 
+// Streaming receive state
+// The last complete block is held back until the next block (or EOT) arrives,
+// so the padding bytes of the final block can be removed before it is returned
+typedef struct
+{
+  u8 rxbuf[ XMODEM_MAX_BLOCK_SIZE + 4 ];  // block number, ~block number, data, CRC
+  u8 data[ XMODEM_MAX_BLOCK_SIZE ];       // data of the block returned to the caller
+  unsigned datalen, rxlen;
+  u8 packnum, state;
+} xmodem_stream;
+
 typedef void ( *p_xm_send_func )( u8 );
 typedef int ( *p_xm_recv_func )( timer_data_type );
-long xmodem_receive( char** dest );
+void xmodem_stream_init( xmodem_stream *ps );
+long xmodem_stream_next( xmodem_stream *ps, const u8 **pdata );
+void xmodem_stream_abort( xmodem_stream *ps );
 void xmodem_init( p_xm_send_func send_func, p_xm_recv_func recv_func );
 
 #endif // #ifndef __XMODEM_H__
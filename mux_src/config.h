@@ -9,5 +9,13 @@
 #define NET_TIMEOUT_MS              100
 #define MEM_BUF_SIZE                ( 6 * 1024 )
 
+// Size of the buffer used to read data from the transport/service ports
+#define MUX_READ_BUF_SIZE           4096
+// Size of the output queue of each port (escaping can double the data size
+// on the transport side)
+#define MUX_QUEUE_SIZE              ( 2 * MUX_READ_BUF_SIZE + 16 )
+// Throughput statistics interval in verbose mode (seconds)
+#define MUX_STATS_INTERVAL_S        10
+
 #endif
 
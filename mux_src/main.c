@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <ctype.h>
+#include <time.h>
 #include "config.h"
 #include "log.h"
 #include "type.h"
@@ -24,19 +25,33 @@
 #define HND_TRANSPORT_OFFSET  0
 #define HND_FIRST_VOFFSET     1
 
-#define RFS_PSEUDO_SELIDX     0xFF
+#define NUM_SERVICE_IDS       ( SERMUX_SERVICE_ID_LAST - SERMUX_SERVICE_ID_FIRST + 1 )
 
 // Send/receive/init function pointers
 typedef u32 ( *p_recv_func )( u8 *p, u32 size );
 typedef u32 ( *p_send_func )( const u8 *p, u32 size );
 typedef int ( *p_init_func )( void );
 
+// Output queue (data waiting to be written to a port)
+typedef struct {
+  u8 data[ MUX_QUEUE_SIZE ];
+  u32 len;
+} MUX_QUEUE;
+
 // Serial thread buffer structure
 typedef struct {
   const char *pname;
   ser_handler fd;
+  MUX_QUEUE out;
 } SERVICE_DATA;
 
+// Throughput statistics (per service ID)
+typedef struct {
+  unsigned long bytes_in;     // from the board to the host
+  unsigned long bytes_out;    // from the host to the board
+  unsigned long dropped;      // data that couldn't be delivered
+} MUX_STATS;
+
 // Serial transport data structure
 typedef struct {
   ser_handler fd;
@@ -53,6 +68,12 @@ static p_send_func transport_send;
 static p_init_func transport_init;
 
 static int service_id_in = -1, service_id_out = -1;
+static int got_esc, prev_sent = -1;
+static MUX_QUEUE transport_out;
+static MUX_STATS stats[ NUM_SERVICE_IDS ];
+static time_t stats_time;
+// Bytes that can't be copied directly (escape char, FORCE_SID char, service IDs)
+static u8 mux_special[ 256 ];
  
 static ser_handler transport_hnd = SER_HANDLER_INVALID;
 static int mux_mode;
@@ -92,9 +113,226 @@ static int transport_ser_init()
 // ****************************************************************************
 // Utility functions and helpers
 
+// Write all the data in the queue to the given port (or to the transport
+// if 'pser' is NULL). Returns the number of bytes that could not be written.
+static u32 muxh_queue_flush( MUX_QUEUE *q, SERVICE_DATA *pser )
+{
+  u32 done = 0, res;
+
+  while( done < q->len )
+  {
+    if( pser )
+      res = ser_write( pser->fd, q->data + done, q->len - done );
+    else
+      res = transport_send( q->data + done, q->len - done );
+    if( res == 0 )
+      break;
+    done += res;
+  }
+  res = q->len - done;
+  q->len = 0;
+  return res;
+}
+
+// Add data to a queue, flushing the queue first if there is not enough space
+// Returns the number of bytes that were dropped
+static u32 muxh_queue_put( MUX_QUEUE *q, SERVICE_DATA *pser, const u8 *p, u32 size )
+{
+  u32 drop = 0, chunk;
+
+  while( size > 0 )
+  {
+    if( q->len == MUX_QUEUE_SIZE )
+      drop += muxh_queue_flush( q, pser );
+    chunk = MUX_QUEUE_SIZE - q->len;
+    if( chunk > size )
+      chunk = size;
+    memcpy( q->data + q->len, p, chunk );
+    q->len += chunk;
+    p += chunk;
+    size -= chunk;
+  }
+  return drop;
+}
+
 static void transport_send_byte( u8 data )
 {
-  transport_send( &data, 1 );
+  muxh_queue_put( &transport_out, NULL, &data, 1 );
+}
+
+// Send a block of data from the service 'sid' to the transport, escaping
+// it and changing the output service ID if needed
+static void muxh_send_service( int sid, const u8 *p, u32 size )
+{
+  u32 i, start;
+  u8 esc[ 2 ];
+
+  if( size == 0 )
+    return;
+  // Send the service ID first if needed
+  if( sid != service_id_out )
+  {
+    log_msg( "Changed service_id_out from %d(%X) to %d(%X).\n", service_id_out, service_id_out, sid, sid );
+    transport_send_byte( sid );
+    service_id_out = sid;
+  }
+  stats[ sid - SERMUX_SERVICE_ID_FIRST ].bytes_out += size;
+  // Then send the data, copying the runs of regular bytes directly
+  for( i = 0; i < size; )
+  {
+    if( mux_special[ p[ i ] ] )
+    {
+      esc[ 0 ] = SERMUX_ESCAPE_CHAR;
+      esc[ 1 ] = p[ i ] ^ SERMUX_ESCAPE_XOR_MASK;
+      muxh_queue_put( &transport_out, NULL, esc, 2 );
+      prev_sent = SERMUX_ESC_MASK | esc[ 1 ];
+      i ++;
+    }
+    else
+    {
+      for( start = i; i < size && !mux_special[ p[ i ] ]; i ++ );
+      muxh_queue_put( &transport_out, NULL, p + start, i - start );
+      prev_sent = p[ i - 1 ];
+    }
+  }
+}
+
+// Deliver a block of data received from the transport to the current
+// input service (a virtual port or the RFS server)
+static void muxh_deliver( const u8 *p, u32 size )
+{
+  unsigned idx = service_id_in - SERMUX_SERVICE_ID_FIRST;
+  u16 rfs_size;
+  u8 *rfs_ptr;
+  u32 i;
+
+  stats[ idx ].bytes_in += size;
+  if( service_id_in == rfs_service_id ) // this request is for the RFS server
+  {
+    for( i = 0; i < size; i ++ )
+    {
+      rfs_mem_read_request_packet( p[ i ] );
+      if( rfs_mem_has_response() ) // we have a response from the RFS server
+      {
+        rfs_mem_write_response( &rfs_size, &rfs_ptr );
+        muxh_send_service( rfs_service_id, rfs_ptr, rfs_size );
+        rfs_mem_start_request(); // initialize the RFS server for a new request
+      }
+    }
+  }
+  else if( idx - service_offset < vport_num )
+    stats[ idx ].dropped += muxh_queue_put( &services[ idx - service_offset ].out, services + idx - service_offset, p, size );
+  else
+    stats[ idx ].dropped += size;
+}
+
+// Interpret a block of data received from the transport
+// Returns 0 for protocol error, 1 otherwise
+static int muxh_from_transport( const u8 *p, u32 size )
+{
+  u32 i, start;
+  int c;
+
+  for( i = 0; i < size; )
+  {
+    // Fast path: a run of regular data bytes for a known service
+    if( !got_esc && service_id_in != -1 && !mux_special[ p[ i ] ] )
+    {
+      for( start = i; i < size && !mux_special[ p[ i ] ]; i ++ );
+      muxh_deliver( p + start, i - start );
+      continue;
+    }
+    c = p[ i ++ ];
+    if( c == SERMUX_ESCAPE_CHAR )
+    {
+      got_esc = 1;
+      continue;
+    }
+    if( c >= SERMUX_SERVICE_ID_FIRST && c <= SERMUX_SERVICE_ID_LAST )
+    {
+      log_msg( "Changed service_id_in from %d(%X) to %d(%X).\n", service_id_in, service_id_in, c, c );
+      service_id_in = c;
+      continue;
+    }
+    if( c == SERMUX_FORCE_SID_CHAR )
+    {
+      if( prev_sent == -1 )
+      {
+        log_err( "Protocol error: got request to resend service ID when the last char sent was not set.\n" );
+        return 0;
+      }
+      log_msg( "Got request to resend service_id_out %d(%X).\n", service_id_out, service_id_out );
+      // Re-transmit the last data AND the service ID
+      transport_send_byte( service_id_out );
+      if( prev_sent & SERMUX_ESC_MASK )
+        transport_send_byte( SERMUX_ESCAPE_CHAR );
+      transport_send_byte( prev_sent & 0xFF );
+      prev_sent = -1;
+      continue;
+    }
+    if( got_esc )
+    {
+      // Got an escape last time, check the char now (with the 5th bit flipped)
+      c ^= SERMUX_ESCAPE_XOR_MASK;
+      if( !mux_special[ c ] )
+      {
+         log_err( "Protocol error: invalid escape sequence\n" );
+         return 0;
+      }
+      got_esc = 0;
+    }
+    if( service_id_in == -1 )
+    {
+      transport_send_byte( SERMUX_FORCE_SID_CHAR );
+      log_msg( "Requested resend of service ID for byte %3d ('%c').\n", c, isprint( c ) ? c : ' ' );
+    }
+    else
+    {
+      u8 data = ( u8 )c;
+      muxh_deliver( &data, 1 );
+    }
+  }
+  return 1;
+}
+
+// Write all the queued data to the service ports and to the transport
+static void muxh_flush_all()
+{
+  unsigned i;
+  u32 drop;
+
+  for( i = 0; i < vport_num; i ++ )
+    if( services[ i ].out.len > 0 && ( drop = muxh_queue_flush( &services[ i ].out, services + i ) ) > 0 )
+    {
+      log_err( "Unable to write to %s\n", services[ i ].pname );
+      stats[ i + service_offset ].dropped += drop;
+    }
+  if( transport_out.len > 0 && muxh_queue_flush( &transport_out, NULL ) > 0 )
+    log_err( "Unable to write to the transport\n" );
+}
+
+// Show the throughput statistics (verbose mode only)
+static void muxh_show_stats()
+{
+  time_t now = time( NULL );
+  unsigned long dt;
+  unsigned i;
+  MUX_STATS *ps;
+
+  if( !verbose_mode || ( dt = ( unsigned long )( now - stats_time ) ) < MUX_STATS_INTERVAL_S )
+    return;
+  for( i = 0; i < NUM_SERVICE_IDS; i ++ )
+  {
+    ps = stats + i;
+    if( ps->bytes_in == 0 && ps->bytes_out == 0 && ps->dropped == 0 )
+      continue;
+    log_msg( "Service %X (%s): in %lu bytes (%lu B/s), out %lu bytes (%lu B/s), dropped %lu bytes\n",
+             i + SERMUX_SERVICE_ID_FIRST,
+             ( int )( i + SERMUX_SERVICE_ID_FIRST ) == rfs_service_id ? "RFS" : i - service_offset < vport_num ? services[ i - service_offset ].pname : "unknown",
+             ps->bytes_in, ps->bytes_in / dt, ps->bytes_out, ps->bytes_out / dt, ps->dropped );
+  }
+  memset( stats, 0, sizeof( stats ) );
+  stats_time = now;
 }
 
 // Transport parser
@@ -154,14 +392,11 @@ int main( int argc, char **argv )
 {
   unsigned i;
   SERVICE_DATA *tservice;
-  int c, prev_sent = -1;
-  int temp;
-  int got_esc = 0;
+  int res;
   char* rfs_dir_name;
   ser_handler *phandlers;
   int selidx;
-  u16 rfs_size = 0;
-  u8 *rfs_ptr;
+  static u8 buf[ MUX_READ_BUF_SIZE ];
 
   // Interpret arguments
   setvbuf( stdout, NULL, _IONBF, 0 );  
@@ -258,118 +493,34 @@ int main( int argc, char **argv )
       return 1;
   }
 
+  for( i = SERMUX_SERVICE_ID_FIRST; i <= SERMUX_SERVICE_ID_LAST; i ++ )
+    mux_special[ i ] = 1;
+  mux_special[ SERMUX_ESCAPE_CHAR ] = mux_special[ SERMUX_FORCE_SID_CHAR ] = 1;
+  stats_time = time( NULL );
+
   log_msg( "Starting service multiplexer on %u port(s)\n", vport_num );
   
-  // Main service thread
+  // Main service thread: read a block of data from one of the ports,
+  // process it, then write all the resulting data to its destination(s)
   while( 1 )
   {
-    if( rfs_size > 0 ) // Response packet from RFS
-    {
-      c = *rfs_ptr ++;
-      rfs_size --;
-      selidx = RFS_PSEUDO_SELIDX;
-    }
-    else
-    {
-      if( ( c = ser_select_byte( phandlers, vport_num + 1, SER_INF_TIMEOUT ) ) == -1 )
-      {
-        log_err( "Error on select, aborting program\n" );
-        return 1;
-      }
-      selidx = c >> 8;
-      c = c & 0xFF;
-    }
-    //log_msg( "Got byte %d from idx %d\n", c, selidx );
-    if( selidx == HND_TRANSPORT_OFFSET ) // Got byte on transport interface
+    if( ( res = ser_select_read( phandlers, vport_num + 1, &selidx, buf, MUX_READ_BUF_SIZE, verbose_mode ? MUX_STATS_INTERVAL_S * 1000 : SER_INF_TIMEOUT ) ) == -1 )
     {
-      // Interpret byte
-      if( c != SERMUX_ESCAPE_CHAR )
-      {
-        if( c >= SERMUX_SERVICE_ID_FIRST && c <= SERMUX_SERVICE_ID_LAST )
-        {
-          log_msg( "Changed service_id_in from %d(%X) to %d(%X).\n", service_id_in, service_id_in, c, c );
-          service_id_in = c;
-        } 
-        else if( c == SERMUX_FORCE_SID_CHAR )
-        {
-          if( prev_sent == -1 )
-          {
-            log_err( "Protocol error: got request to resend service ID when the last char sent was not set.\n" );
-            return 1;
-          }
-          log_msg( "Got request to resend service_id_out %d(%X).\n", service_id_out, service_id_out );
-          // Re-transmit the last data AND the service ID
-          transport_send_byte( service_id_out );
-          if( prev_sent & SERMUX_ESC_MASK )
-            transport_send_byte( SERMUX_ESCAPE_CHAR );
-          transport_send_byte( prev_sent & 0xFF );
-          prev_sent = -1;
-        }          
-        else
-        {
-          if( got_esc )
-          {
-            // Got an escape last time, check the char now (with the 5th bit flipped)
-            c ^= SERMUX_ESCAPE_XOR_MASK;
-            if( c != SERMUX_ESCAPE_CHAR && c != SERMUX_FORCE_SID_CHAR && ( c < SERMUX_SERVICE_ID_FIRST || c > SERMUX_SERVICE_ID_LAST ) )
-            {
-               log_err( "Protocol error: invalid escape sequence\n" );
-               return 1;
-            }
-            got_esc = 0;
-          }  
-          if( service_id_in == -1 )
-          {
-            transport_send_byte( SERMUX_FORCE_SID_CHAR );
-            log_msg( "Requested resend of service ID for byte %3d ('%c').\n", c, isprint( c ) ? c : ' ' );
-          }
-          else
-          {
-            if( service_id_in == rfs_service_id ) // this request is for the RFS server
-            {
-              rfs_mem_read_request_packet( c );
-              if( rfs_mem_has_response() ) // we have a response from the RFS server
-              {
-                rfs_mem_write_response( &rfs_size, &rfs_ptr );                  
-                rfs_mem_start_request(); // initialize the RFS server for a new request  
-              }
-            }
-            else
-            {
-              //log_msg( "Sending byte %d to %s\n", c, services[ service_id_in - SERMUX_SERVICE_ID_FIRST - service_offset ].pname );
-              ser_write_byte( services[ service_id_in - SERMUX_SERVICE_ID_FIRST - service_offset ].fd, c );
-            }
-          }
-        }
-      }
-      else
-        got_esc = 1;                          
+      log_err( "Error on select, aborting program\n" );
+      return 1;
     }
-    else
+    if( res > 0 )
     {
-      // No byte to read, there must be something to send
-      if( selidx == RFS_PSEUDO_SELIDX )
-        temp = SERMUX_SERVICE_ID_FIRST;
-      else        
-        temp = SERMUX_SERVICE_ID_FIRST + selidx - HND_FIRST_VOFFSET + service_offset;
-      prev_sent = c;
-      // Send the service ID first if needed
-      if( temp != service_id_out )
+      if( selidx == HND_TRANSPORT_OFFSET ) // Got data on transport interface
       {
-        log_msg( "Changed service_id_out from %d(%X) to %d(%X).\n", service_id_out, service_id_out, temp, temp );
-        transport_send_byte( temp );
-      }
-      // Then send the actual data byte, escaping it if needed
-      if( c == SERMUX_ESCAPE_CHAR || c == SERMUX_FORCE_SID_CHAR || ( c >= SERMUX_SERVICE_ID_FIRST && c <= SERMUX_SERVICE_ID_LAST ) )
-      {
-        transport_send_byte( SERMUX_ESCAPE_CHAR );
-        transport_send_byte( ( u8 )c ^ SERMUX_ESCAPE_XOR_MASK );
-        prev_sent = SERMUX_ESC_MASK | ( ( u8 )c ^ SERMUX_ESCAPE_XOR_MASK );
+        if( muxh_from_transport( buf, res ) == 0 )
+          return 1;
       }
-      else
-        transport_send_byte( c );
-      service_id_out = temp;
+      else // Got data on a service port, send it to the transport
+        muxh_send_service( SERMUX_SERVICE_ID_FIRST + selidx - HND_FIRST_VOFFSET + service_offset, buf, res );
+      muxh_flush_all();
     }
+    muxh_show_stats();
   }
 
   return 0;
@@ -11,6 +11,9 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 #include "log.h"
 
 // Open the serial port
@@ -47,6 +50,12 @@ static u32 ser_baud_to_id( u32 baud )
     BAUDCASE( 57600 );
     BAUDCASE( 115200 );
     BAUDCASE( 230400 );
+#ifdef B460800
+    BAUDCASE( 460800 );
+#endif
+#ifdef B921600
+    BAUDCASE( 921600 );
+#endif
   }
   return 0;
 }
@@ -178,11 +187,12 @@ int ser_read_byte( ser_handler id, u32 timeout )
 // Write up to the specified number of bytes, return bytes actually written
 u32 ser_write( ser_handler id, const u8 *src, u32 size )
 {
-  u32 res;
+  ssize_t res;
   
-  res = ( u32 )write( ( int )id, src, size );
+  if( ( res = write( ( int )id, src, size ) ) < 0 )
+    return 0;
   tcdrain( ( int )id );
-  return res;
+  return ( u32 )res;
 }
 
 // Write a byte to the serial port
@@ -228,3 +238,121 @@ int ser_select_byte( ser_handler *pobjects, unsigned nobjects, int timeout )
   return res;
 }
 
+// Wait for data on the specified handler(s) and read as much as possible
+// (up to 'maxsize' bytes) from one of them. Returns the number of bytes
+// read (the object ID is returned in 'pidx'), 0 for timeout or -1 for error.
+// On Linux this uses an epoll instance which is kept between calls (as long
+// as the list of handlers doesn't change) and the ready handlers are served
+// in order before waiting again.
+#ifdef __linux__
+
+#define SER_EPOLL_MAX_OBJECTS   16
+
+static int ser_epoll_fd = -1;
+static ser_handler ser_epoll_objects[ SER_EPOLL_MAX_OBJECTS ];
+static unsigned ser_epoll_nobjects;
+static struct epoll_event ser_epoll_events[ SER_EPOLL_MAX_OBJECTS ];
+static int ser_epoll_nready, ser_epoll_crt;
+
+static int ser_epoll_setup( ser_handler *pobjects, unsigned nobjects )
+{
+  struct epoll_event ev;
+  unsigned i;
+
+  if( ser_epoll_fd != -1 && nobjects == ser_epoll_nobjects &&
+      !memcmp( pobjects, ser_epoll_objects, nobjects * sizeof( ser_handler ) ) )
+    return 0;
+  if( nobjects > SER_EPOLL_MAX_OBJECTS )
+    return -1;
+  if( ser_epoll_fd != -1 )
+    close( ser_epoll_fd );
+  ser_epoll_nready = ser_epoll_crt = 0;
+  ser_epoll_nobjects = 0;
+  if( ( ser_epoll_fd = epoll_create( SER_EPOLL_MAX_OBJECTS ) ) == -1 )
+    return -1;
+  for( i = 0; i < nobjects; i ++ )
+  {
+    memset( &ev, 0, sizeof( ev ) );
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    if( epoll_ctl( ser_epoll_fd, EPOLL_CTL_ADD, pobjects[ i ], &ev ) == -1 )
+    {
+      close( ser_epoll_fd );
+      ser_epoll_fd = -1;
+      return -1;
+    }
+  }
+  memcpy( ser_epoll_objects, pobjects, nobjects * sizeof( ser_handler ) );
+  ser_epoll_nobjects = nobjects;
+  return 0;
+}
+
+int ser_select_read( ser_handler *pobjects, unsigned nobjects, int *pidx, u8 *dest, u32 maxsize, u32 timeout )
+{
+  ssize_t res;
+  int idx;
+
+  if( ser_epoll_setup( pobjects, nobjects ) == -1 )
+    return -1;
+  while( 1 )
+  {
+    if( ser_epoll_crt == ser_epoll_nready )
+    {
+      ser_epoll_crt = 0;
+      ser_epoll_nready = epoll_wait( ser_epoll_fd, ser_epoll_events, SER_EPOLL_MAX_OBJECTS, timeout == SER_INF_TIMEOUT ? -1 : ( int )timeout );
+      if( ser_epoll_nready <= 0 )
+      {
+        res = ser_epoll_nready == -1 && errno != EINTR ? -1 : 0;
+        ser_epoll_nready = 0;
+        return ( int )res;
+      }
+    }
+    idx = ser_epoll_events[ ser_epoll_crt ++ ].data.u32;
+    if( ( res = read( pobjects[ idx ], dest, maxsize ) ) > 0 )
+    {
+      *pidx = idx;
+      return ( int )res;
+    }
+    if( res == 0 || ( errno != EAGAIN && errno != EINTR ) )
+      return -1;
+  }
+}
+
+#else // #ifdef __linux__
+
+int ser_select_read( ser_handler *pobjects, unsigned nobjects, int *pidx, u8 *dest, u32 maxsize, u32 timeout )
+{
+  static unsigned first;
+  int maxfd = -1, res;
+  unsigned i, idx;
+  fd_set readfs;
+  struct timeval tv;
+
+  FD_ZERO( &readfs );
+  for( i = 0; i < nobjects; i ++ )
+  {
+    FD_SET( pobjects[ i ], &readfs );
+    if( pobjects[ i ] > maxfd )
+      maxfd = pobjects[ i ];
+  }
+  tv.tv_sec = timeout / 1000;
+  tv.tv_usec = ( timeout % 1000 ) * 1000;
+  if( ( res = select( maxfd + 1, &readfs, NULL, NULL, timeout == SER_INF_TIMEOUT ? NULL : &tv ) ) <= 0 )
+    return res == -1 && errno != EINTR ? -1 : 0;
+  // Don't always start with the same handler
+  for( i = 0; i < nobjects; i ++ )
+  {
+    idx = ( first + i ) % nobjects;
+    if( FD_ISSET( pobjects[ idx ], &readfs ) )
+    {
+      first = idx + 1;
+      if( ( res = read( pobjects[ idx ], dest, maxsize ) ) <= 0 )
+        return res == -1 && ( errno == EAGAIN || errno == EINTR ) ? 0 : -1;
+      *pidx = idx;
+      return res;
+    }
+  }
+  return 0;
+}
+
+#endif // #ifdef __linux__
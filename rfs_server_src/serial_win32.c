@@ -285,3 +285,19 @@ int ser_select_byte( ser_handler *pobjects, unsigned nobjects, int timeout )
   return res;
 }
 
+// Wait for data on the specified handler(s) and read as much as possible
+// (up to 'maxsize' bytes) from one of them. Returns the number of bytes
+// read (the object ID is returned in 'pidx'), 0 for timeout or -1 for error.
+int ser_select_read( ser_handler *pobjects, unsigned nobjects, int *pidx, u8 *dest, u32 maxsize, u32 timeout )
+{
+  int res;
+
+  if( maxsize == 0 )
+    return 0;
+  if( ( res = ser_select_byte( pobjects, nobjects, timeout ) ) == -1 )
+    return 0;
+  *pidx = res >> 8;
+  dest[ 0 ] = ( u8 )res;
+  // Get the rest of the data without waiting
+  return 1 + ser_read( pobjects[ *pidx ], dest + 1, maxsize - 1, SER_NO_TIMEOUT );
+}
@@ -52,6 +52,10 @@ static int xmodem_recv( timer_data_type timeout )
 
 static void term_out( u8 data )
 {
+#ifdef BUILD_CON_GENERIC
+  // Send the buffered console output first
+  std_flush();
+#endif
   platform_uart_send( CON_UART_ID, data );
 }
 
@@ -175,6 +179,41 @@ static int uart_recv( timer_data_type to )
   return platform_uart_recv( CON_UART_ID, CON_TIMER_ID, to );
 }
 
+#if defined( BUILD_CON_GENERIC ) && STD_TX_BUF_SIZE > 0 && defined( BUILD_C_INT_HANDLERS ) && defined( INT_UART_TX ) &&\
+    defined( CON_UART_ID ) && ( CON_UART_ID < SERMUX_SERVICE_ID_FIRST ) && ( CON_UART_ID != CDC_UART_ID )
+#define CON_UART_TX_INT
+
+static elua_int_c_handler prev_uart_tx_handler;
+
+// Send the console output buffer from the UART TX interrupt
+static void uart_tx_inthandler( elua_int_resnum resnum )
+{
+  int c;
+
+  if( resnum == CON_UART_ID )
+  {
+    if( ( c = std_tx_get_char() ) == -1 )
+    {
+      platform_cpu_set_interrupt( INT_UART_TX, CON_UART_ID, PLATFORM_CPU_DISABLE );
+      // Data might have been added to the buffer before the interrupt was disabled
+      if( ( c = std_tx_get_char() ) != -1 )
+        platform_cpu_set_interrupt( INT_UART_TX, CON_UART_ID, PLATFORM_CPU_ENABLE );
+    }
+    if( c != -1 )
+      platform_s_uart_send( CON_UART_ID, c );
+  }
+
+  // Chain to previous handler
+  if( prev_uart_tx_handler != NULL )
+    prev_uart_tx_handler( resnum );
+}
+
+static void uart_tx_start(void)
+{
+  platform_cpu_set_interrupt( INT_UART_TX, CON_UART_ID, PLATFORM_CPU_ENABLE );
+}
+#endif
+
 void cmn_platform_init(void)
 {
 #ifdef BUILD_INT_HANDLERS
@@ -209,6 +248,11 @@ void cmn_platform_init(void)
   // Set the send/recv functions
   std_set_send_func( uart_send );
   std_set_get_func( uart_recv );
+#ifdef CON_UART_TX_INT
+  // Send the buffered console output in background
+  prev_uart_tx_handler = elua_int_set_c_handler( INT_UART_TX, uart_tx_inthandler );
+  std_set_tx_start_func( uart_tx_start );
+#endif
 
 #ifdef BUILD_XMODEM
   // Initialize XMODEM
@@ -285,6 +329,24 @@ int platform_spi_exists( unsigned id )
   return id < NUM_SPI;
 }
 
+#if defined( NUM_SPI ) && NUM_SPI > 0 && !defined( PLATFORM_HAS_SPI_TRANSFER )
+// Generic SPI block transfer built on top of platform_spi_send_recv. Platforms
+// that can do better (DMA, direct register access) should define
+// PLATFORM_HAS_SPI_TRANSFER in their platform_generic.h and implement their
+// own platform_spi_transfer.
+void platform_spi_transfer( unsigned id, const u8 *out, u8 *in, u32 len )
+{
+  u8 data;
+
+  while( len -- )
+  {
+    data = ( u8 )platform_spi_send_recv( id, out ? *out ++ : 0xFF );
+    if( in )
+      *in ++ = data;
+  }
+}
+#endif // #if defined( NUM_SPI ) && NUM_SPI > 0 && !defined( PLATFORM_HAS_SPI_TRANSFER )
+
 // ****************************************************************************
 // PWM functions
 
@@ -301,6 +363,17 @@ u32 platform_cpu_get_frequency(void)
   return CPU_FREQUENCY;
 }
 
+#ifndef PLATFORM_HAS_CPU_IDLE
+// Wait for an interrupt, but for no longer than 'us' microseconds (called
+// with the global interrupts disabled when there's nothing to do). Platforms
+// that can put the CPU to sleep should define PLATFORM_HAS_CPU_IDLE in their
+// platform_generic.h and implement their own platform_cpu_idle; by default
+// it returns immediately.
+void platform_cpu_idle( timer_data_type us )
+{
+}
+#endif // #ifndef PLATFORM_HAS_CPU_IDLE
+
 // ****************************************************************************
 // ADC functions
 
@@ -401,6 +474,46 @@ int platform_i2c_exists( unsigned id )
 #endif
 }
 
+#if defined( NUM_I2C ) && NUM_I2C > 0 && !defined( PLATFORM_HAS_I2C_TRANSFER )
+// Generic I2C transfer (write and/or read in a single transaction) built on
+// top of the byte oriented functions. Platforms that can do better (DMA,
+// hardware sequencers) should define PLATFORM_HAS_I2C_TRANSFER in their
+// platform_generic.h and implement their own platform_i2c_transfer.
+int platform_i2c_transfer( unsigned id, u16 address, const u8 *wdata, u32 wsize, u8 *rdata, u32 rsize )
+{
+  u32 i;
+  int data;
+
+  platform_i2c_send_start( id );
+  if( wsize > 0 || rsize == 0 )
+  {
+    if( !platform_i2c_send_address( id, address, PLATFORM_I2C_DIRECTION_TRANSMITTER ) )
+      goto error;
+    for( i = 0; i < wsize; i ++ )
+      if( !platform_i2c_send_byte( id, wdata[ i ] ) )
+        goto error;
+    if( rsize > 0 ) // repeated start for the read part
+      platform_i2c_send_start( id );
+  }
+  if( rsize > 0 )
+  {
+    if( !platform_i2c_send_address( id, address, PLATFORM_I2C_DIRECTION_RECEIVER ) )
+      goto error;
+    for( i = 0; i < rsize; i ++ )
+    {
+      if( ( data = platform_i2c_recv_byte( id, i < rsize - 1 ) ) == -1 )
+        goto error;
+      rdata[ i ] = ( u8 )data;
+    }
+  }
+  platform_i2c_send_stop( id );
+  return 1;
+error:
+  platform_i2c_send_stop( id );
+  return 0;
+}
+#endif // #if defined( NUM_I2C ) && NUM_I2C > 0 && !defined( PLATFORM_HAS_I2C_TRANSFER )
+
 // ****************************************************************************
 // Interrupt support
 #ifdef BUILD_INT_HANDLERS
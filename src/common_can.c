@@ -0,0 +1,190 @@
+// Common implementation: CAN receive buffer and software acceptance filters
+
+#include "platform.h"
+#include "platform_conf.h"
+#include "common.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( NUM_CAN ) && NUM_CAN > 0
+
+// Maximum size of the receive buffer (log2 of the number of frames)
+#define CAN_MAX_LOG2SIZE          10
+
+// A received CAN frame
+typedef struct
+{
+  u32 canid;
+  u8 idtype;
+  u8 len;
+  u8 data[ PLATFORM_CAN_MAXLEN ];
+} can_frame;
+
+// Acceptance filter: a frame is accepted if ( frame_id & mask ) == ( canid & mask )
+typedef struct
+{
+  u32 canid;
+  u32 mask;
+  s8 idtype;                    // ELUA_CAN_ID_xxx or PLATFORM_CAN_ID_ANY
+} can_filter;
+
+// Receive data for a CAN interface
+// The frames are added to the buffer by the RX interrupt handler (or when
+// the buffer is read, if the RX interrupt is not available) and removed by
+// platform_can_recv. The read and write pointers are free running and each
+// one is changed by a single side, so no locking is needed.
+typedef struct
+{
+  can_frame *frames;
+  u16 mask;
+  volatile u16 wptr, rptr;
+  volatile u32 dropped;
+  u8 int_mode;                  // 1 if the buffer is filled by the RX interrupt
+  volatile u8 nfilters;
+  can_filter filters[ PLATFORM_CAN_MAX_FILTERS ];
+} can_rx_data;
+
+static can_rx_data can_rx[ NUM_CAN ];
+
+// ****************************************************************************
+// Helpers
+
+// Check a frame against the acceptance filters of an interface
+static int canh_accept( const can_rx_data *prx, u32 canid, u8 idtype )
+{
+  const can_filter *pf = prx->filters;
+  unsigned i;
+
+  if( prx->nfilters == 0 )
+    return 1;
+  for( i = 0; i < prx->nfilters; i ++, pf ++ )
+    if( ( pf->idtype == PLATFORM_CAN_ID_ANY || pf->idtype == idtype ) && ( ( canid ^ pf->canid ) & pf->mask ) == 0 )
+      return 1;
+  return 0;
+}
+
+// Move all the pending frames from the hardware to the receive buffer
+static void canh_fill_buffer( unsigned id )
+{
+  can_rx_data *prx = can_rx + id;
+  can_frame temp, *pf;
+  int full;
+
+  while( 1 )
+  {
+    full = ( u16 )( prx->wptr - prx->rptr ) > prx->mask;
+    pf = full ? &temp : prx->frames + ( prx->wptr & prx->mask );
+    if( platform_s_can_recv( id, &pf->canid, &pf->idtype, &pf->len, pf->data ) != PLATFORM_OK )
+      break;
+    if( !canh_accept( prx, pf->canid, pf->idtype ) )
+      continue;
+    if( full )
+      prx->dropped ++;
+    else
+      prx->wptr ++;
+  }
+}
+
+#if defined( BUILD_C_INT_HANDLERS ) && defined( INT_CAN_RX )
+static elua_int_c_handler prev_can_rx_handler;
+
+static void cmn_can_rx_inthandler( elua_int_resnum resnum )
+{
+  if( resnum < NUM_CAN && can_rx[ resnum ].int_mode )
+    canh_fill_buffer( resnum );
+
+  // Chain to previous handler
+  if( prev_can_rx_handler != NULL )
+    prev_can_rx_handler( resnum );
+}
+#endif // #if defined( BUILD_C_INT_HANDLERS ) && defined( INT_CAN_RX )
+
+// ****************************************************************************
+// CAN functions
+
+int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
+{
+  can_rx_data *prx = can_rx + id;
+  const can_frame *pf;
+
+  if( prx->frames == NULL ) // not buffered, skip the frames that don't pass the filters
+  {
+    while( platform_s_can_recv( id, canid, idtype, len, data ) == PLATFORM_OK )
+      if( canh_accept( prx, *canid, *idtype ) )
+        return PLATFORM_OK;
+    return PLATFORM_UNDERFLOW;
+  }
+  if( !prx->int_mode )
+    canh_fill_buffer( id );
+  if( prx->rptr == prx->wptr )
+    return PLATFORM_UNDERFLOW;
+  pf = prx->frames + ( prx->rptr & prx->mask );
+  *canid = pf->canid;
+  *idtype = pf->idtype;
+  *len = pf->len;
+  memcpy( data, pf->data, pf->len );
+  prx->rptr ++;
+  return PLATFORM_OK;
+}
+
+int platform_can_set_buffer( unsigned id, unsigned log2size )
+{
+  can_rx_data *prx = can_rx + id;
+
+  if( log2size > CAN_MAX_LOG2SIZE )
+    return PLATFORM_ERR;
+#if defined( BUILD_C_INT_HANDLERS ) && defined( INT_CAN_RX )
+  // Stop the RX interrupt while the buffer is changed
+  if( prx->int_mode )
+  {
+    platform_cpu_set_interrupt( INT_CAN_RX, id, PLATFORM_CPU_DISABLE );
+    prx->int_mode = 0;
+  }
+#endif
+  free( prx->frames );
+  prx->frames = NULL;
+  prx->wptr = prx->rptr = 0;
+  if( log2size == 0 )
+    return PLATFORM_OK;
+  if( ( prx->frames = ( can_frame* )malloc( sizeof( can_frame ) << log2size ) ) == NULL )
+    return PLATFORM_ERR;
+  prx->mask = ( 1 << log2size ) - 1;
+#if defined( BUILD_C_INT_HANDLERS ) && defined( INT_CAN_RX )
+  // Setup our C handler
+  if( elua_int_get_c_handler( INT_CAN_RX ) != cmn_can_rx_inthandler )
+    prev_can_rx_handler = elua_int_set_c_handler( INT_CAN_RX, cmn_can_rx_inthandler );
+  // Enable the CAN RX interrupt (if this fails the buffer is filled when it is read)
+  prx->int_mode = 1;
+  if( platform_cpu_set_interrupt( INT_CAN_RX, id, PLATFORM_CPU_ENABLE ) < 0 )
+    prx->int_mode = 0;
+#endif
+  return PLATFORM_OK;
+}
+
+int platform_can_add_filter( unsigned id, u32 canid, u32 mask, int idtype )
+{
+  can_rx_data *prx = can_rx + id;
+  can_filter *pf;
+
+  if( prx->nfilters == PLATFORM_CAN_MAX_FILTERS )
+    return PLATFORM_ERR;
+  // Write the filter first, then make it visible to the RX handler
+  pf = prx->filters + prx->nfilters;
+  pf->canid = canid;
+  pf->mask = mask;
+  pf->idtype = ( s8 )idtype;
+  prx->nfilters ++;
+  return PLATFORM_OK;
+}
+
+void platform_can_clear_filters( unsigned id )
+{
+  can_rx[ id ].nfilters = 0;
+}
+
+u32 platform_can_get_dropped( unsigned id )
+{
+  return can_rx[ id ].dropped;
+}
+
+#endif // #if defined( NUM_CAN ) && NUM_CAN > 0
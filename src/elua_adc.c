@@ -7,6 +7,7 @@
 #include "platform.h"
 #include <stdlib.h>
 #include "utils.h"
+#include "common.h"
 
 #define SMOOTH_REALSIZE( s ) ( ( u16 )1 << ( s->logsmoothlen ) )
 
@@ -112,6 +113,9 @@ void adc_init_ch_state( unsigned id )
   s->smooth_ready = 0;
   s->reqsamples = 0;
   s->freerunning = 0;
+  s->notify_enabled = 0;
+  s->notify_armed = 1;
+  s->notifysamples = 0;
   
   s->id = id;
   s->logsmoothlen = 0;
@@ -264,10 +268,46 @@ u16 adc_get_processed_sample( unsigned id )
       if ( s->reqsamples > 0)
         s->reqsamples -- ;
     }
+    // Re-arm the "samples ready" notification once the buffer was drained
+    if( s->notifysamples > 0 && adc_samples_available( id ) < s->notifysamples )
+      s->notify_armed = 1;
   }
   return sample;
 }
 
+// Copy up to 'count' processed samples into 'dest', an array of elements 
+// that are 'dsize' bytes wide (1, 2 or 4). Samples go through the same
+// smoothing path as adc_get_processed_sample, but no Lua objects are created.
+// Returns the number of samples actually copied.
+u16 adc_read_samples( unsigned id, void *dest, u16 count, u8 dsize )
+{
+  u16 i, avail;
+  u16 sample;
+
+  avail = adc_samples_available( id );
+  if( count > avail )
+    count = avail;
+  for( i = 0; i < count; i ++ )
+  {
+    sample = adc_get_processed_sample( id );
+    switch( dsize )
+    {
+      case 1:
+        ( ( u8* )dest )[ i ] = ( u8 )sample;
+        break;
+
+      case 2:
+        ( ( u16* )dest )[ i ] = sample;
+        break;
+
+      case 4:
+        ( ( u32* )dest )[ i ] = sample;
+        break;
+    }
+  }
+  return count;
+}
+
 // Zero out and reset smoothing buffer
 void adc_flush_smoothing( unsigned id )
 {
@@ -315,5 +355,69 @@ u16 adc_wait_samples( unsigned id, unsigned samples )
   return adc_samples_available( id );
 }
 
+// ****************************************************************************
+// "Samples ready" notification (INT_ADC_READY)
+// The platform ADC interrupt handler calls adc_check_notify after buffering
+// new samples. When the number of available samples reaches the threshold set
+// by adc_set_notify, INT_ADC_READY is fired once, then it is re-armed only 
+// after the buffer is drained below the threshold. This way a Lua handler can
+// pull a whole block of samples per interrupt instead of polling.
+
+// Set the notification threshold (0 disables notifications)
+void adc_set_notify( unsigned id, u16 count )
+{
+  elua_adc_ch_state *s = adc_get_ch_state( id );
+  int old_status;
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  s->notifysamples = count;
+  s->notify_armed = 1;
+  platform_cpu_set_global_interrupts( old_status );
+}
+
+void adc_check_notify( unsigned id )
+{
+#if defined( BUILD_INT_HANDLERS ) && ( INT_ADC_READY != ELUA_INT_INVALID_INTERRUPT )
+  elua_adc_ch_state *s = adc_get_ch_state( id );
+
+  if( s->notify_enabled && s->notify_armed && s->notifysamples > 0 &&
+      adc_samples_available( id ) >= s->notifysamples )
+  {
+    s->notify_armed = 0;
+    cmn_int_handler( INT_ADC_READY, id );
+  }
+#endif
+}
+
+int adc_int_ready_set_status( elua_int_resnum resnum, int status )
+{
+  elua_adc_ch_state *s;
+  int prev;
+
+  if( resnum >= NUM_ADC )
+    return PLATFORM_INT_BAD_RESNUM;
+  s = adc_get_ch_state( resnum );
+  prev = s->notify_enabled;
+  s->notify_enabled = status == PLATFORM_CPU_ENABLE ? 1 : 0;
+  return prev;
+}
+
+int adc_int_ready_get_status( elua_int_resnum resnum )
+{
+  if( resnum >= NUM_ADC )
+    return PLATFORM_INT_BAD_RESNUM;
+  return adc_get_ch_state( resnum )->notify_enabled;
+}
+
+int adc_int_ready_get_flag( elua_int_resnum resnum, int clear )
+{
+  elua_adc_ch_state *s;
+
+  if( resnum >= NUM_ADC )
+    return PLATFORM_INT_BAD_RESNUM;
+  s = adc_get_ch_state( resnum );
+  return s->notifysamples > 0 && adc_samples_available( resnum ) >= s->notifysamples;
+}
+
 #endif
 
@@ -0,0 +1,100 @@
+// Word-at-a-time Internet checksum (RFC 1071)
+// Used by the uIP stack when UIP_ARCH_CHKSUM is enabled (see elua_uip.c)
+
+#include "type.h"
+
+// The one's complement sum is byte order independent, so the data is summed
+// as native 32-bit words into a 64-bit accumulator (no carry handling in the
+// inner loop) and the result is folded and byte swapped only once at the end.
+// The returned value has the same meaning as the one returned by uIP's
+// portable chksum(): the sum of the big endian 16-bit words of 'data' added
+// to 'sum', in host byte order.
+
+#ifdef ELUA_ENDIAN_LITTLE
+#define CHKSUM_NATIVE_TO_BE( x )  ( u16 )( ( ( x ) << 8 ) | ( ( x ) >> 8 ) )
+#else
+#define CHKSUM_NATIVE_TO_BE( x )  ( u16 )( x )
+#endif
+
+// Portable version for odd start addresses (rare, uIP headers are 16-bit aligned)
+static u16 chksum_bytes( u16 sum, const u8 *data, u16 len )
+{
+  u32 acc = sum;
+
+  while( len >= 2 )
+  {
+    acc += ( ( u16 )data[ 0 ] << 8 ) | data[ 1 ];
+    data += 2;
+    len -= 2;
+  }
+  if( len )
+    acc += ( u16 )data[ 0 ] << 8;
+  acc = ( acc >> 16 ) + ( acc & 0xFFFF );
+  acc = ( acc >> 16 ) + ( acc & 0xFFFF );
+  return ( u16 )acc;
+}
+
+u16 elua_chksum( u16 sum, const u8 *data, u16 len )
+{
+  u64 acc = 0;
+  const u32 *pw;
+  u16 t;
+
+  if( ( ( unsigned long )data & 1 ) != 0 )
+    return chksum_bytes( sum, data, len );
+  // Bring the pointer to a 32-bit boundary
+  if( ( ( unsigned long )data & 2 ) != 0 && len >= 2 )
+  {
+    acc += *( const u16* )data;
+    data += 2;
+    len -= 2;
+  }
+  // Main loop: 32 bytes per iteration
+  pw = ( const u32* )data;
+  while( len >= 32 )
+  {
+    acc += pw[ 0 ];
+    acc += pw[ 1 ];
+    acc += pw[ 2 ];
+    acc += pw[ 3 ];
+    acc += pw[ 4 ];
+    acc += pw[ 5 ];
+    acc += pw[ 6 ];
+    acc += pw[ 7 ];
+    pw += 8;
+    len -= 32;
+  }
+  while( len >= 4 )
+  {
+    acc += *pw ++;
+    len -= 4;
+  }
+  data = ( const u8* )pw;
+  if( len >= 2 )
+  {
+    acc += *( const u16* )data;
+    data += 2;
+    len -= 2;
+  }
+  if( len )
+  {
+    // Trailing byte, padded with a zero byte in network order
+#ifdef ELUA_ENDIAN_LITTLE
+    acc += data[ 0 ];
+#else
+    acc += ( u16 )data[ 0 ] << 8;
+#endif
+  }
+  // Fold the accumulator to 16 bits
+  acc = ( acc >> 32 ) + ( acc & 0xFFFFFFFFUL );
+  acc = ( acc >> 32 ) + ( acc & 0xFFFFFFFFUL );
+  acc = ( acc >> 16 ) + ( acc & 0xFFFF );
+  acc = ( acc >> 16 ) + ( acc & 0xFFFF );
+  t = ( u16 )acc;
+  t = CHKSUM_NATIVE_TO_BE( t );
+  // Add to the initial sum (end-around carry)
+  sum += t;
+  if( sum < t )
+    sum ++;
+  return sum;
+}
@@ -18,6 +18,8 @@ static volatile u8 elua_int_read_idx, elua_int_write_idx;
 static elua_int_element elua_int_queue[ 1 << PLATFORM_INT_QUEUE_LOG_SIZE ];
 // Interrupt enabled/disabled flags
 static u32 elua_int_flags[ LUA_INT_MAX_SOURCES / 32 ];
+// Notification function (used by the scheduler)
+static elua_int_notify_func elua_int_notify;
 
 // Masking for read/write indexes
 #define INT_IDX_SHIFT                   ( PLATFORM_INT_QUEUE_LOG_SIZE )
@@ -36,6 +38,8 @@ static void elua_int_hook( lua_State *L, lua_Debug *ar )
 
   if( elua_int_is_enabled( crt.id ) )
   {
+    if( elua_int_notify )
+      elua_int_notify( crt.id, crt.resnum );
     // Call Lua handler
     // Get interrupt handler table
     lua_rawgeti( L, LUA_REGISTRYINDEX, LUA_INT_HANDLER_KEY ); // inttable
@@ -87,6 +91,23 @@ int elua_int_add( elua_int_id inttype, elua_int_resnum resnum )
   return PLATFORM_OK;
 }
 
+// Dispatch all the queued interrupts now (instead of waiting for the Lua hook)
+// Used by code that waits for interrupts without running Lua code
+void elua_int_poll( lua_State *L )
+{
+  while( elua_int_queue[ elua_int_read_idx ].id != ELUA_INT_EMPTY_SLOT )
+    elua_int_hook( L, NULL );
+}
+
+// Set the interrupt notification function, returns the previous one
+elua_int_notify_func elua_int_set_notify( elua_int_notify_func pfunc )
+{
+  elua_int_notify_func crtfunc = elua_int_notify;
+
+  elua_int_notify = pfunc;
+  return crtfunc;
+}
+
 // Enable the given interrupt
 void elua_int_enable( elua_int_id inttype )
 {
@@ -151,6 +172,15 @@ int elua_int_add( elua_int_id inttype, elua_int_resnum resnum )
   return PLATFORM_ERR;
 }
 
+void elua_int_poll( lua_State *L )
+{
+}
+
+elua_int_notify_func elua_int_set_notify( elua_int_notify_func pfunc )
+{
+  return NULL;
+}
+
 #endif // #ifdef BUILD_LUA_INT_HANDLERS
 
 // ****************************************************************************
@@ -10,6 +10,7 @@
 #include "platform.h"
 #include "diskio.h"
 #include "mmcfs.h"
+#include <stddef.h>
 
 #ifndef MMCFS_NUM_CARDS
 #define NUM_CARDS             1
@@ -105,11 +106,12 @@ BYTE rcvr_spi (BYTE id)
 }
 
 
-static
-void rcvr_spi_m (BYTE id, BYTE *dst)
-{
-    *dst = rcvr_spi( id );
-}
+/*-----------------------------------------------------------------------*/
+/* Transmit/receive a data block via SPI  (Platform dependent)           */
+/*-----------------------------------------------------------------------*/
+
+#define xmit_spi_m( id, src, cnt )  platform_spi_transfer( mmcfs_spi_nums[ id ], src, NULL, cnt )
+#define rcvr_spi_m( id, dst, cnt )  platform_spi_transfer( mmcfs_spi_nums[ id ], NULL, dst, cnt )
 
 /*-----------------------------------------------------------------------*/
 /* Wait for card ready                                                   */
@@ -225,10 +227,7 @@ BOOL rcvr_datablock (
               platform_timer_get_diff_crt( PLATFORM_TIMER_SYS_ID, Timer1 ) < 100000 );
     if(token != 0xFE) return FALSE;    /* If not valid data token, retutn with error */
 
-    do {                            /* Receive the data block into buffer */
-        rcvr_spi_m(id, buff++);
-        rcvr_spi_m(id, buff++);
-    } while (btr -= 2);
+    rcvr_spi_m(id, buff, btr);        /* Receive the data block into buffer */
     rcvr_spi(id);                        /* Discard CRC */
     rcvr_spi(id);
 
@@ -249,18 +248,14 @@ BOOL xmit_datablock (
     BYTE token            /* Data/Stop token */
 )
 {
-    BYTE resp, wc;
+    BYTE resp;
 
 
     if (wait_ready(id) != 0xFF) return FALSE;
 
     xmit_spi(id,token);                    /* Xmit data token */
     if (token != 0xFD) {    /* Is data token */
-        wc = 0;
-        do {                            /* Xmit the 512 byte data block to MMC */
-            xmit_spi(id,*buff++);
-            xmit_spi(id,*buff++);
-        } while (--wc);
+        xmit_spi_m(id, buff, 512);        /* Xmit the 512 byte data block to MMC */
         xmit_spi(id,0xFF);                    /* CRC (Dummy) */
         xmit_spi(id,0xFF);
         resp = rcvr_spi(id);                /* Reveive data response */
@@ -0,0 +1,442 @@
+// Lua VM profiler
+// Counts the executed opcodes and measures the time spent in each Lua and C
+// function (using the system timer). The time is recorded per call path (a
+// call tree), which gives both the flat profile and the folded stacks.
+
+#include "platform_conf.h"
+#ifdef BUILD_LUA_PROFILER
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lrotable.h"
+#include "lobject.h"
+#include "lopcodes.h"
+#include "lstate.h"
+#include "platform.h"
+#include "elua_profile.h"
+#include <string.h>
+
+// Hash table size for the call tree (must be a power of 2)
+#define PROF_HASH_SIZE        ( ELUA_PROFILE_MAX_NODES * 2 )
+#define PROF_HASH_MASK        ( PROF_HASH_SIZE - 1 )
+
+// A function called from a given call path. Node 0 is the root of the tree.
+typedef struct
+{
+  const void *key;              // Proto* for Lua functions (kept alive by the GC, see elua_prof_mark), lua_CFunction for C functions
+  u16 parent;
+  u8 isc;
+  u32 calls;
+  u32 total;                    // total time (us)
+  u32 self;                     // time spent in the function itself (us)
+} PROF_NODE;
+
+// An active call
+typedef struct
+{
+  lua_State *L;
+  int level;                    // CallInfo level of the call in 'L'
+  u16 node;
+  timer_data_type start;
+  u32 child;                    // time spent in the functions called by this one
+} PROF_FRAME;
+
+int elua_prof_active;
+u32 elua_prof_opcodes[ NUM_OPCODES ];
+
+static PROF_NODE prof_nodes[ ELUA_PROFILE_MAX_NODES ];
+static u16 prof_hash[ PROF_HASH_SIZE ];
+static unsigned prof_num_nodes;
+static PROF_FRAME prof_frames[ ELUA_PROFILE_MAX_DEPTH ];
+static unsigned prof_depth;
+static u32 prof_lost;
+
+#if LUA_OPTIMIZE_MEMORY == 2
+extern const luaR_entry base_funcs_list[];
+#endif
+extern const luaR_table lua_rotable[];
+
+// ****************************************************************************
+// Call tree
+
+#define profh_level( L )      ( ( int )( ( L )->ci - ( L )->base_ci ) )
+
+static u32 profh_elapsed( timer_data_type start )
+{
+  timer_data_type now = platform_timer_read_sys();
+
+  if( now >= start )
+    return ( u32 )( now - start );
+  return ( u32 )( now + ( PLATFORM_TIMER_SYS_MAX - start ) + 1 );
+}
+
+// Find the child of 'parent' for the given function (create it if needed)
+// Returns 0 if the tree is full
+static unsigned profh_get_node( unsigned parent, const void *key, int isc )
+{
+  unsigned h = ( ( ( unsigned long )key >> 2 ) ^ ( parent * 31 ) ) & PROF_HASH_MASK;
+  PROF_NODE *pn;
+
+  while( prof_hash[ h ] != 0 )
+  {
+    pn = prof_nodes + prof_hash[ h ];
+    if( pn->key == key && pn->parent == parent )
+      return prof_hash[ h ];
+    h = ( h + 1 ) & PROF_HASH_MASK;
+  }
+  if( prof_num_nodes == ELUA_PROFILE_MAX_NODES )
+    return 0;
+  pn = prof_nodes + prof_num_nodes;
+  pn->key = key;
+  pn->parent = parent;
+  pn->isc = isc;
+  prof_hash[ h ] = prof_num_nodes;
+  return prof_num_nodes ++;
+}
+
+// Remove the active call on top of the stack and account its time
+static void profh_pop()
+{
+  PROF_FRAME *pf = prof_frames + -- prof_depth;
+  PROF_NODE *pn = prof_nodes + pf->node;
+  u32 elapsed = profh_elapsed( pf->start );
+
+  pn->total += elapsed;
+  pn->self += elapsed > pf->child ? elapsed - pf->child : 0;
+  if( prof_depth > 0 )
+    prof_frames[ prof_depth - 1 ].child += elapsed;
+}
+
+// Remove the calls up to (and including) the call at 'level' in 'L'.
+// Nothing happens if there's no such call (for example a coroutine that
+// was resumed after the profiler was started). The calls of other Lua
+// threads above it are removed too (a coroutine that yielded).
+static void profh_unwind( lua_State *L, int level )
+{
+  int i;
+
+  for( i = prof_depth - 1; i >= 0; i -- )
+  {
+    if( prof_frames[ i ].L != L )
+      continue;
+    if( prof_frames[ i ].level < level )
+      return;
+    if( prof_frames[ i ].level == level )
+      break;
+  }
+  if( i < 0 )
+    return;
+  while( prof_depth > ( unsigned )i )
+    profh_pop();
+}
+
+void elua_prof_enter( lua_State *L, const void *key, int isc )
+{
+  int level = profh_level( L );
+  unsigned node;
+  PROF_FRAME *pf;
+
+  // Calls that were not removed with elua_prof_exit (because of an error)
+  while( prof_depth > 0 && prof_frames[ prof_depth - 1 ].L == L && prof_frames[ prof_depth - 1 ].level >= level )
+    profh_pop();
+  if( prof_depth == ELUA_PROFILE_MAX_DEPTH ||
+      ( node = profh_get_node( prof_depth > 0 ? prof_frames[ prof_depth - 1 ].node : 0, key, isc ) ) == 0 )
+  {
+    prof_lost ++;
+    return;
+  }
+  prof_nodes[ node ].calls ++;
+  pf = prof_frames + prof_depth ++;
+  pf->L = L;
+  pf->level = level;
+  pf->node = node;
+  pf->child = 0;
+  pf->start = platform_timer_read_sys();
+}
+
+void elua_prof_exit( lua_State *L )
+{
+  profh_unwind( L, profh_level( L ) );
+}
+
+// Called after a tail call replaced the frame of the caller with the frame
+// of the callee: the caller returns and the callee takes its place
+void elua_prof_tailcall( lua_State *L )
+{
+  int level = profh_level( L );
+  PROF_FRAME *pf;
+  const void *key;
+  int isc;
+
+  if( prof_depth == 0 )
+    return;
+  pf = prof_frames + prof_depth - 1;
+  if( pf->L != L || pf->level != level + 1 )
+  {
+    profh_unwind( L, level );
+    return;
+  }
+  key = prof_nodes[ pf->node ].key;
+  isc = prof_nodes[ pf->node ].isc;
+  prof_nodes[ pf->node ].calls --;
+  prof_depth --;
+  profh_unwind( L, level );
+  elua_prof_enter( L, key, isc );
+}
+
+void elua_prof_mark( void ( *mark )( const void *p, void *ud ), void *ud )
+{
+  unsigned i;
+
+  for( i = 1; i < prof_num_nodes; i ++ )
+    if( !prof_nodes[ i ].isc )
+      mark( prof_nodes[ i ].key, ud );
+}
+
+void elua_prof_start( void )
+{
+  memset( prof_nodes, 0, sizeof( prof_nodes ) );
+  memset( prof_hash, 0, sizeof( prof_hash ) );
+  memset( elua_prof_opcodes, 0, sizeof( elua_prof_opcodes ) );
+  prof_num_nodes = 1;
+  prof_depth = 0;
+  prof_lost = 0;
+  elua_prof_active = 1;
+}
+
+void elua_prof_stop( void )
+{
+  elua_prof_active = 0;
+  while( prof_depth > 0 )
+    profh_pop();
+}
+
+// ****************************************************************************
+// Reports
+
+// Returns the C function at 'idx' (light function or C closure) or NULL
+static const void* profh_cfunc( lua_State *L, int idx )
+{
+  if( lua_type( L, idx ) == LUA_TLIGHTFUNCTION )
+    return lua_topointer( L, idx );
+  return ( const void* )lua_tocfunction( L, idx );
+}
+
+// Name all the C functions found in the table at 'idx' (called 'tname') in
+// the names table at 'names' (lightuserdata -> name)
+static void profh_name_cfuncs( lua_State *L, int idx, const char *tname, int names )
+{
+  const void *f;
+
+  lua_pushnil( L );
+  while( lua_next( L, idx ) )
+  {
+    if( lua_type( L, -2 ) == LUA_TSTRING && ( f = profh_cfunc( L, -1 ) ) != NULL )
+    {
+      lua_pushlightuserdata( L, ( void* )f );
+      lua_rawget( L, names );
+      if( lua_isnil( L, -1 ) )
+      {
+        lua_pushlightuserdata( L, ( void* )f );
+        if( *tname )
+          lua_pushfstring( L, "%s.%s", tname, lua_tostring( L, -4 ) );
+        else
+          lua_pushvalue( L, -4 );
+        lua_rawset( L, names );
+      }
+      lua_pop( L, 1 );
+    }
+    lua_pop( L, 1 );
+  }
+}
+
+// Push a table with the names of the C functions
+static void profh_push_cnames( lua_State *L )
+{
+  unsigned i;
+  int names;
+
+  luaL_checkstack( L, 10, "profile: stack overflow" );
+  lua_newtable( L );
+  names = lua_gettop( L );
+#if LUA_OPTIMIZE_MEMORY == 2
+  lua_pushrotable( L, ( void* )base_funcs_list );
+  profh_name_cfuncs( L, names + 1, "", names );
+  lua_pop( L, 1 );
+#endif
+  // ROM modules
+  for( i = 0; lua_rotable[ i ].name; i ++ )
+    if( *lua_rotable[ i ].name )
+    {
+      lua_pushrotable( L, ( void* )lua_rotable[ i ].pentries );
+      profh_name_cfuncs( L, names + 1, lua_rotable[ i ].name, names );
+      lua_pop( L, 1 );
+    }
+  // Modules in package.loaded
+  lua_getfield( L, LUA_REGISTRYINDEX, "_LOADED" );
+  if( lua_istable( L, -1 ) )
+  {
+    lua_pushnil( L );
+    while( lua_next( L, names + 1 ) )
+    {
+      if( lua_type( L, -2 ) == LUA_TSTRING && lua_istable( L, -1 ) && !lua_rawequal( L, -1, LUA_GLOBALSINDEX ) )
+        profh_name_cfuncs( L, names + 3, lua_tostring( L, -2 ), names );
+      lua_pop( L, 1 );
+    }
+  }
+  lua_pop( L, 1 );
+  // Global C functions
+  profh_name_cfuncs( L, LUA_GLOBALSINDEX, "", names );
+}
+
+// Push the name of the function of node 'node' ('names' is the index of the
+// C function names table)
+static void profh_push_name( lua_State *L, unsigned node, int names )
+{
+  PROF_NODE *pn = prof_nodes + node;
+  char buf[ LUA_IDSIZE ];
+  const Proto *p;
+
+  if( pn->isc )
+  {
+    lua_pushlightuserdata( L, ( void* )pn->key );
+    lua_rawget( L, names );
+    if( lua_isnil( L, -1 ) )
+    {
+      lua_pop( L, 1 );
+      lua_pushfstring( L, "C:%p", pn->key );
+    }
+    return;
+  }
+  p = ( const Proto* )pn->key;
+  luaO_chunkid( buf, p->source ? getstr( p->source ) : "=?", LUA_IDSIZE );
+  if( p->linedefined == 0 )
+    lua_pushfstring( L, "%s:main", buf );
+  else
+    lua_pushfstring( L, "%s:%d", buf, p->linedefined );
+}
+
+// Returns 1 if the function of 'node' is also one of its callers
+static int profh_is_recursive( unsigned node )
+{
+  unsigned n = prof_nodes[ node ].parent;
+
+  while( n != 0 )
+  {
+    if( prof_nodes[ n ].key == prof_nodes[ node ].key )
+      return 1;
+    n = prof_nodes[ n ].parent;
+  }
+  return 0;
+}
+
+typedef struct
+{
+  u16 node;                     // first node for the function
+  u32 calls, total, self;
+} PROF_FLAT;
+
+// Flat profile: one line per function, sorted by self time
+//   self_us <tab> total_us <tab> calls <tab> function
+void elua_prof_push_flat( lua_State *L )
+{
+  PROF_FLAT *pflat, tmp;
+  unsigned i, j, n = 0;
+  PROF_NODE *pn;
+  luaL_Buffer b;
+  int names;
+
+  profh_push_cnames( L );
+  names = lua_gettop( L );
+  pflat = ( PROF_FLAT* )lua_newuserdata( L, sizeof( PROF_FLAT ) * ELUA_PROFILE_MAX_NODES );
+  for( i = 1; i < prof_num_nodes; i ++ )
+  {
+    pn = prof_nodes + i;
+    for( j = 0; j < n; j ++ )
+      if( prof_nodes[ pflat[ j ].node ].key == pn->key )
+        break;
+    if( j == n )
+    {
+      pflat[ n ].node = i;
+      pflat[ n ].calls = pflat[ n ].total = pflat[ n ].self = 0;
+      n ++;
+    }
+    pflat[ j ].calls += pn->calls;
+    pflat[ j ].self += pn->self;
+    // The time of recursive calls is already in the total of the first call
+    if( !profh_is_recursive( i ) )
+      pflat[ j ].total += pn->total;
+  }
+  for( i = 1; i < n; i ++ )
+  {
+    tmp = pflat[ i ];
+    for( j = i; j > 0 && pflat[ j - 1 ].self < tmp.self; j -- )
+      pflat[ j ] = pflat[ j - 1 ];
+    pflat[ j ] = tmp;
+  }
+  luaL_buffinit( L, &b );
+  lua_pushfstring( L, "# self_us\ttotal_us\tcalls\tfunction (%d calls not recorded)\n", ( int )prof_lost );
+  luaL_addvalue( &b );
+  for( i = 0; i < n; i ++ )
+  {
+    lua_pushfstring( L, "%d\t%d\t%d\t", ( int )pflat[ i ].self, ( int )pflat[ i ].total, ( int )pflat[ i ].calls );
+    luaL_addvalue( &b );
+    profh_push_name( L, pflat[ i ].node, names );
+    luaL_addvalue( &b );
+    luaL_addchar( &b, '\n' );
+  }
+  luaL_pushresult( &b );
+  lua_replace( L, -3 );
+  lua_pop( L, 1 );
+}
+
+// Folded stacks (the input format of the flame graph tools): one line per
+// call path, with the self time of the last function on the path
+//   f1;f2;...;fn self_us
+void elua_prof_push_folded( lua_State *L )
+{
+  u16 path[ ELUA_PROFILE_MAX_DEPTH ];
+  unsigned i, n, depth;
+  luaL_Buffer b;
+  int names;
+
+  profh_push_cnames( L );
+  names = lua_gettop( L );
+  luaL_buffinit( L, &b );
+  for( i = 1; i < prof_num_nodes; i ++ )
+  {
+    if( prof_nodes[ i ].self == 0 )
+      continue;
+    for( n = i, depth = 0; n != 0 && depth < ELUA_PROFILE_MAX_DEPTH; n = prof_nodes[ n ].parent )
+      path[ depth ++ ] = n;
+    while( depth > 0 )
+    {
+      profh_push_name( L, path[ -- depth ], names );
+      luaL_addvalue( &b );
+      luaL_addchar( &b, depth > 0 ? ';' : ' ' );
+    }
+    lua_pushfstring( L, "%d\n", ( int )prof_nodes[ i ].self );
+    luaL_addvalue( &b );
+  }
+  luaL_pushresult( &b );
+  lua_remove( L, -2 );
+}
+
+// Opcode counters: one line per executed opcode
+//   opcode <tab> count
+void elua_prof_push_opcodes( lua_State *L )
+{
+  unsigned i;
+  luaL_Buffer b;
+
+  luaL_buffinit( L, &b );
+  for( i = 0; i < NUM_OPCODES; i ++ )
+    if( elua_prof_opcodes[ i ] )
+    {
+      lua_pushfstring( L, "%s\t%d\n", luaP_opnames[ i ], ( int )elua_prof_opcodes[ i ] );
+      luaL_addvalue( &b );
+    }
+  luaL_pushresult( &b );
+}
+
+#endif // #ifdef BUILD_LUA_PROFILER
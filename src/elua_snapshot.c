@@ -0,0 +1,813 @@
+// Lua state snapshots
+// A snapshot is a serialized copy of the global variables of a Lua state and
+// of everything reachable from them (tables, strings, Lua functions with their
+// upvalues and environments). It is saved once, after a (possibly long)
+// initialization, and then restored at boot in a single pass over the file.
+// Values that belong to the firmware (C functions, rotables, C module tables,
+// userdata like io.stdout) are not serialized, they are saved by their name
+// (for example "pio.pin.setval") and looked up by name when restoring.
+
+#include "lua.h"
+#include "lauxlib.h"
+#include "lrotable.h"
+#include "type.h"
+#include "elua_snapshot.h"
+#include <stdio.h>
+#include <string.h>
+
+// Snapshot format: a header followed by two lists of (key, value) pairs, each
+// terminated by a nil key: the global variables and the entries of
+// package.loaded that don't belong to C modules, and a trailer with the size
+// (u32) and the CRC-32 (u32) of everything before it. Each value is a tag byte
+// followed by its data:
+//   SNAP_NUMBER: lua_Number (native format)
+//   SNAP_STRING: u32 length, data
+//   SNAP_TABLE: u32 array size, u32 hash size, (key, value) pairs terminated
+//               by a nil key, metatable (nil if none)
+//   SNAP_FUNCTION: u32 length, function dumped with lua_dump, u8 number of
+//                  upvalues, upvalues, environment
+//   SNAP_NAMED: u8 length, name
+//   SNAP_REF: u32 index of a previous table, function or named value
+//   SNAP_GLOBALS: the table of globals
+// Tables, functions and named values are numbered (starting with 1) in the
+// order in which they appear in the file, so they can be shared.
+enum
+{
+  SNAP_NIL,
+  SNAP_FALSE,
+  SNAP_TRUE,
+  SNAP_NUMBER,
+  SNAP_STRING,
+  SNAP_TABLE,
+  SNAP_FUNCTION,
+  SNAP_NAMED,
+  SNAP_REF,
+  SNAP_GLOBALS
+};
+
+#define SNAP_SIGNATURE          "\033eLS"
+#define SNAP_SIGNATURE_LEN      4
+#define SNAP_VERSION            2
+#define SNAP_TRAILER_SIZE       8
+#ifdef LUA_NUMBER_INTEGRAL
+#define SNAP_NUMBER_INTEGRAL    1
+#else
+#define SNAP_NUMBER_INTEGRAL    0
+#endif
+
+// Maximum length of a name and maximum depth of a name (as in "a.b.c")
+#define SNAP_MAX_NAME_LEN       255
+#define SNAP_MAX_NAME_DEPTH     3
+
+// Size of the read buffer used to load Lua functions
+#define SNAP_READ_BUF_SIZE      128
+
+// Stack indexes used by the protected functions below (index 1 is the
+// light userdata with the state)
+#define SNAP_NAMES_IDX          2   // (save) value -> name
+#define SNAP_IDS_IDX            3   // (save) value -> index
+#define SNAP_OBJS_IDX           2   // (restore) index -> value
+#define SNAP_GLOBALS_IDX        3   // (restore) globals read from the file
+#define SNAP_LOADED_IDX         4   // (restore) modules read from the file
+
+typedef struct
+{
+  FILE *fp;
+  int nobjs;
+  int depth;
+  u32 left;
+  u32 size;                       // bytes written/read so far
+  u32 crc;                        // CRC-32 of these bytes
+  u32 total;                      // (restore) size without the trailer
+  char buf[ SNAP_READ_BUF_SIZE ];
+} SNAP_STATE;
+
+#if LUA_OPTIMIZE_MEMORY == 2
+extern const luaR_entry base_funcs_list[];
+#endif
+extern const luaR_table lua_rotable[];
+
+// ****************************************************************************
+// Helpers
+
+static u32 snaph_crc( u32 crc, const void *data, size_t size )
+{
+  const u8 *p = ( const u8* )data;
+  int i;
+
+  crc = ~crc;
+  while( size -- )
+  {
+    crc ^= *p ++;
+    for( i = 0; i < 8; i ++ )
+      crc = ( crc >> 1 ) ^ ( 0xEDB88320UL & -( crc & 1 ) );
+  }
+  return ~crc;
+}
+
+static void snaph_enter( lua_State *L, SNAP_STATE *ps )
+{
+  if( ++ ps->depth > ELUA_SNAPSHOT_MAX_DEPTH )
+    luaL_error( L, "snapshot: data too deeply nested" );
+  luaL_checkstack( L, 8, "snapshot: data too deeply nested" );
+}
+
+// Returns true if the value at 'idx' is provided by the firmware: C functions,
+// rotables, userdata and the tables of C modules (which have C functions,
+// but no Lua functions)
+static int snaph_is_native( lua_State *L, int idx )
+{
+  int res = 0;
+
+  switch( lua_type( L, idx ) )
+  {
+    case LUA_TLIGHTFUNCTION:
+    case LUA_TROTABLE:
+    case LUA_TUSERDATA:
+    case LUA_TLIGHTUSERDATA:
+      return 1;
+
+    case LUA_TFUNCTION:
+      return lua_iscfunction( L, idx );
+
+    case LUA_TTABLE:
+      lua_pushnil( L );
+      while( lua_next( L, idx ) )
+      {
+        if( lua_type( L, -1 ) == LUA_TFUNCTION || lua_type( L, -1 ) == LUA_TLIGHTFUNCTION )
+        {
+          if( !lua_iscfunction( L, -1 ) )
+          {
+            lua_pop( L, 2 );
+            return 0;
+          }
+          res = 1;
+        }
+        lua_pop( L, 1 );
+      }
+      return res;
+  }
+  return 0;
+}
+
+// ****************************************************************************
+// Names of the firmware values
+
+static void snaph_name_fields( lua_State *L, int idx, const char *prefix, int depth, int all );
+
+// Give 'name' to the value at 'idx' (unless it already has a name) and to
+// the native values in its fields
+static void snaph_name_value( lua_State *L, int idx, const char *name, int depth )
+{
+  int t = lua_type( L, idx );
+
+  lua_pushvalue( L, idx );
+  lua_rawget( L, SNAP_NAMES_IDX );
+  if( !lua_isnil( L, -1 ) || lua_rawequal( L, idx, LUA_GLOBALSINDEX ) )
+  {
+    lua_pop( L, 1 );
+    return;
+  }
+  lua_pop( L, 1 );
+  lua_pushvalue( L, idx );
+  lua_pushstring( L, name );
+  lua_rawset( L, SNAP_NAMES_IDX );
+  if( ( t == LUA_TTABLE || t == LUA_TROTABLE ) && depth < SNAP_MAX_NAME_DEPTH )
+    snaph_name_fields( L, idx, name, depth + 1, 1 );
+}
+
+// Name the native fields of the table at 'idx'; if 'all' is false only the
+// C functions are named (the table isn't a C module, so its other values
+// might have been created by the application)
+static void snaph_name_fields( lua_State *L, int idx, const char *prefix, int depth, int all )
+{
+  int t;
+
+  luaL_checkstack( L, 4, "snapshot: too many names" );
+  lua_pushnil( L );
+  while( lua_next( L, idx ) )
+  {
+    t = lua_type( L, -1 );
+    if( lua_type( L, -2 ) == LUA_TSTRING &&
+        ( all || t == LUA_TFUNCTION || t == LUA_TLIGHTFUNCTION ) &&
+        snaph_is_native( L, lua_gettop( L ) ) )
+    {
+      if( *prefix )
+        lua_pushfstring( L, "%s.%s", prefix, lua_tostring( L, -2 ) );
+      else
+        lua_pushvalue( L, -2 );
+      if( lua_objlen( L, -1 ) <= SNAP_MAX_NAME_LEN )
+        snaph_name_value( L, lua_gettop( L ) - 1, lua_tostring( L, -1 ), depth );
+      lua_pop( L, 1 );
+    }
+    lua_pop( L, 1 );
+  }
+}
+
+static void snaph_collect_names( lua_State *L )
+{
+  unsigned i;
+
+  // Base library functions
+#if LUA_OPTIMIZE_MEMORY == 2
+  lua_pushrotable( L, ( void* )base_funcs_list );
+  snaph_name_fields( L, lua_gettop( L ), "", 0, 0 );
+  lua_pop( L, 1 );
+#endif
+  // ROM modules
+  for( i = 0; lua_rotable[ i ].name; i ++ )
+    if( *lua_rotable[ i ].name )
+    {
+      lua_pushrotable( L, ( void* )lua_rotable[ i ].pentries );
+      snaph_name_value( L, lua_gettop( L ), lua_rotable[ i ].name, 0 );
+      lua_pop( L, 1 );
+    }
+  // C modules in package.loaded
+  lua_getfield( L, LUA_REGISTRYINDEX, "_LOADED" );
+  if( lua_istable( L, -1 ) )
+    snaph_name_fields( L, lua_gettop( L ), "", 0, 1 );
+  lua_pop( L, 1 );
+  // Other global C functions are named by their keys (they are checked
+  // last, since they might be aliases)
+  snaph_name_fields( L, LUA_GLOBALSINDEX, "", 0, 0 );
+}
+
+// Push the value with the given name
+static void snaph_push_named( lua_State *L, const char *name )
+{
+  const char *p, *e;
+  int first = 1;
+
+  for( p = name; ; p = e + 1 )
+  {
+    if( ( e = strchr( p, '.' ) ) == NULL )
+      e = p + strlen( p );
+    lua_pushlstring( L, p, e - p );
+    if( first )
+    {
+      // Globals first, then package.loaded
+      lua_pushvalue( L, -1 );
+      lua_gettable( L, LUA_GLOBALSINDEX );
+      if( lua_isnil( L, -1 ) )
+      {
+        lua_pop( L, 1 );
+        lua_getfield( L, LUA_REGISTRYINDEX, "_LOADED" );
+        lua_insert( L, -2 );
+        lua_gettable( L, -2 );
+        lua_remove( L, -2 );
+      }
+      else
+        lua_remove( L, -2 );
+      first = 0;
+    }
+    else
+    {
+      if( !lua_istable( L, -2 ) && lua_type( L, -2 ) != LUA_TROTABLE )
+        luaL_error( L, "snapshot: '%s' not found", name );
+      lua_gettable( L, -2 );
+      lua_remove( L, -2 );
+    }
+    if( *e == '\0' )
+      break;
+  }
+  if( lua_isnil( L, -1 ) )
+    luaL_error( L, "snapshot: '%s' not found", name );
+}
+
+// ****************************************************************************
+// Save
+
+static void snaph_write( lua_State *L, SNAP_STATE *ps, const void *data, size_t size )
+{
+  if( size > 0 && fwrite( data, 1, size, ps->fp ) != size )
+    luaL_error( L, "snapshot: write error" );
+  ps->crc = snaph_crc( ps->crc, data, size );
+  ps->size += size;
+}
+
+static void snaph_write_u8( lua_State *L, SNAP_STATE *ps, u8 data )
+{
+  snaph_write( L, ps, &data, 1 );
+}
+
+static void snaph_write_u32( lua_State *L, SNAP_STATE *ps, u32 data )
+{
+  snaph_write( L, ps, &data, 4 );
+}
+
+static int snaph_dump_writer( lua_State *L, const void *p, size_t size, void *b )
+{
+  luaL_addlstring( ( luaL_Buffer* )b, ( const char* )p, size );
+  return 0;
+}
+
+static void snap_write_value( lua_State *L, SNAP_STATE *ps, int idx );
+
+static void snap_write_table( lua_State *L, SNAP_STATE *ps, int idx )
+{
+  u32 narr = lua_objlen( L, idx ), total = 0;
+
+  lua_pushnil( L );
+  while( lua_next( L, idx ) )
+  {
+    total ++;
+    lua_pop( L, 1 );
+  }
+  snaph_write_u8( L, ps, SNAP_TABLE );
+  snaph_write_u32( L, ps, narr );
+  snaph_write_u32( L, ps, total > narr ? total - narr : 0 );
+  lua_pushnil( L );
+  while( lua_next( L, idx ) )
+  {
+    snap_write_value( L, ps, lua_gettop( L ) - 1 );
+    snap_write_value( L, ps, lua_gettop( L ) );
+    lua_pop( L, 1 );
+  }
+  snaph_write_u8( L, ps, SNAP_NIL );
+  if( lua_getmetatable( L, idx ) )
+  {
+    snap_write_value( L, ps, lua_gettop( L ) );
+    lua_pop( L, 1 );
+  }
+  else
+    snaph_write_u8( L, ps, SNAP_NIL );
+}
+
+static void snap_write_function( lua_State *L, SNAP_STATE *ps, int idx )
+{
+  luaL_Buffer b;
+  size_t len;
+  const char *pdata;
+  int nups;
+
+  lua_pushvalue( L, idx );
+  luaL_buffinit( L, &b );
+  if( lua_dump( L, snaph_dump_writer, &b ) != 0 )
+    luaL_error( L, "snapshot: unable to dump function" );
+  luaL_pushresult( &b );
+  pdata = lua_tolstring( L, -1, &len );
+  snaph_write_u8( L, ps, SNAP_FUNCTION );
+  snaph_write_u32( L, ps, len );
+  snaph_write( L, ps, pdata, len );
+  lua_pop( L, 2 );
+  // Upvalues (shared upvalues are restored as separate copies)
+  for( nups = 0; lua_getupvalue( L, idx, nups + 1 ) != NULL; nups ++ )
+    lua_pop( L, 1 );
+  snaph_write_u8( L, ps, nups );
+  for( nups = 1; lua_getupvalue( L, idx, nups ) != NULL; nups ++ )
+  {
+    snap_write_value( L, ps, lua_gettop( L ) );
+    lua_pop( L, 1 );
+  }
+  lua_getfenv( L, idx );
+  snap_write_value( L, ps, lua_gettop( L ) );
+  lua_pop( L, 1 );
+}
+
+static void snap_write_value( lua_State *L, SNAP_STATE *ps, int idx )
+{
+  size_t len;
+  const char *s;
+  lua_Number n;
+  int t = lua_type( L, idx );
+
+  switch( t )
+  {
+    case LUA_TNIL:
+      snaph_write_u8( L, ps, SNAP_NIL );
+      return;
+
+    case LUA_TBOOLEAN:
+      snaph_write_u8( L, ps, lua_toboolean( L, idx ) ? SNAP_TRUE : SNAP_FALSE );
+      return;
+
+    case LUA_TNUMBER:
+      n = lua_tonumber( L, idx );
+      snaph_write_u8( L, ps, SNAP_NUMBER );
+      snaph_write( L, ps, &n, sizeof( n ) );
+      return;
+
+    case LUA_TSTRING:
+      s = lua_tolstring( L, idx, &len );
+      snaph_write_u8( L, ps, SNAP_STRING );
+      snaph_write_u32( L, ps, len );
+      snaph_write( L, ps, s, len );
+      return;
+  }
+  if( lua_rawequal( L, idx, LUA_GLOBALSINDEX ) )
+  {
+    snaph_write_u8( L, ps, SNAP_GLOBALS );
+    return;
+  }
+  snaph_enter( L, ps );
+  // Already saved?
+  lua_pushvalue( L, idx );
+  lua_rawget( L, SNAP_IDS_IDX );
+  if( lua_isnumber( L, -1 ) )
+  {
+    snaph_write_u8( L, ps, SNAP_REF );
+    snaph_write_u32( L, ps, ( u32 )lua_tointeger( L, -1 ) );
+    lua_pop( L, 1 );
+    ps->depth --;
+    return;
+  }
+  lua_pop( L, 1 );
+  // Give it an index before saving its contents (it might reference itself)
+  lua_pushvalue( L, idx );
+  lua_pushinteger( L, ++ ps->nobjs );
+  lua_rawset( L, SNAP_IDS_IDX );
+  // Firmware value?
+  lua_pushvalue( L, idx );
+  lua_rawget( L, SNAP_NAMES_IDX );
+  if( lua_isstring( L, -1 ) )
+  {
+    s = lua_tolstring( L, -1, &len );
+    snaph_write_u8( L, ps, SNAP_NAMED );
+    snaph_write_u8( L, ps, len );
+    snaph_write( L, ps, s, len );
+  }
+  else if( t == LUA_TTABLE )
+    snap_write_table( L, ps, idx );
+  else if( t == LUA_TFUNCTION && !lua_iscfunction( L, idx ) )
+    snap_write_function( L, ps, idx );
+  else
+    luaL_error( L, "snapshot: can't save a %s value", lua_typename( L, t ) );
+  lua_pop( L, 1 );
+  ps->depth --;
+}
+
+// Returns true if the global ('keyidx', 'validx') doesn't need to be saved
+// because it is already there after the libraries are opened
+static int snaph_is_builtin( lua_State *L, int keyidx, int validx )
+{
+  int res;
+
+  if( lua_rawequal( L, validx, LUA_GLOBALSINDEX ) )
+    return 1;
+  lua_pushvalue( L, validx );
+  lua_rawget( L, SNAP_NAMES_IDX );
+  res = lua_isstring( L, -1 ) && lua_equal( L, -1, keyidx );
+  lua_pop( L, 1 );
+  return res;
+}
+
+static int snap_save_main( lua_State *L )
+{
+  SNAP_STATE *ps = ( SNAP_STATE* )lua_touserdata( L, 1 );
+  int loaded;
+  u32 size, crc;
+
+  lua_settop( L, 1 );
+  lua_newtable( L ); // SNAP_NAMES_IDX
+  lua_newtable( L ); // SNAP_IDS_IDX
+  snaph_collect_names( L );
+  // Header
+  snaph_write( L, ps, SNAP_SIGNATURE, SNAP_SIGNATURE_LEN );
+  snaph_write_u8( L, ps, SNAP_VERSION );
+  snaph_write_u8( L, ps, sizeof( lua_Number ) );
+  snaph_write_u8( L, ps, SNAP_NUMBER_INTEGRAL );
+  // Globals
+  lua_pushnil( L );
+  while( lua_next( L, LUA_GLOBALSINDEX ) )
+  {
+    if( !snaph_is_builtin( L, lua_gettop( L ) - 1, lua_gettop( L ) ) )
+    {
+      snap_write_value( L, ps, lua_gettop( L ) - 1 );
+      snap_write_value( L, ps, lua_gettop( L ) );
+    }
+    lua_pop( L, 1 );
+  }
+  snaph_write_u8( L, ps, SNAP_NIL );
+  // Modules written in Lua
+  lua_getfield( L, LUA_REGISTRYINDEX, "_LOADED" );
+  loaded = lua_gettop( L );
+  if( lua_istable( L, loaded ) )
+  {
+    lua_pushnil( L );
+    while( lua_next( L, loaded ) )
+    {
+      lua_pushvalue( L, -1 );
+      lua_rawget( L, SNAP_NAMES_IDX );
+      if( lua_isnil( L, -1 ) && !lua_rawequal( L, -2, LUA_GLOBALSINDEX ) )
+      {
+        snap_write_value( L, ps, lua_gettop( L ) - 2 );
+        snap_write_value( L, ps, lua_gettop( L ) - 1 );
+      }
+      lua_pop( L, 2 );
+    }
+  }
+  snaph_write_u8( L, ps, SNAP_NIL );
+  // Trailer (an interrupted save leaves a file that won't be restored)
+  size = ps->size;
+  crc = ps->crc;
+  snaph_write_u32( L, ps, size );
+  snaph_write_u32( L, ps, crc );
+  return 0;
+}
+
+void elua_snapshot_save( lua_State *L, const char *fname )
+{
+  SNAP_STATE state;
+  int res;
+
+  memset( &state, 0, sizeof( state ) );
+  if( ( state.fp = fopen( fname, "wb" ) ) == NULL )
+    luaL_error( L, "snapshot: unable to create %s", fname );
+  res = lua_cpcall( L, snap_save_main, &state );
+  if( fclose( state.fp ) != 0 && res == 0 )
+  {
+    lua_pushstring( L, "snapshot: write error" );
+    res = 1;
+  }
+  if( res != 0 )
+  {
+    remove( fname );
+    lua_error( L );
+  }
+}
+
+// ****************************************************************************
+// Restore
+
+// Read at most 'size' bytes of data (not past the trailer)
+static size_t snaph_read_data( SNAP_STATE *ps, void *data, size_t size )
+{
+  if( size > ps->total - ps->size )
+    size = ps->total - ps->size;
+  if( size == 0 || ( size = fread( data, 1, size, ps->fp ) ) == 0 )
+    return 0;
+  ps->crc = snaph_crc( ps->crc, data, size );
+  ps->size += size;
+  return size;
+}
+
+static void snaph_read( lua_State *L, SNAP_STATE *ps, void *data, size_t size )
+{
+  if( size > 0 && snaph_read_data( ps, data, size ) != size )
+    luaL_error( L, "snapshot: unexpected end of file" );
+}
+
+static u8 snaph_read_u8( lua_State *L, SNAP_STATE *ps )
+{
+  u8 data;
+
+  snaph_read( L, ps, &data, 1 );
+  return data;
+}
+
+static u32 snaph_read_u32( lua_State *L, SNAP_STATE *ps )
+{
+  u32 data;
+
+  snaph_read( L, ps, &data, 4 );
+  return data;
+}
+
+// Reader for lua_load (reads 'ps->left' bytes from the file)
+static const char* snaph_load_reader( lua_State *L, void *data, size_t *size )
+{
+  SNAP_STATE *ps = ( SNAP_STATE* )data;
+  size_t n = ps->left > SNAP_READ_BUF_SIZE ? SNAP_READ_BUF_SIZE : ps->left;
+
+  if( L == NULL && size == NULL ) // 'direct mode' request: not supported
+    return NULL;
+  if( ( n = snaph_read_data( ps, ps->buf, n ) ) == 0 )
+  {
+    *size = 0;
+    return NULL;
+  }
+  ps->left -= n;
+  *size = n;
+  return ps->buf;
+}
+
+// Remember the value on the top of the stack as the next object
+static void snaph_register( lua_State *L, SNAP_STATE *ps )
+{
+  lua_pushvalue( L, -1 );
+  lua_rawseti( L, SNAP_OBJS_IDX, ++ ps->nobjs );
+}
+
+static void snap_read_value( lua_State *L, SNAP_STATE *ps );
+
+static void snap_read_table( lua_State *L, SNAP_STATE *ps )
+{
+  u32 narr = snaph_read_u32( L, ps );
+  u32 nrec = snaph_read_u32( L, ps );
+  u32 max = ( ps->total - ps->size ) / 2;
+
+  // Each entry takes at least 2 bytes: don't trust sizes that don't fit in
+  // the rest of the file
+  if( narr > max )
+    narr = max;
+  if( nrec > max - narr )
+    nrec = max - narr;
+  lua_createtable( L, narr, nrec );
+  snaph_register( L, ps );
+  while( 1 )
+  {
+    snap_read_value( L, ps );
+    if( lua_isnil( L, -1 ) )
+    {
+      lua_pop( L, 1 );
+      break;
+    }
+    snap_read_value( L, ps );
+    lua_rawset( L, -3 );
+  }
+  snap_read_value( L, ps );
+  if( lua_istable( L, -1 ) || lua_type( L, -1 ) == LUA_TROTABLE )
+    lua_setmetatable( L, -2 );
+  else
+    lua_pop( L, 1 );
+}
+
+static void snap_read_function( lua_State *L, SNAP_STATE *ps )
+{
+  int nups, i;
+  size_t dummy;
+
+  ps->left = snaph_read_u32( L, ps );
+  if( lua_load( L, snaph_load_reader, ps, "=snapshot" ) != 0 )
+    lua_error( L );
+  // Skip whatever the loader didn't read
+  while( snaph_load_reader( L, ps, &dummy ) != NULL );
+  snaph_register( L, ps );
+  nups = snaph_read_u8( L, ps );
+  for( i = 1; i <= nups; i ++ )
+  {
+    snap_read_value( L, ps );
+    if( lua_setupvalue( L, -2, i ) == NULL )
+      luaL_error( L, "snapshot: invalid function" );
+  }
+  snap_read_value( L, ps );
+  if( !lua_istable( L, -1 ) || !lua_setfenv( L, -2 ) )
+    luaL_error( L, "snapshot: invalid function" );
+}
+
+static void snap_read_value( lua_State *L, SNAP_STATE *ps )
+{
+  luaL_Buffer b;
+  lua_Number n;
+  u32 len, chunk;
+  char name[ SNAP_MAX_NAME_LEN + 1 ];
+  u8 tag = snaph_read_u8( L, ps );
+
+  switch( tag )
+  {
+    case SNAP_NIL:
+      lua_pushnil( L );
+      break;
+
+    case SNAP_FALSE:
+    case SNAP_TRUE:
+      lua_pushboolean( L, tag == SNAP_TRUE );
+      break;
+
+    case SNAP_NUMBER:
+      snaph_read( L, ps, &n, sizeof( n ) );
+      lua_pushnumber( L, n );
+      break;
+
+    case SNAP_STRING:
+      len = snaph_read_u32( L, ps );
+      luaL_buffinit( L, &b );
+      while( len > 0 )
+      {
+        chunk = len > LUAL_BUFFERSIZE ? LUAL_BUFFERSIZE : len;
+        snaph_read( L, ps, luaL_prepbuffer( &b ), chunk );
+        luaL_addsize( &b, chunk );
+        len -= chunk;
+      }
+      luaL_pushresult( &b );
+      break;
+
+    case SNAP_TABLE:
+      snaph_enter( L, ps );
+      snap_read_table( L, ps );
+      ps->depth --;
+      break;
+
+    case SNAP_FUNCTION:
+      snaph_enter( L, ps );
+      snap_read_function( L, ps );
+      ps->depth --;
+      break;
+
+    case SNAP_NAMED:
+      len = snaph_read_u8( L, ps );
+      snaph_read( L, ps, name, len );
+      name[ len ] = '\0';
+      snaph_push_named( L, name );
+      snaph_register( L, ps );
+      break;
+
+    case SNAP_REF:
+      len = snaph_read_u32( L, ps );
+      if( len == 0 || len > ( u32 )ps->nobjs )
+        luaL_error( L, "snapshot: invalid reference" );
+      lua_rawgeti( L, SNAP_OBJS_IDX, len );
+      break;
+
+    case SNAP_GLOBALS:
+      lua_pushvalue( L, LUA_GLOBALSINDEX );
+      break;
+
+    default:
+      luaL_error( L, "snapshot: invalid data" );
+  }
+}
+
+// Read (key, value) pairs and set them in the table at 'idx'
+static void snaph_read_pairs( lua_State *L, SNAP_STATE *ps, int idx )
+{
+  while( 1 )
+  {
+    snap_read_value( L, ps );
+    if( lua_isnil( L, -1 ) )
+    {
+      lua_pop( L, 1 );
+      break;
+    }
+    snap_read_value( L, ps );
+    lua_rawset( L, idx );
+  }
+}
+
+// Check the size and the CRC of the file before reading anything from it
+// (a corrupted Lua function could make lua_load misbehave)
+static void snaph_check( lua_State *L, SNAP_STATE *ps )
+{
+  u32 trailer[ 2 ];
+  long len;
+
+  if( fseek( ps->fp, 0, SEEK_END ) != 0 )
+    luaL_error( L, "snapshot: read error" );
+  len = ftell( ps->fp );
+  if( len < SNAP_TRAILER_SIZE || fseek( ps->fp, 0, SEEK_SET ) != 0 )
+    luaL_error( L, "snapshot: not a snapshot file" );
+  ps->total = ( u32 )len - SNAP_TRAILER_SIZE;
+  while( snaph_read_data( ps, ps->buf, SNAP_READ_BUF_SIZE ) > 0 );
+  if( ps->size != ps->total || fread( trailer, 1, SNAP_TRAILER_SIZE, ps->fp ) != SNAP_TRAILER_SIZE ||
+      trailer[ 0 ] != ps->size || trailer[ 1 ] != ps->crc )
+    luaL_error( L, "snapshot: corrupted file" );
+  if( fseek( ps->fp, 0, SEEK_SET ) != 0 )
+    luaL_error( L, "snapshot: read error" );
+  ps->size = ps->crc = 0;
+}
+
+// Copy the (key, value) pairs of the table at 'from' to the table at 'to'
+static void snaph_copy_pairs( lua_State *L, int from, int to )
+{
+  lua_pushnil( L );
+  while( lua_next( L, from ) )
+  {
+    lua_pushvalue( L, -2 );
+    lua_insert( L, -2 );
+    lua_rawset( L, to );
+  }
+}
+
+static int snap_restore_main( lua_State *L )
+{
+  SNAP_STATE *ps = ( SNAP_STATE* )lua_touserdata( L, 1 );
+  char sig[ SNAP_SIGNATURE_LEN ];
+
+  lua_settop( L, 1 );
+  lua_newtable( L ); // SNAP_OBJS_IDX
+  lua_newtable( L ); // SNAP_GLOBALS_IDX
+  lua_newtable( L ); // SNAP_LOADED_IDX
+  snaph_check( L, ps );
+  snaph_read( L, ps, sig, SNAP_SIGNATURE_LEN );
+  if( memcmp( sig, SNAP_SIGNATURE, SNAP_SIGNATURE_LEN ) || snaph_read_u8( L, ps ) != SNAP_VERSION )
+    luaL_error( L, "snapshot: not a snapshot file" );
+  if( snaph_read_u8( L, ps ) != sizeof( lua_Number ) || snaph_read_u8( L, ps ) != SNAP_NUMBER_INTEGRAL )
+    luaL_error( L, "snapshot: saved by an incompatible firmware" );
+  // Read everything before changing the state
+  snaph_read_pairs( L, ps, SNAP_GLOBALS_IDX );
+  snaph_read_pairs( L, ps, SNAP_LOADED_IDX );
+  if( ps->size != ps->total )
+    luaL_error( L, "snapshot: invalid data" );
+  lua_getfield( L, LUA_REGISTRYINDEX, "_LOADED" );
+  if( !lua_istable( L, -1 ) )
+    luaL_error( L, "snapshot: package.loaded not found" );
+  snaph_copy_pairs( L, SNAP_GLOBALS_IDX, LUA_GLOBALSINDEX );
+  snaph_copy_pairs( L, SNAP_LOADED_IDX, lua_gettop( L ) );
+  return 0;
+}
+
+int elua_snapshot_restore( lua_State *L, const char *fname )
+{
+  SNAP_STATE state;
+  int res;
+
+  memset( &state, 0, sizeof( state ) );
+  if( ( state.fp = fopen( fname, "rb" ) ) == NULL )
+    return 0;
+  res = lua_cpcall( L, snap_restore_main, &state );
+  fclose( state.fp );
+  if( res != 0 )
+    lua_error( L );
+  return 1;
+}
+
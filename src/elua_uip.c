@@ -14,6 +14,7 @@
 #include "dhcpc.h"
 #include "resolv.h"
 #include <string.h>
+#include <stdlib.h>
 
 // UIP send buffer
 extern void* uip_sappdata;
@@ -255,6 +256,114 @@ static elua_net_size elua_uip_telnet_prep_send( const char* src, elua_net_size s
 
 #endif // #ifdef BUILD_CON_TCP
 
+// *****************************************************************************
+// Non-blocking sockets support
+// A socket in non-blocking mode owns a receive ring and a transmit buffer that
+// are serviced directly from the uIP application callback. Incoming data is
+// stored in the ring as soon as it arrives (the connection is stopped while
+// the ring can't hold another full receive window) and outgoing data is
+// queued in the transmit buffer, so send/recv never wait for the appcall.
+
+#ifndef ELUA_NET_NB_RX_SIZE
+#define ELUA_NET_NB_RX_SIZE           ( 2 * UIP_RECEIVE_WINDOW )
+#endif
+
+#ifndef ELUA_NET_NB_TX_SIZE
+#define ELUA_NET_NB_TX_SIZE           UIP_TCP_MSS
+#endif
+
+typedef struct
+{
+  volatile u8 active;
+  volatile u16 rxhead, rxcount;
+  volatile u16 txoff, txlen, txinflight;
+  u8 rxbuf[ ELUA_NET_NB_RX_SIZE ];
+  u8 txbuf[ ELUA_NET_NB_TX_SIZE ];
+} elua_uip_nb_state;
+
+// Buffers are allocated on the first switch to non-blocking mode and kept
+// for the lifetime of the socket slot (they are never freed from the ISR)
+static elua_uip_nb_state *elua_uip_nb[ UIP_CONNS ];
+
+static elua_uip_nb_state* elua_uip_nb_get( int sockno )
+{
+  elua_uip_nb_state *pnb = elua_uip_nb[ sockno ];
+
+  return pnb && pnb->active ? pnb : NULL;
+}
+
+static void elua_uip_nb_reset( elua_uip_nb_state *pnb )
+{
+  pnb->rxhead = pnb->rxcount = 0;
+  pnb->txoff = pnb->txlen = pnb->txinflight = 0;
+}
+
+static void elua_uip_nb_appcall( volatile struct elua_uip_state *s, elua_uip_nb_state *pnb )
+{
+  elua_net_size temp, i;
+  u16 wptr;
+  u8 *pdata;
+
+  // Handle close
+  if( s->state == ELUA_UIP_STATE_CLOSE )
+  {
+    uip_close();
+    s->state = ELUA_UIP_STATE_IDLE;
+    return;
+  }
+
+  if( uip_aborted() || uip_timedout() || uip_closed() )
+  {
+    s->res = uip_aborted() ? ELUA_NET_ERR_ABORTED : ( uip_timedout() ? ELUA_NET_ERR_TIMEDOUT : ELUA_NET_ERR_CLOSED );
+    return;
+  }
+
+  // Store new data in the receive ring
+  if( uip_newdata() )
+  {
+    temp = uip_datalen();
+    if( temp > ELUA_NET_NB_RX_SIZE - pnb->rxcount )
+    {
+      s->res = ELUA_NET_ERR_OVERFLOW;
+      temp = ELUA_NET_NB_RX_SIZE - pnb->rxcount;
+    }
+    pdata = ( u8* )uip_appdata;
+    wptr = pnb->rxhead + pnb->rxcount;
+    if( wptr >= ELUA_NET_NB_RX_SIZE )
+      wptr -= ELUA_NET_NB_RX_SIZE;
+    for( i = 0; i < temp; i ++ )
+    {
+      pnb->rxbuf[ wptr ] = *pdata ++;
+      if( ++ wptr == ELUA_NET_NB_RX_SIZE )
+        wptr = 0;
+    }
+    pnb->rxcount += temp;
+  }
+
+  // Receive flow control: close the window if the ring can't take another
+  // segment, open it again after recv made room
+  if( ELUA_NET_NB_RX_SIZE - pnb->rxcount < UIP_RECEIVE_WINDOW )
+    uip_stop();
+  else if( uip_stopped( uip_conn ) && uip_poll() )
+    uip_restart();
+
+  // Handle data send (only one segment can be in flight at a time)
+  if( uip_acked() )
+  {
+    pnb->txoff += pnb->txinflight;
+    pnb->txinflight = 0;
+    if( pnb->txoff == pnb->txlen )
+      pnb->txoff = pnb->txlen = 0;
+  }
+  if( uip_rexmit() && pnb->txinflight > 0 )
+    uip_send( pnb->txbuf + pnb->txoff, pnb->txinflight );
+  else if( pnb->txinflight == 0 && pnb->txlen > pnb->txoff )
+  {
+    pnb->txinflight = UMIN( pnb->txlen - pnb->txoff, uip_mss() );
+    uip_send( pnb->txbuf + pnb->txoff, pnb->txinflight );
+  }
+}
+
 // *****************************************************************************
 // eLua UIP application (used to implement the eLua TCP/IP services)
 
@@ -296,6 +405,8 @@ void elua_uip_appcall()
     // in the connection is the right one...
     if  ( s->state == ELUA_UIP_STATE_CONNECT  && uip_conn==elua_net_connecting ) {
       s->state = ELUA_UIP_STATE_IDLE;
+      if( elua_uip_nb[ sockno ] )
+        elua_uip_nb_reset( elua_uip_nb[ sockno ] );
     }
 
 #ifdef BUILD_CON_TCP
@@ -333,12 +444,21 @@ void elua_uip_appcall()
        uip_close();
        return;
      }
+     // A freshly accepted socket always starts in blocking mode
+     if( elua_uip_nb[ sockno ] )
+       elua_uip_nb[ sockno ]->active = 0;
    }
 
     uip_stop();
     return;
   }
 
+  if( elua_uip_nb_get( sockno ) )
+  {
+    elua_uip_nb_appcall( s, elua_uip_nb[ sockno ] );
+    return;
+  }
+
   if( s->state == ELUA_UIP_STATE_IDLE )
     return;
 
@@ -540,6 +660,91 @@ static void elua_prep_socket_state( volatile struct elua_uip_state *pstate, void
   pstate->state = state;
 }
 
+// Queue data on a non-blocking socket, return the number of bytes queued
+static elua_net_size elua_net_send_nb( int s, const void* buf, elua_net_size len )
+{
+  volatile struct elua_uip_state *pstate = ( volatile struct elua_uip_state* )&( uip_conns[ s ].appstate );
+  elua_uip_nb_state *pnb = elua_uip_nb[ s ];
+  elua_net_size temp;
+  int old_status;
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  temp = UMIN( len, ELUA_NET_NB_TX_SIZE - pnb->txlen );
+  memcpy( pnb->txbuf + pnb->txlen, buf, temp );
+  pnb->txlen += temp;
+  platform_cpu_set_global_interrupts( old_status );
+  pstate->res = temp < len ? ELUA_NET_ERR_WOULDBLOCK : ELUA_NET_ERR_OK;
+  if( temp > 0 )
+    platform_eth_force_interrupt();
+  return temp;
+}
+
+// Read from the receive ring of a non-blocking socket. In "read to char" mode
+// data is returned only if a whole line is available (or if the ring is full
+// or the connection is gone), otherwise ELUA_NET_ERR_WOULDBLOCK is set.
+static elua_net_size elua_net_recv_nb( int s, void* buf, elua_net_size maxsize, s16 readto, int with_buffer )
+{
+  volatile struct elua_uip_state *pstate = ( volatile struct elua_uip_state* )&( uip_conns[ s ].appstate );
+  elua_uip_nb_state *pnb = elua_uip_nb[ s ];
+  u16 count, idx, consumed = 0;
+  elua_net_size produced = 0;
+  char *dest = ( char* )buf;
+  int old_status, lastfound = 0;
+  u8 c;
+
+  // rxcount can only grow behind our back, so a snapshot is safe to use
+  count = pnb->rxcount;
+  if( readto != ELUA_NET_NO_LASTCHAR )
+  {
+    for( idx = pnb->rxhead; consumed < count && !lastfound; consumed ++ )
+    {
+      lastfound = pnb->rxbuf[ idx ] == readto;
+      if( ++ idx == ELUA_NET_NB_RX_SIZE )
+        idx = 0;
+    }
+    if( !lastfound && count < ELUA_NET_NB_RX_SIZE && count < maxsize && uip_conn_active( s ) )
+      count = 0;
+    consumed = 0;
+  }
+  if( count == 0 )
+  {
+    if( uip_conn_active( s ) )
+      pstate->res = ELUA_NET_ERR_WOULDBLOCK;
+    return 0;
+  }
+
+  idx = pnb->rxhead;
+  while( consumed < count && produced < maxsize )
+  {
+    c = pnb->rxbuf[ idx ];
+    if( ++ idx == ELUA_NET_NB_RX_SIZE )
+      idx = 0;
+    consumed ++;
+    if( readto != ELUA_NET_NO_LASTCHAR )
+    {
+      if( c == readto )
+        break;
+      if( c == '\r' )
+        continue;
+    }
+    if( with_buffer )
+      luaL_addchar( ( luaL_Buffer* )buf, c );
+    else
+      *dest ++ = c;
+    produced ++;
+  }
+
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  pnb->rxhead = idx;
+  pnb->rxcount -= consumed;
+  platform_cpu_set_global_interrupts( old_status );
+  pstate->res = ELUA_NET_ERR_OK;
+  // Let the appcall reopen the receive window if needed
+  if( uip_stopped_conn( s ) && ELUA_NET_NB_RX_SIZE - pnb->rxcount >= UIP_RECEIVE_WINDOW )
+    platform_eth_force_interrupt();
+  return produced;
+}
+
 int elua_net_socket( int type )
 {
   int i;
@@ -575,6 +780,8 @@ elua_net_size elua_net_send( int s, const void* buf, elua_net_size len )
     return -1;
   if( len == 0 )
     return 0;
+  if( elua_uip_nb_get( s ) )
+    return elua_net_send_nb( s, buf, len );
   elua_prep_socket_state( pstate, ( void* )buf, len, ELUA_NET_NO_LASTCHAR, ELUA_NET_ERR_OK, ELUA_UIP_STATE_SEND );
   platform_eth_force_interrupt();
   while( pstate->state != ELUA_UIP_STATE_IDLE );
@@ -588,7 +795,12 @@ static elua_net_size elua_net_recv_internal( int s, void* buf, elua_net_size max
   timer_data_type tmrstart = 0;
   int old_status;
 
-  if( !ELUA_UIP_IS_SOCK_OK( s ) || !uip_conn_active( s ) )
+  if( !ELUA_UIP_IS_SOCK_OK( s ) )
+    return -1;
+  // Data buffered on a non-blocking socket is still readable after close
+  if( elua_uip_nb_get( s ) )
+    return maxsize == 0 ? 0 : elua_net_recv_nb( s, buf, maxsize, readto, with_buffer );
+  if( !uip_conn_active( s ) )
     return -1;
   if( maxsize == 0 )
     return 0;
@@ -644,8 +856,17 @@ int elua_net_get_telnet_socket()
 int elua_net_close( int s )
 {
   volatile struct elua_uip_state *pstate = ( volatile struct elua_uip_state* )&( uip_conns[ s ].appstate );
+  elua_uip_nb_state *pnb;
 
-  if( !ELUA_UIP_IS_SOCK_OK( s ) || !uip_conn_active( s ) )
+  if( !ELUA_UIP_IS_SOCK_OK( s ) )
+    return -1;
+  if( ( pnb = elua_uip_nb_get( s ) ) != NULL )
+  {
+    // Flush the data queued on a non-blocking socket before closing it
+    while( pnb->txlen > pnb->txoff && uip_conn_active( s ) );
+    pnb->active = 0;
+  }
+  if( !uip_conn_active( s ) )
     return -1;
   elua_prep_socket_state( pstate, NULL, 0, ELUA_NET_NO_LASTCHAR, ELUA_NET_ERR_OK, ELUA_UIP_STATE_CLOSE );
   platform_eth_force_interrupt();
@@ -664,6 +885,68 @@ int elua_net_get_last_err( int s )
 }
 
 
+// Switch a socket between blocking and non-blocking mode
+// Returns 0 on success, -1 on error
+int elua_net_set_blocking( int s, int blocking )
+{
+  elua_uip_nb_state *pnb;
+  int old_status;
+
+  if( !ELUA_UIP_IS_SOCK_OK( s ) )
+    return -1;
+  pnb = elua_uip_nb[ s ];
+  if( blocking )
+  {
+    // Can't go back to blocking mode with data still queued for sending
+    if( pnb && pnb->active && pnb->txlen > pnb->txoff )
+      return -1;
+    if( pnb && pnb->active )
+    {
+      // The blocking code expects a stopped connection between calls; any
+      // data still in the receive ring is discarded
+      old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+      pnb->active = 0;
+      uip_stop_conn( s );
+      platform_cpu_set_global_interrupts( old_status );
+    }
+    return 0;
+  }
+  if( pnb && pnb->active )
+    return 0;
+  if( pnb == NULL )
+  {
+    if( ( pnb = ( elua_uip_nb_state* )malloc( sizeof( elua_uip_nb_state ) ) ) == NULL )
+      return -1;
+    pnb->active = 0;
+    elua_uip_nb[ s ] = pnb;
+  }
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  elua_uip_nb_reset( pnb );
+  pnb->active = 1;
+  platform_cpu_set_global_interrupts( old_status );
+  // Connections are stopped after connect/accept, the appcall will restart it
+  platform_eth_force_interrupt();
+  return 0;
+}
+
+// Return the readiness of a non-blocking socket as a combination of
+// ELUA_NET_READY_xxx flags, or -1 if the socket is not in non-blocking mode.
+// A socket is readable if it has buffered data or if its connection is gone
+// (so that recv can report the error) and writable if it can queue data.
+int elua_net_get_ready( int s )
+{
+  elua_uip_nb_state *pnb;
+  int res = 0;
+
+  if( !ELUA_UIP_IS_SOCK_OK( s ) || ( pnb = elua_uip_nb_get( s ) ) == NULL )
+    return -1;
+  if( pnb->rxcount > 0 || !uip_conn_active( s ) )
+    res |= ELUA_NET_READY_READ;
+  if( uip_conn_active( s ) && pnb->txlen < ELUA_NET_NB_TX_SIZE )
+    res |= ELUA_NET_READY_WRITE;
+  return res;
+}
+
 // New TH: listen/unlistens a port
 int elua_listen(u16 port,BOOL flisten)
 {
@@ -792,4 +1075,56 @@ elua_net_ip elua_net_lookup( const char* hostname )
   return res;
 }
 
+
+// *****************************************************************************
+// uIP checksum functions (UIP_ARCH_CHKSUM), implemented with elua_chksum
+
+#if UIP_ARCH_CHKSUM
+
+#define IPBUF                   ((struct uip_tcpip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+u16_t uip_chksum( u16_t *data, u16_t len )
+{
+  return htons( elua_chksum( 0, ( u8_t* )data, len ) );
+}
+
+#ifndef UIP_ARCH_IPCHKSUM
+u16_t uip_ipchksum()
+{
+  u16_t sum = elua_chksum( 0, &uip_buf[ UIP_LLH_LEN ], UIP_IPH_LEN );
+
+  return sum == 0 ? 0xFFFF : htons( sum );
+}
+#endif
+
+#if UIP_TCP || UIP_UDP_CHECKSUMS
+static u16_t elua_uip_upper_layer_chksum( u8_t proto )
+{
+  u16_t len = ( ( ( u16_t )IPBUF->len[ 0 ] << 8 ) + IPBUF->len[ 1 ] ) - UIP_IPH_LEN;
+  u16_t sum;
+
+  // Pseudoheader: protocol and length (cannot carry), source and destination
+  sum = elua_chksum( len + proto, ( u8_t* )&IPBUF->srcipaddr[ 0 ], 2 * sizeof( uip_ipaddr_t ) );
+  // Upper layer header and data
+  sum = elua_chksum( sum, &uip_buf[ UIP_IPH_LEN + UIP_LLH_LEN ], len );
+  return sum == 0 ? 0xFFFF : htons( sum );
+}
+#endif
+
+#if UIP_TCP
+u16_t uip_tcpchksum()
+{
+  return elua_uip_upper_layer_chksum( UIP_PROTO_TCP );
+}
+#endif
+
+#if UIP_UDP_CHECKSUMS
+u16_t uip_udpchksum()
+{
+  return elua_uip_upper_layer_chksum( UIP_PROTO_UDP );
+}
+#endif
+
+#endif // #if UIP_ARCH_CHKSUM
+
 #endif // #ifdef BUILD_UIP
@@ -35,6 +35,24 @@ DRESULT disk_write (BYTE, const BYTE*, DWORD, BYTE);
 #endif
 DRESULT disk_ioctl (BYTE, BYTE, void*);
 
+/* eLua: FatFs accesses the disk through a sector cache if
+   MMCFS_CACHE_SECTORS is defined (see mmcfs.c) */
+#if defined( MMCFS_CACHE_SECTORS ) && MMCFS_CACHE_SECTORS > 0
+DSTATUS mmcfs_cache_initialize (BYTE);
+DRESULT mmcfs_cache_read (BYTE, BYTE*, DWORD, BYTE);
+DRESULT mmcfs_cache_write (BYTE, const BYTE*, DWORD, BYTE);
+DRESULT mmcfs_cache_ioctl (BYTE, BYTE, void*);
+#define ff_disk_initialize	mmcfs_cache_initialize
+#define ff_disk_read		mmcfs_cache_read
+#define ff_disk_write		mmcfs_cache_write
+#define ff_disk_ioctl		mmcfs_cache_ioctl
+#else
+#define ff_disk_initialize	disk_initialize
+#define ff_disk_read		disk_read
+#define ff_disk_write		disk_write
+#define ff_disk_ioctl		disk_ioctl
+#endif
+
 
 
 /* Disk Status Bits (DSTATUS) */
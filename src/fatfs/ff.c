@@ -255,20 +255,20 @@ FRESULT move_window (
 	if (wsect != sector) {	/* Changed current window */
 #if !_FS_READONLY
 		if (fs->wflag) {	/* Write back dirty window if needed */
-			if (disk_write(fs->drive, fs->win, wsect, 1) != RES_OK)
+			if (ff_disk_write(fs->drive, fs->win, wsect, 1) != RES_OK)
 				return FR_DISK_ERR;
 			fs->wflag = 0;
 			if (wsect < (fs->fatbase + fs->sects_fat)) {	/* In FAT area */
 				BYTE nf;
 				for (nf = fs->n_fats; nf > 1; nf--) {	/* Refrect the change to all FAT copies */
 					wsect += fs->sects_fat;
-					disk_write(fs->drive, fs->win, wsect, 1);
+					ff_disk_write(fs->drive, fs->win, wsect, 1);
 				}
 			}
 		}
 #endif
 		if (sector) {
-			if (disk_read(fs->drive, fs->win, sector, 1) != RES_OK)
+			if (ff_disk_read(fs->drive, fs->win, sector, 1) != RES_OK)
 				return FR_DISK_ERR;
 			fs->winsect = sector;
 		}
@@ -303,11 +303,11 @@ FRESULT ff_sync (	/* FR_OK: successful, FR_DISK_ERR: failed */
 			ST_DWORD(fs->win+FSI_StrucSig, 0x61417272);
 			ST_DWORD(fs->win+FSI_Free_Count, fs->free_clust);
 			ST_DWORD(fs->win+FSI_Nxt_Free, fs->last_clust);
-			disk_write(fs->drive, fs->win, fs->fsi_sector, 1);
+			ff_disk_write(fs->drive, fs->win, fs->fsi_sector, 1);
 			fs->fsi_flag = 0;
 		}
 		/* Make sure that no pending write process in the physical drive */
-		if (disk_ioctl(fs->drive, CTRL_SYNC, (void*)NULL) != RES_OK)
+		if (ff_disk_ioctl(fs->drive, CTRL_SYNC, (void*)NULL) != RES_OK)
 			res = FR_DISK_ERR;
 	}
 
@@ -539,6 +539,75 @@ static DWORD clust2sect (	/* !=0: Sector number, 0: Failed - invalid cluster# */
 
 
 
+#if _USE_FASTSEEK
+/*-----------------------------------------------------------------------*/
+/* Get cluster# from the cluster link map table                          */
+/*-----------------------------------------------------------------------*/
+
+static
+DWORD clmt_clust (	/* <2:Error, >=2:Cluster# */
+	FIL *fp,		/* Pointer to the file object */
+	DWORD ofs		/* File offset to be converted to cluster# */
+)
+{
+	DWORD cl, ncl, *tbl;
+
+
+	tbl = fp->cltbl + 1;	/* Top of the table (skip the table size) */
+	cl = ofs / SS(fp->fs) / fp->fs->csize;	/* Cluster order from top of the file */
+	for (;;) {
+		ncl = *tbl++;			/* Number of clusters in the fragment */
+		if (!ncl) return 0;		/* End of table? (error) */
+		if (cl < ncl) break;	/* In this fragment? */
+		cl -= ncl; tbl++;		/* Next fragment */
+	}
+	return cl + *tbl;	/* Return the cluster number */
+}
+#endif /* _USE_FASTSEEK */
+
+
+
+
+#if _FS_CONTIG_XFER
+/*-----------------------------------------------------------------------*/
+/* Extend a direct transfer over the following contiguous clusters       */
+/*-----------------------------------------------------------------------*/
+
+static
+UINT contig_sects (	/* Number of sectors to transfer from the current sector */
+	FIL *fp,		/* Pointer to the file object */
+	UINT cc,		/* Number of sectors requested (more than left in the cluster) */
+	BYTE wr			/* 0:Follow the cluster chain, 1:Stretch it if needed */
+)
+{
+	DWORD clst;
+	UINT n, csize = fp->fs->csize;
+
+
+	n = csize - fp->csect;	/* Sectors left in the current cluster */
+	while (n + csize <= cc && n + csize <= 255) {	/* Whole clusters only */
+#if !_FS_READONLY
+		if (wr)
+			clst = create_chain(fp->fs, fp->curr_clust);
+		else
+#endif
+#if _USE_FASTSEEK
+		if (fp->cltbl)
+			clst = clmt_clust(fp, fp->fptr + n * SS(fp->fs));
+		else
+#endif
+			clst = get_fat(fp->fs, fp->curr_clust);
+		if (clst != fp->curr_clust + 1) break;	/* Not contiguous (errors are left to the caller) */
+		fp->curr_clust = clst;
+		n += csize;
+	}
+	return n;
+}
+#endif /* _FS_CONTIG_XFER */
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Directory handling - Seek directory index                             */
 /*-----------------------------------------------------------------------*/
@@ -1441,7 +1510,7 @@ BYTE check_fs (	/* 0:The FAT boot record, 1:Valid boot record but not an FAT, 2:
 	DWORD sect	/* Sector# (lba) to check if it is an FAT boot record or not */
 )
 {
-	if (disk_read(fs->drive, fs->win, sect, 1) != RES_OK)	/* Load boot record */
+	if (ff_disk_read(fs->drive, fs->win, sect, 1) != RES_OK)	/* Load boot record */
 		return 3;
 	if (LD_WORD(&fs->win[BS_55AA]) != 0xAA55)		/* Check record signature (always placed at offset 510 even if the sector size is >512) */
 		return 2;
@@ -1509,11 +1578,11 @@ static FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occured */
 
 	fs->fs_type = 0;					/* Clear the file system object */
 	fs->drive = (BYTE)LD2PD(vol);		/* Bind the logical drive and a physical drive */
-	stat = disk_initialize(fs->drive);	/* Initialize low level disk I/O layer */
+	stat = ff_disk_initialize(fs->drive);	/* Initialize low level disk I/O layer */
 	if (stat & STA_NOINIT)				/* Check if the drive is ready */
 		return FR_NOT_READY;
 #if _MAX_SS != 512						/* Get disk sector size if needed */
-	if (disk_ioctl(fs->drive, GET_SECTOR_SIZE, &SS(fs)) != RES_OK || SS(fs) > _MAX_SS)
+	if (ff_disk_ioctl(fs->drive, GET_SECTOR_SIZE, &SS(fs)) != RES_OK || SS(fs) > _MAX_SS)
 		return FR_NO_FILESYSTEM;
 #endif
 #if !_FS_READONLY
@@ -1567,7 +1636,7 @@ static FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occured */
 	if (fmt == FS_FAT32) {
 	 	fs->fsi_flag = 0;
 		fs->fsi_sector = bsect + LD_WORD(fs->win+BPB_FSInfo);
-		if (disk_read(fs->drive, fs->win, fs->fsi_sector, 1) == RES_OK &&
+		if (ff_disk_read(fs->drive, fs->win, fs->fsi_sector, 1) == RES_OK &&
 			LD_WORD(fs->win+BS_55AA) == 0xAA55 &&
 			LD_DWORD(fs->win+FSI_LeadSig) == 0x41615252 &&
 			LD_DWORD(fs->win+FSI_StrucSig) == 0x61417272) {
@@ -1747,6 +1816,9 @@ FRESULT f_open (
 	fp->fsize = LD_DWORD(dir+DIR_FileSize);	/* File size */
 	fp->fptr = 0; fp->csect = 255;		/* File pointer */
 	fp->dsect = 0;
+#if _USE_FASTSEEK
+	fp->cltbl = 0;						/* Normal seek mode */
+#endif
 	fp->fs = dj.fs; fp->id = dj.fs->id;	/* Owner file system object of the file */
 
 	LEAVE_FF(dj.fs, FR_OK);
@@ -1787,6 +1859,11 @@ FRESULT f_read (
 		rbuff += rcnt, fp->fptr += rcnt, *br += rcnt, btr -= rcnt) {
 		if ((fp->fptr % SS(fp->fs)) == 0) {			/* On the sector boundary? */
 			if (fp->csect >= fp->fs->csize) {		/* On the cluster boundary? */
+#if _USE_FASTSEEK
+				if (fp->cltbl && fp->fptr)			/* Get the cluster from the link map table */
+					clst = clmt_clust(fp, fp->fptr);
+				else
+#endif
 				clst = (fp->fptr == 0) ?			/* On the top of the file? */
 					fp->org_clust : get_fat(fp->fs, fp->curr_clust);
 				if (clst <= 1) ABORT(fp->fs, FR_INT_ERR);
@@ -1800,8 +1877,12 @@ FRESULT f_read (
 			cc = btr / SS(fp->fs);					/* When remaining bytes >= sector size, */
 			if (cc) {								/* Read maximum contiguous sectors directly */
 				if (fp->csect + cc > fp->fs->csize)	/* Clip at cluster boundary */
+#if _FS_CONTIG_XFER
+					cc = contig_sects(fp, cc, 0);	/* or at the end of the contiguous clusters */
+#else
 					cc = fp->fs->csize - fp->csect;
-				if (disk_read(fp->fs->drive, rbuff, sect, (BYTE)cc) != RES_OK)
+#endif
+				if (ff_disk_read(fp->fs->drive, rbuff, sect, (BYTE)cc) != RES_OK)
 					ABORT(fp->fs, FR_DISK_ERR);
 #if !_FS_READONLY && _FS_MINIMIZE <= 2
 #if _FS_TINY
@@ -1812,20 +1893,20 @@ FRESULT f_read (
 					mem_cpy(rbuff + ((fp->dsect - sect) * SS(fp->fs)), fp->buf, SS(fp->fs));
 #endif
 #endif
-				fp->csect += (BYTE)cc;				/* Next sector address in the cluster */
+				fp->csect = (BYTE)((fp->csect + cc - 1) % fp->fs->csize + 1);	/* Next sector address in the (last) cluster */
 				rcnt = SS(fp->fs) * cc;				/* Number of bytes transferred */
 				continue;
 			}
 #if !_FS_TINY
 #if !_FS_READONLY
 			if (fp->flag & FA__DIRTY) {			/* Write sector I/O buffer if needed */
-				if (disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
+				if (ff_disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
 					ABORT(fp->fs, FR_DISK_ERR);
 				fp->flag &= ~FA__DIRTY;
 			}
 #endif
 			if (fp->dsect != sect) {			/* Fill sector buffer with file data */
-				if (disk_read(fp->fs->drive, fp->buf, sect, 1) != RES_OK)
+				if (ff_disk_read(fp->fs->drive, fp->buf, sect, 1) != RES_OK)
 					ABORT(fp->fs, FR_DISK_ERR);
 			}
 #endif
@@ -1899,7 +1980,7 @@ FRESULT f_write (
 				ABORT(fp->fs, FR_DISK_ERR);
 #else
 			if (fp->flag & FA__DIRTY) {		/* Write back data buffer prior to following direct transfer */
-				if (disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
+				if (ff_disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
 					ABORT(fp->fs, FR_DISK_ERR);
 				fp->flag &= ~FA__DIRTY;
 			}
@@ -1910,8 +1991,12 @@ FRESULT f_write (
 			cc = btw / SS(fp->fs);					/* When remaining bytes >= sector size, */
 			if (cc) {								/* Write maximum contiguous sectors directly */
 				if (fp->csect + cc > fp->fs->csize)	/* Clip at cluster boundary */
+#if _FS_CONTIG_XFER
+					cc = contig_sects(fp, cc, 1);	/* or at the end of the contiguous clusters */
+#else
 					cc = fp->fs->csize - fp->csect;
-				if (disk_write(fp->fs->drive, wbuff, sect, (BYTE)cc) != RES_OK)
+#endif
+				if (ff_disk_write(fp->fs->drive, wbuff, sect, (BYTE)cc) != RES_OK)
 					ABORT(fp->fs, FR_DISK_ERR);
 #if _FS_TINY
 				if (fp->fs->winsect - sect < cc) {	/* Refill sector cache if it gets dirty by the direct write */
@@ -1924,7 +2009,7 @@ FRESULT f_write (
 					fp->flag &= ~FA__DIRTY;
 				}
 #endif
-				fp->csect += (BYTE)cc;				/* Next sector address in the cluster */
+				fp->csect = (BYTE)((fp->csect + cc - 1) % fp->fs->csize + 1);	/* Next sector address in the (last) cluster */
 				wcnt = SS(fp->fs) * cc;				/* Number of bytes transferred */
 				continue;
 			}
@@ -1936,7 +2021,7 @@ FRESULT f_write (
 #else
 			if (fp->dsect != sect) {				/* Fill sector buffer with file data */
 				if (fp->fptr < fp->fsize &&
-					disk_read(fp->fs->drive, fp->buf, sect, 1) != RES_OK)
+					ff_disk_read(fp->fs->drive, fp->buf, sect, 1) != RES_OK)
 						ABORT(fp->fs, FR_DISK_ERR);
 			}
 #endif
@@ -1983,7 +2068,7 @@ FRESULT f_sync (
 		if (fp->flag & FA__WRITTEN) {	/* Has the file been written? */
 #if !_FS_TINY	/* Write-back dirty buffer */
 			if (fp->flag & FA__DIRTY) {
-				if (disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
+				if (ff_disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
 					LEAVE_FF(fp->fs, FR_DISK_ERR);
 				fp->flag &= ~FA__DIRTY;
 			}
@@ -2111,6 +2196,62 @@ FRESULT f_lseek (
 	if (res != FR_OK) LEAVE_FF(fp->fs, res);
 	if (fp->flag & FA__ERROR)			/* Check abort flag */
 		LEAVE_FF(fp->fs, FR_INT_ERR);
+#if _USE_FASTSEEK
+	if (fp->cltbl) {					/* Fast seek */
+		DWORD cl, pcl, ncl, tcl, dsc, tlen, ulen, *tbl;
+
+#if !_FS_READONLY
+		if (fp->flag & FA_WRITE)		/* The link map is not updated when the file grows */
+			LEAVE_FF(fp->fs, FR_DENIED);
+#endif
+		if (ofs == CREATE_LINKMAP) {	/* Create the cluster link map table */
+			tbl = fp->cltbl;
+			tlen = *tbl++; ulen = 2;	/* Given table size and required table size */
+			cl = fp->org_clust;			/* Top of the chain */
+			if (cl) {
+				do {
+					/* Get a fragment */
+					tcl = cl; ncl = 0; ulen += 2;	/* Top, length and used items */
+					do {
+						pcl = cl; ncl++;
+						cl = get_fat(fp->fs, cl);
+						if (cl <= 1) ABORT(fp->fs, FR_INT_ERR);
+						if (cl == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
+					} while (cl == pcl + 1);
+					if (ulen <= tlen) {		/* Store the length and top of the fragment */
+						*tbl++ = ncl; *tbl++ = tcl;
+					}
+				} while (cl < fp->fs->max_clust);	/* Repeat until end of chain */
+			}
+			*fp->cltbl = ulen;			/* Number of items used */
+			if (ulen <= tlen)
+				*tbl = 0;				/* Terminate table */
+			else
+				res = FR_NOT_ENOUGH_CORE;	/* Given table size is smaller than required */
+		} else {
+			if (ofs > fp->fsize) ofs = fp->fsize;	/* Clip offset at the file size */
+			fp->fptr = ofs; fp->csect = 255;
+			if (ofs) {
+				fp->curr_clust = clmt_clust(fp, ofs - 1);	/* Cluster of the last byte before the file pointer */
+				if (fp->curr_clust <= 1) ABORT(fp->fs, FR_INT_ERR);
+				fp->csect = (BYTE)(((ofs - 1) / SS(fp->fs)) & (fp->fs->csize - 1)) + 1;	/* Next sector in the cluster */
+				if (ofs % SS(fp->fs)) {
+					dsc = clust2sect(fp->fs, fp->curr_clust);
+					if (!dsc) ABORT(fp->fs, FR_INT_ERR);
+					dsc += fp->csect - 1;
+					if (dsc != fp->dsect) {		/* Load the sector if needed */
+#if !_FS_TINY
+						if (ff_disk_read(fp->fs->drive, fp->buf, dsc, 1) != RES_OK)
+							ABORT(fp->fs, FR_DISK_ERR);
+#endif
+						fp->dsect = dsc;
+					}
+				}
+			}
+		}
+		LEAVE_FF(fp->fs, res);
+	}
+#endif
 	if (ofs > fp->fsize					/* In read-only mode, clip offset with the file size */
 #if !_FS_READONLY
 		 && !(fp->flag & FA_WRITE)
@@ -2169,12 +2310,12 @@ FRESULT f_lseek (
 #if !_FS_TINY
 #if !_FS_READONLY
 		if (fp->flag & FA__DIRTY) {			/* Write-back dirty buffer if needed */
-			if (disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
+			if (ff_disk_write(fp->fs->drive, fp->buf, fp->dsect, 1) != RES_OK)
 				ABORT(fp->fs, FR_DISK_ERR);
 			fp->flag &= ~FA__DIRTY;
 		}
 #endif
-		if (disk_read(fp->fs->drive, fp->buf, nsect, 1) != RES_OK)
+		if (ff_disk_read(fp->fs->drive, fp->buf, nsect, 1) != RES_OK)
 			ABORT(fp->fs, FR_DISK_ERR);
 #endif
 		fp->dsect = nsect;
@@ -2739,6 +2880,11 @@ FRESULT f_forward (
 		fp->fptr += rcnt, *bf += rcnt, btr -= rcnt) {
 		if ((fp->fptr % SS(fp->fs)) == 0) {			/* On the sector boundary? */
 			if (fp->csect >= fp->fs->csize) {		/* On the cluster boundary? */
+#if _USE_FASTSEEK
+				if (fp->cltbl && fp->fptr)			/* Get the cluster from the link map table */
+					clst = clmt_clust(fp, fp->fptr);
+				else
+#endif
 				clst = (fp->fptr == 0) ?			/* On the top of the file? */
 					fp->org_clust : get_fat(fp->fs, fp->curr_clust);
 				if (clst <= 1) ABORT(fp->fs, FR_INT_ERR);
@@ -2804,15 +2950,15 @@ FRESULT f_mkfs (
 	drv = LD2PD(drv);
 
 	/* Get disk statics */
-	stat = disk_initialize(drv);
+	stat = ff_disk_initialize(drv);
 	if (stat & STA_NOINIT) return FR_NOT_READY;
 	if (stat & STA_PROTECT) return FR_WRITE_PROTECTED;
 #if _MAX_SS != 512						/* Get disk sector size */
-	if (disk_ioctl(drv, GET_SECTOR_SIZE, &SS(fs)) != RES_OK
+	if (ff_disk_ioctl(drv, GET_SECTOR_SIZE, &SS(fs)) != RES_OK
 		|| SS(fs) > _MAX_SS)
 		return FR_MKFS_ABORTED;
 #endif
-	if (disk_ioctl(drv, GET_SECTOR_COUNT, &n_part) != RES_OK || n_part < MIN_SECTOR)
+	if (ff_disk_ioctl(drv, GET_SECTOR_COUNT, &n_part) != RES_OK || n_part < MIN_SECTOR)
 		return FR_MKFS_ABORTED;
 	if (n_part > MAX_SECTOR) n_part = MAX_SECTOR;
 	b_part = (!partition) ? 63 : 0;		/* Boot sector */
@@ -2857,7 +3003,7 @@ FRESULT f_mkfs (
 	b_data = b_dir + n_dir;			/* Data start sector */
 
 	/* Align data start sector to erase block boundary (for flash memory media) */
-	if (disk_ioctl(drv, GET_BLOCK_SIZE, &n) != RES_OK) return FR_MKFS_ABORTED;
+	if (ff_disk_ioctl(drv, GET_BLOCK_SIZE, &n) != RES_OK) return FR_MKFS_ABORTED;
 	n = (b_data + n - 1) & ~(n - 1);
 	n_fat += (n - b_data) / N_FATS;
 	/* b_dir and b_data are no longer used below */
@@ -2890,7 +3036,7 @@ FRESULT f_mkfs (
 		ST_DWORD(tbl+8, 63);			/* Partition start in LBA */
 		ST_DWORD(tbl+12, n_part);		/* Partition size in LBA */
 		ST_WORD(tbl+64, 0xAA55);		/* Signature */
-		if (disk_write(drv, fs->win, 0, 1) != RES_OK)
+		if (ff_disk_write(drv, fs->win, 0, 1) != RES_OK)
 			return FR_DISK_ERR;
 		partition = 0xF8;
 	} else {
@@ -2936,10 +3082,10 @@ FRESULT f_mkfs (
 	if (SS(fs) > 512U) {
 		ST_WORD(tbl+SS(fs)-2, 0xAA55);
 	}
-	if (disk_write(drv, tbl, b_part+0, 1) != RES_OK)
+	if (ff_disk_write(drv, tbl, b_part+0, 1) != RES_OK)
 		return FR_DISK_ERR;
 	if (fmt == FS_FAT32)
-		disk_write(drv, tbl, b_part+6, 1);
+		ff_disk_write(drv, tbl, b_part+6, 1);
 
 	/* Initialize FAT area */
 	for (m = 0; m < N_FATS; m++) {
@@ -2953,11 +3099,11 @@ FRESULT f_mkfs (
 			ST_DWORD(tbl+4, 0xFFFFFFFF);
 			ST_DWORD(tbl+8, 0x0FFFFFFF);	/* Reserve cluster #2 for root dir */
 		}
-		if (disk_write(drv, tbl, b_fat++, 1) != RES_OK)
+		if (ff_disk_write(drv, tbl, b_fat++, 1) != RES_OK)
 			return FR_DISK_ERR;
 		mem_set(tbl, 0, SS(fs));		/* Following FAT entries are filled by zero */
 		for (n = 1; n < n_fat; n++) {
-			if (disk_write(drv, tbl, b_fat++, 1) != RES_OK)
+			if (ff_disk_write(drv, tbl, b_fat++, 1) != RES_OK)
 				return FR_DISK_ERR;
 		}
 	}
@@ -2965,7 +3111,7 @@ FRESULT f_mkfs (
 	/* Initialize Root directory */
 	m = (BYTE)((fmt == FS_FAT32) ? allocsize : n_dir);
 	do {
-		if (disk_write(drv, tbl, b_fat++, 1) != RES_OK)
+		if (ff_disk_write(drv, tbl, b_fat++, 1) != RES_OK)
 			return FR_DISK_ERR;
 	} while (--m);
 
@@ -2976,11 +3122,11 @@ FRESULT f_mkfs (
 		ST_DWORD(tbl+FSI_StrucSig, 0x61417272);
 		ST_DWORD(tbl+FSI_Free_Count, n_clst - 1);
 		ST_DWORD(tbl+FSI_Nxt_Free, 0xFFFFFFFF);
-		disk_write(drv, tbl, b_part+1, 1);
-		disk_write(drv, tbl, b_part+7, 1);
+		ff_disk_write(drv, tbl, b_part+1, 1);
+		ff_disk_write(drv, tbl, b_part+7, 1);
 	}
 
-	return (disk_ioctl(drv, CTRL_SYNC, (void*)NULL) == RES_OK) ? FR_OK : FR_DISK_ERR;
+	return (ff_disk_ioctl(drv, CTRL_SYNC, (void*)NULL) == RES_OK) ? FR_OK : FR_DISK_ERR;
 }
 
 #endif /* _USE_MKFS && !_FS_READONLY */
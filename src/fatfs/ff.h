@@ -366,6 +366,9 @@ typedef struct _FIL_ {
 	DWORD	dir_sect;	/* Sector containing the directory entry */
 	BYTE*	dir_ptr;	/* Ponter to the directory entry in the window */
 #endif
+#if _USE_FASTSEEK
+	DWORD*	cltbl;		/* Pointer to the cluster link map table (null on file open) */
+#endif
 #if !_FS_TINY
 	BYTE	buf[_MAX_SS];/* File R/W buffer */
 #endif
@@ -407,7 +410,8 @@ typedef enum {
 	FR_NOT_ENABLED,		/* 12 */
 	FR_NO_FILESYSTEM,	/* 13 */
 	FR_MKFS_ABORTED,	/* 14 */
-	FR_TIMEOUT			/* 15 */
+	FR_TIMEOUT,			/* 15 */
+	FR_NOT_ENOUGH_CORE	/* 16 */
 } FRESULT;
 
 
@@ -420,6 +424,9 @@ FRESULT f_open (FIL*, const XCHAR*, BYTE);			/* Open or create a file */
 FRESULT f_read (FIL*, void*, UINT, UINT*);			/* Read data from a file */
 FRESULT f_write (FIL*, const void*, UINT, UINT*);	/* Write data to a file */
 FRESULT f_lseek (FIL*, DWORD);						/* Move file pointer of a file object */
+#if _USE_FASTSEEK
+#define CREATE_LINKMAP	0xFFFFFFFF					/* f_lseek offset: create the cluster link map table */
+#endif
 FRESULT f_close (FIL*);								/* Close an open file object */
 FRESULT f_opendir (DIR*, const XCHAR*);				/* Open an existing directory */
 FRESULT f_readdir (DIR*, FILINFO*);					/* Read a directory item */
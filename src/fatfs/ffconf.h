@@ -52,6 +52,19 @@
 /* To enable f_forward function, set _USE_FORWARD to 1 and set _FS_TINY to 1. */
 
 
+#define	_USE_FASTSEEK	1	/* 0 or 1 */
+/* To enable the fast seek feature (cluster link map table in the file object,
+/  see f_lseek), set _USE_FASTSEEK to 1. This is an eLua addition backported
+/  from later FatFs versions and it works only on files opened in read mode. */
+
+
+#define	_FS_CONTIG_XFER	1	/* 0 or 1 */
+/* When _FS_CONTIG_XFER is set to 1, f_read and f_write transfer the sectors of
+/  contiguous clusters with a single disk_read/disk_write call (up to 255
+/  sectors) instead of splitting the transfer at each cluster boundary, so the
+/  disk driver can use multiple block commands. This is an eLua addition. */
+
+
 
 /*---------------------------------------------------------------------------/
 / Locale and Namespace Configurations
@@ -98,6 +98,8 @@ LUA_API int lua_checkstack (lua_State *L, int size) {
   lua_lock(L);
   if (size > LUAI_MAXCSTACK || (L->top - L->base + size) > LUAI_MAXCSTACK)
     res = 0;  /* stack overflow */
+  else if (L->stacklimit > 0 && (L->top - L->stack + size) > L->stacklimit)
+    res = 0;  /* over the thread's stack limit */
   else if (size > 0) {
     luaD_checkstack(L, size);
     if (L->ci->top < L->top + size)
@@ -328,6 +330,10 @@ LUA_API lua_Number lua_tonumber (lua_State *L, int idx) {
 LUA_API lua_Integer lua_tointeger (lua_State *L, int idx) {
   TValue n;
   const TValue *o = index2adr(L, idx);
+#ifdef LUA_NUMBER_DUAL
+  if (ttisint(o))
+    return ivalue(o);
+#endif
   if (tonumber(o, &n)) {
     lua_Integer res;
     lua_Number num = nvalue(o);
@@ -437,7 +443,7 @@ LUA_API void lua_pushnil (lua_State *L) {
 
 LUA_API void lua_pushnumber (lua_State *L, lua_Number n) {
   lua_lock(L);
-  setnvalue(L->top, n);
+  luaO_setnum(L->top, n);
   api_incr_top(L);
   lua_unlock(L);
 }
@@ -445,7 +451,16 @@ LUA_API void lua_pushnumber (lua_State *L, lua_Number n) {
 
 LUA_API void lua_pushinteger (lua_State *L, lua_Integer n) {
   lua_lock(L);
+#ifdef LUA_NUMBER_DUAL
+  if (cast(lua_Integer, cast_int(n)) == n) {
+    setivalue(L->top, cast_int(n));
+  }
+  else {
+    setnvalue(L->top, cast_num(n));
+  }
+#else
   setnvalue(L->top, cast_num(n));
+#endif
   api_incr_top(L);
   lua_unlock(L);
 }
@@ -812,6 +827,16 @@ LUA_API int lua_setfenv (lua_State *L, int idx) {
 }
 
 
+LUA_API void lua_cleartable (lua_State *L, int idx) {
+  StkId t;
+  lua_lock(L);
+  t = index2adr(L, idx);
+  api_check(L, ttistable(t));
+  luaH_clear(hvalue(t));
+  lua_unlock(L);
+}
+
+
 /*
 ** `load' and `call' functions (run Lua code)
 */
@@ -1029,6 +1054,49 @@ LUA_API int lua_gc (lua_State *L, int what, int data) {
 }
 
 
+LUA_API int lua_stackctl (lua_State *L, int what, int data) {
+  int res = 0;
+  lua_lock(L);
+  switch (what) {
+    case LUA_STKSETLIMIT: {
+      res = L->stacklimit;
+      if (data > 0 && data < L->stacksize - EXTRA_STACK - 1)
+        data = L->stacksize - EXTRA_STACK - 1;  /* can't be below the current size */
+      L->stacklimit = data > 0 ? data : 0;
+      break;
+    }
+    case LUA_STKGETLIMIT: {
+      res = L->stacklimit;
+      break;
+    }
+    case LUA_STKSIZE: {
+      res = L->stacksize - EXTRA_STACK - 1;
+      break;
+    }
+    case LUA_STKPEAK: {
+      res = L->stackpeak;
+      break;
+    }
+    case LUA_STKCISIZE: {
+      res = L->size_ci;
+      break;
+    }
+    case LUA_STKSHRINK: {
+      luaD_shrinkstack(L);
+      res = L->stacksize - EXTRA_STACK - 1;
+      break;
+    }
+    case LUA_STKBYTES: {
+      res = cast_int(L->stacksize * sizeof(TValue) + L->size_ci * sizeof(CallInfo));
+      break;
+    }
+    default: res = -1;  /* invalid option */
+  }
+  lua_unlock(L);
+  return res;
+}
+
+
 
 /*
 ** miscellaneous functions
@@ -617,9 +617,12 @@ static int luaB_auxwrap (lua_State *L) {
 
 
 static int luaB_cocreate (lua_State *L) {
+  int maxstack = luaL_optint(L, 2, 0);
   lua_State *NL = lua_newthread(L);
   luaL_argcheck(L, lua_isfunction(L, 1) && !lua_iscfunction(L, 1), 1,
     "Lua function expected");
+  luaL_argcheck(L, maxstack >= 0, 2, "invalid stack limit");
+  lua_stackctl(NL, LUA_STKSETLIMIT, maxstack);
   lua_pushvalue(L, 1);  /* move function to top */
   lua_xmove(L, NL, 1);  /* move function from L to NL */
   return 1;
@@ -644,6 +647,18 @@ static int luaB_corunning (lua_State *L) {
   return 1;
 }
 
+
+static int luaB_costats (lua_State *L) {
+  lua_State *co = lua_isnoneornil(L, 1) ? L : lua_tothread(L, 1);
+  luaL_argcheck(L, co, 1, "coroutine expected");
+  lua_pushinteger(L, lua_stackctl(co, LUA_STKSIZE, 0));
+  lua_pushinteger(L, lua_stackctl(co, LUA_STKPEAK, 0));
+  lua_pushinteger(L, lua_stackctl(co, LUA_STKGETLIMIT, 0));
+  lua_pushinteger(L, lua_stackctl(co, LUA_STKCISIZE, 0));
+  lua_pushinteger(L, lua_stackctl(co, LUA_STKBYTES, 0));
+  return 5;
+}
+
 #undef MIN_OPT_LEVEL
 #define MIN_OPT_LEVEL 1
 #include "lrodefs.h"
@@ -651,6 +666,7 @@ const LUA_REG_TYPE co_funcs[] = {
   {LSTRKEY("create"), LFUNCVAL(luaB_cocreate)},
   {LSTRKEY("resume"), LFUNCVAL(luaB_coresume)},
   {LSTRKEY("running"), LFUNCVAL(luaB_corunning)},
+  {LSTRKEY("stats"), LFUNCVAL(luaB_costats)},
   {LSTRKEY("status"), LFUNCVAL(luaB_costatus)},
   {LSTRKEY("wrap"), LFUNCVAL(luaB_cowrap)},
   {LSTRKEY("yield"), LFUNCVAL(luaB_yield)},
@@ -30,6 +30,11 @@
 #include "lvm.h"
 #include "lzio.h"
 
+#ifndef LUA_CROSS_COMPILER
+#include "platform_conf.h"
+#endif
+#include "elua_profile.h"
+
 
 
 
@@ -77,6 +82,15 @@ static void restore_stack_limit (lua_State *L) {
     if (inuse + 1 < LUAI_MAXCALLS)  /* can `undo' overflow? */
       luaD_reallocCI(L, LUAI_MAXCALLS);
   }
+  if (L->stacklimit > 0 &&
+      L->stacksize - EXTRA_STACK - 1 > L->stacklimit) {  /* over the limit? */
+    CallInfo *ci;
+    StkId lim = L->top;
+    for (ci = L->base_ci; ci <= L->ci; ci++)
+      if (lim < ci->top) lim = ci->top;
+    if (lim - L->stack < L->stacklimit)  /* can `undo' overflow? */
+      luaD_reallocstack(L, L->stacklimit);
+  }
 }
 
 
@@ -152,6 +166,7 @@ void luaD_reallocstack (lua_State *L, int newsize) {
   if (!block_status) unset_block_gc(L);  /* Honour the previous block status */
   L->stacksize = realsize;
   L->stack_last = L->stack+newsize;
+  if (newsize > L->stackpeak) L->stackpeak = newsize;
   correctstack(L, oldstack);
 }
 
@@ -165,11 +180,63 @@ void luaD_reallocCI (lua_State *L, int newsize) {
 }
 
 
+/*
+** Extra stack space that a thread with a stack limit can use while it
+** handles a stack overflow (the error message and a C error handler
+** such as debug.traceback)
+*/
+#define STACK_ERRSPACE	(2*LUA_MINSTACK)
+
+
 void luaD_growstack (lua_State *L, int n) {
-  if (n <= L->stacksize)  /* double size is enough? */
-    luaD_reallocstack(L, 2*L->stacksize);
-  else
-    luaD_reallocstack(L, L->stacksize + n);
+  int newsize = (n <= L->stacksize) ?  /* double size is enough? */
+                2*L->stacksize : L->stacksize + n;
+  if (L->stacklimit > 0 && newsize > L->stacklimit) {  /* thread with a stack limit? */
+    int needed = cast_int(L->top - L->stack) + n;
+    if (L->stacksize - EXTRA_STACK - 1 > L->stacklimit) {  /* handling overflow? */
+      if (needed > L->stacklimit + STACK_ERRSPACE)
+        luaD_throw(L, LUA_ERRERR);  /* overflow while handling overflow */
+      newsize = L->stacklimit + STACK_ERRSPACE;
+    }
+    else if (needed > L->stacklimit) {
+      luaD_reallocstack(L, L->stacklimit + LUA_MINSTACK);  /* space for the error message */
+      luaG_runerror(L, "stack overflow");
+    }
+    else
+      newsize = L->stacklimit;
+  }
+  luaD_reallocstack(L, newsize);
+}
+
+
+/*
+** Shrink the stack and the CallInfo array of a thread when they are
+** much larger than the part in use (called when a coroutine yields or
+** ends, so coroutines don't keep their peak sized stacks until the next
+** GC cycle)
+*/
+void luaD_shrinkstack (lua_State *L) {
+  CallInfo *ci;
+  StkId lim = L->top;
+  int ci_used, s_used, newsize;
+  int block_status;
+  if (L->stack == NULL || isfixedstack(L) || L->size_ci > LUAI_MAXCALLS)
+    return;  /* no stack, can't resize it or handling overflow */
+  for (ci = L->base_ci; ci <= L->ci; ci++)
+    if (lim < ci->top) lim = ci->top;
+  ci_used = cast_int(L->ci - L->base_ci) + 1;
+  s_used = cast_int(lim - L->stack) + 1;
+  block_status = is_block_gc(L);
+  set_block_gc(L);       /* The GC MUST be blocked while the stacks are resized */
+  if (L->size_ci > 4*ci_used && L->size_ci > 2*BASIC_CI_SIZE) {
+    newsize = 2*ci_used;
+    luaD_reallocCI(L, newsize < BASIC_CI_SIZE ? BASIC_CI_SIZE : newsize);
+  }
+  if (L->stacksize > 4*s_used && L->stacksize > 2*(BASIC_STACK_SIZE+EXTRA_STACK)) {
+    newsize = 2*s_used;
+    luaD_reallocstack(L, newsize < BASIC_STACK_SIZE ? BASIC_STACK_SIZE : newsize);
+  }
+  if (!block_status) unset_block_gc(L);  /* Honour the previous block status */
 }
 
 
@@ -314,6 +381,7 @@ int luaD_precall (lua_State *L, StkId func, int nresults) {
     for (st = L->top; st < ci->top; st++)
       setnilvalue(st);
     L->top = ci->top;
+    elua_prof_call(L, p, 0);
     if (L->hookmask & LUA_MASKCALL) {
       L->savedpc++;  /* hooks assume 'pc' is already incremented */
       luaD_callhook(L, LUA_HOOKCALL, -1);
@@ -331,6 +399,7 @@ int luaD_precall (lua_State *L, StkId func, int nresults) {
     ci->top = L->top + LUA_MINSTACK;
     lua_assert(ci->top <= L->stack_last);
     ci->nresults = nresults;
+    elua_prof_call(L, ttisfunction(ci->func) ? (const void *)curr_func(L)->c.f : fvalue(ci->func), 1);
     if (L->hookmask & LUA_MASKCALL)
       luaD_callhook(L, LUA_HOOKCALL, -1);
     lua_unlock(L);
@@ -366,6 +435,7 @@ int luaD_poscall (lua_State *L, StkId firstResult) {
   CallInfo *ci;
   if (L->hookmask & LUA_MASKRET)
     firstResult = callrethooks(L, firstResult);
+  elua_prof_return(L);
   ci = L->ci--;
   res = ci->func;  /* res == final position of 1st result */
   wanted = ci->nresults;
@@ -455,6 +525,7 @@ LUA_API int lua_resume (lua_State *L, int nargs) {
     lua_assert(L->nCcalls == L->baseCcalls);
     status = L->status;
   }
+  luaD_shrinkstack(L);
   --L->nCcalls;
   lua_unlock(L);
   return status;
@@ -211,7 +211,7 @@ static void DumpConstants(const Proto* f, DumpState* D)
    case LUA_TBOOLEAN:
 	DumpChar(bvalue(o),D);
 	break;
-   case LUA_TNUMBER:
+   case LUA_TNUMBER:	/* ints too (LUA_NUMBER_DUAL), see luaO_setnum */
 	DumpNumber(nvalue(o),D);
 	break;
    case LUA_TSTRING:
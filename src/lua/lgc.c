@@ -23,6 +23,11 @@
 #include "ltm.h"
 #include "lrotable.h"
 
+#ifndef LUA_CROSS_COMPILER
+#include "platform_conf.h"
+#endif
+#include "elua_profile.h"
+
 #define GCSTEPSIZE	1024u
 #define GCSWEEPMAX	40
 #define GCSWEEPCOST	10
@@ -526,6 +531,14 @@ static void remarkupvals (global_State *g) {
 }
 
 
+#ifdef BUILD_LUA_PROFILER
+static void markprofproto (const void *p, void *ud) {
+  global_State *g = cast(global_State *, ud);
+  markobject(g, cast(Proto *, p));
+}
+#endif
+
+
 static void atomic (lua_State *L) {
   global_State *g = G(L);
   size_t udsize;  /* total size of userdata to be finalized */
@@ -539,6 +552,9 @@ static void atomic (lua_State *L) {
   lua_assert(!iswhite(obj2gco(g->mainthread)));
   markobject(g, L);  /* mark running thread */
   markmt(g);  /* mark basic metatables (again) */
+#ifdef BUILD_LUA_PROFILER
+  elua_prof_mark(markprofproto, g);  /* functions in the profiler results */
+#endif
   propagateall(g);
   /* remark gray again */
   g->gray = g->grayagain;
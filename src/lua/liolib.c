@@ -18,6 +18,9 @@
 #include "lauxlib.h"
 #include "lualib.h"
 #include "lrotable.h"
+#ifndef LUA_CROSS_COMPILER
+#include "devman.h"
+#endif
 
 
 #define IO_INPUT	1
@@ -338,10 +341,34 @@ static int read_line (lua_State *L, FILE *f) {
 }
 
 
+#ifndef LUA_CROSS_COMPILER
+/* try to return the data in place (as a read-only string) if the file
+   lives in a filesystem that can be mapped directly (ROMFS) */
+static int read_mapped (lua_State *L, FILE *f, size_t *pn) {
+  const char *p;
+  long pos;
+  if (f == stdin || f == stdout || f == stderr)
+    return 0;
+  if ((pos = ftell(f)) < 0)
+    return 0;
+  if ((p = dm_map(fileno(f), pos, pn)) == NULL)
+    return 0;
+  fseek(f, pos + *pn, SEEK_SET);
+  lua_pushrolstring(L, p, *pn);
+  return 1;
+}
+#endif
+
+
 static int read_chars (lua_State *L, FILE *f, size_t n) {
   size_t rlen;  /* how much to read */
   size_t nr;  /* number of chars actually read */
   luaL_Buffer b;
+#ifndef LUA_CROSS_COMPILER
+  size_t ml = n;
+  if (read_mapped(L, f, &ml))
+    return (ml > 0);
+#endif
   luaL_buffinit(L, &b);
   rlen = LUAL_BUFFERSIZE;  /* try to read that much each time */
   do {
@@ -22,6 +22,14 @@
 #include "lualib.h"
 #include "lrotable.h"
 
+#ifndef LUA_CROSS_COMPILER
+#include "platform_conf.h"
+#endif
+
+#ifdef BUILD_REQUIRE_CACHE
+#include "devman.h"
+#endif
+
 /* prefix for open functions in C libraries */
 #define LUA_POF		"luaopen_"
 
@@ -348,6 +356,281 @@ static const char *pushnexttemplate (lua_State *L, const char *path) {
 }
 
 
+#ifdef BUILD_REQUIRE_CACHE
+/*
+** {======================================================
+** Module location cache
+** The result of each path search (the position of the template that
+** matched or "not found") is kept in the registry, together with the
+** value of the device manager generation counter at the time of the
+** search. A result is reused as long as none of the file systems used
+** by the templates that were tried changed since then (a file was
+** created, removed or renamed, or the file system was mounted/unmounted).
+** Changes that eLua doesn't see (for example a file added to the RFS
+** directory on the PC) need a call to 'package.flushcache'.
+** =======================================================
+*/
+
+#define LOADCACHE	"_LOADCACHE"
+
+/* maximum number of templates in a path (used to encode cache entries) */
+#define LOADCACHE_MAXTPL	32
+
+/* maximum line length in a manifest file */
+#define LOADCACHE_MAXLINE	128
+
+
+/* push the cache table, creating it if needed */
+static void getcache (lua_State *L) {
+  lua_getfield(L, LUA_REGISTRYINDEX, LOADCACHE);
+  if (!lua_istable(L, -1)) {
+    lua_pop(L, 1);
+    lua_createtable(L, 0, 3);
+    lua_newtable(L);
+    lua_setfield(L, -2, "hint");  /* "pname:name" -> file name (manifest) */
+    lua_pushvalue(L, -1);
+    lua_setfield(L, LUA_REGISTRYINDEX, LOADCACHE);
+  }
+}
+
+
+/*
+** Push the search results table for 'pname' (name -> result). Its entry
+** [0] is the path used for the searches, the table is emptied when the
+** path changes.
+*/
+static void getloc (lua_State *L, const char *pname, int path) {
+  getcache(L);
+  lua_getfield(L, -1, pname);
+  if (lua_istable(L, -1)) {
+    lua_rawgeti(L, -1, 0);
+    if (lua_rawequal(L, -1, path)) {  /* same path? */
+      lua_pop(L, 1);
+      lua_remove(L, -2);  /* remove cache table */
+      return;
+    }
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+  lua_newtable(L);
+  lua_pushvalue(L, path);
+  lua_rawseti(L, -2, 0);
+  lua_pushvalue(L, -1);
+  lua_setfield(L, -3, pname);
+  lua_remove(L, -2);  /* remove cache table */
+}
+
+
+/* check if none of the file systems of the first 'n' templates changed */
+static int cache_valid (const char *path, u32 stamp, int n) {
+  char dev[DM_MAX_DEV_NAME + 2];
+  const char *l;
+  size_t len;
+  while (n-- > 0) {
+    while (*path == *LUA_PATHSEP) path++;  /* skip separators */
+    if (*path == '\0') break;  /* no more templates */
+    l = strchr(path, *LUA_PATHSEP);
+    if (l == NULL) l = path + strlen(path);
+    for (len = 1; path + len < l && path[len] != '/'; len++) ;
+    if (path + len == l)  /* file on the root ('/') file system */
+      len = 0;
+    else if (len > DM_MAX_DEV_NAME)
+      return 0;
+    memcpy(dev, path, len);
+    strcpy(dev + len, "/");
+    if (dm_get_generation(dev) > stamp)
+      return 0;
+    path = l;
+  }
+  return 1;
+}
+
+
+/*
+** Get the cached search result for 'name'. Returns the position of the
+** template that matched (0 for "not found") or -1 if there is no valid
+** result in the cache.
+*/
+static int cache_get (lua_State *L, const char *pname, int path,
+                                    const char *name) {
+  lua_Number v;
+  u32 stamp;
+  int n;
+  getloc(L, pname, path);
+  lua_getfield(L, -1, name);
+  v = lua_tonumber(L, -1);
+  lua_pop(L, 2);
+  if (v <= 0) return -1;
+  stamp = (u32)(v / LOADCACHE_MAXTPL);
+  n = (int)(v - (lua_Number)stamp * LOADCACHE_MAXTPL);
+  if (!cache_valid(lua_tostring(L, path), stamp, n ? n : LOADCACHE_MAXTPL))
+    return -1;
+  return n;
+}
+
+
+static void cache_set (lua_State *L, const char *pname, int path,
+                                     const char *name, int n) {
+  getloc(L, pname, path);
+  lua_pushnumber(L, (lua_Number)dm_get_current_generation() * LOADCACHE_MAXTPL + n);
+  lua_setfield(L, -2, name);
+  lua_pop(L, 1);
+}
+
+
+/* check if 'fname' is given by one of the templates of 'path' */
+static int inpath (lua_State *L, const char *path, const char *name,
+                                 const char *fname) {
+  int found = 0;
+  while (!found && (path = pushnexttemplate(L, path)) != NULL) {
+    found = strcmp(luaL_gsub(L, lua_tostring(L, -1), LUA_PATH_MARK, name),
+                   fname) == 0;
+    lua_pop(L, 2);  /* remove template and file name */
+  }
+  return found;
+}
+
+
+/*
+** push the file name given by the manifest for 'name' (or nil if there is
+** none or if it isn't in the current path)
+*/
+static void cache_gethint (lua_State *L, const char *pname, const char *path,
+                                         const char *name) {
+  getcache(L);
+  lua_getfield(L, -1, "hint");
+  lua_pushfstring(L, "%s:%s", pname, name);
+  lua_rawget(L, -2);
+  lua_replace(L, -3);
+  lua_pop(L, 1);
+  if (lua_isstring(L, -1) && !inpath(L, path, name, lua_tostring(L, -1))) {
+    lua_pop(L, 1);
+    lua_pushnil(L);
+  }
+}
+
+
+static const char *findfile (lua_State *L, const char *name,
+                                           const char *pname) {
+  const char *path;
+  int pathidx, cached, i = 0;
+  name = luaL_gsub(L, name, ".", LUA_DIRSEP);
+  lua_getfield(L, LUA_ENVIRONINDEX, pname);
+  path = lua_tostring(L, -1);
+  if (path == NULL)
+    luaL_error(L, LUA_QL("package.%s") " must be a string", pname);
+  pathidx = lua_gettop(L);
+  if ((cached = cache_get(L, pname, pathidx, name)) == -1) {
+    cache_gethint(L, pname, path, name);
+    if (lua_isstring(L, -1) && readable(lua_tostring(L, -1)))
+      return lua_tostring(L, -1);  /* found using the manifest */
+    lua_pop(L, 1);
+  }
+  lua_pushliteral(L, "");  /* error accumulator */
+  while ((path = pushnexttemplate(L, path)) != NULL) {
+    const char *filename;
+    filename = luaL_gsub(L, lua_tostring(L, -1), LUA_PATH_MARK, name);
+    lua_remove(L, -2);  /* remove path template */
+    if (++i < LOADCACHE_MAXTPL && cached != -1) {
+      if (cached == i)  /* found here last time */
+        return filename;
+    }
+    else if (readable(filename)) {  /* does file exist and is readable? */
+      if (i < LOADCACHE_MAXTPL) cache_set(L, pname, pathidx, name, i);
+      return filename;  /* return that file name */
+    }
+    lua_pushfstring(L, "\n\tno file " LUA_QS, filename);
+    lua_remove(L, -2);  /* remove file name */
+    lua_concat(L, 2);  /* add entry to possible error message */
+  }
+  if (cached == -1 && i < LOADCACHE_MAXTPL)
+    cache_set(L, pname, pathidx, name, 0);
+  return NULL;  /* not found */
+}
+
+
+static int ll_flushcache (lua_State *L) {
+  lua_pushnil(L);
+  lua_setfield(L, LUA_REGISTRYINDEX, LOADCACHE);
+  return 0;
+}
+
+
+/*
+** Save the location of the modules found so far ("pname:name<TAB>file name"
+** lines). The file can be loaded at boot with 'package.loadcache'.
+*/
+static int ll_savecache (lua_State *L) {
+  static const char *const pnames[] = {"path", "cpath", NULL};
+  const char *fname = luaL_checkstring(L, 1);
+  const char *path;
+  FILE *f;
+  int i, n;
+  if ((f = fopen(fname, "w")) == NULL) {
+    lua_pushboolean(L, 0);
+    return 1;
+  }
+  getcache(L);
+  for (i = 0; pnames[i] != NULL; i++) {
+    lua_getfield(L, -1, pnames[i]);
+    if (lua_istable(L, -1)) {
+      lua_pushnil(L);
+      while (lua_next(L, -2)) {
+        n = (int)lua_tonumber(L, -1) % LOADCACHE_MAXTPL;
+        if (lua_type(L, -2) == LUA_TSTRING && n > 0) {
+          lua_rawgeti(L, -3, 0);
+          path = lua_tostring(L, -1);
+          while ((path = pushnexttemplate(L, path)) != NULL && --n > 0)
+            lua_pop(L, 1);
+          if (path != NULL) {  /* template is at the top */
+            luaL_gsub(L, lua_tostring(L, -1), LUA_PATH_MARK,
+                         lua_tostring(L, -4));
+            fprintf(f, "%s:%s\t%s\n", pnames[i], lua_tostring(L, -5),
+                    lua_tostring(L, -1));
+            lua_pop(L, 2);
+          }
+          lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+  }
+  lua_pushboolean(L, fclose(f) == 0);
+  return 1;
+}
+
+
+/* load a manifest saved by 'package.savecache' */
+static int ll_loadcache (lua_State *L) {
+  const char *fname = luaL_checkstring(L, 1);
+  char line[LOADCACHE_MAXLINE];
+  FILE *f;
+  char *p;
+  size_t l;
+  if ((f = fopen(fname, "r")) == NULL) {
+    lua_pushboolean(L, 0);
+    return 1;
+  }
+  getcache(L);
+  lua_getfield(L, -1, "hint");
+  while (fgets(line, sizeof(line), f) != NULL) {
+    l = strlen(line);
+    if (l > 0 && line[l - 1] == '\n') line[--l] = '\0';
+    if ((p = strchr(line, '\t')) == NULL) continue;
+    lua_pushlstring(L, line, p - line);
+    lua_pushstring(L, p + 1);
+    lua_rawset(L, -3);
+  }
+  fclose(f);
+  lua_pushboolean(L, 1);
+  return 1;
+}
+
+/* }====================================================== */
+
+#else /* #ifdef BUILD_REQUIRE_CACHE */
+
 static const char *findfile (lua_State *L, const char *name,
                                            const char *pname) {
   const char *path;
@@ -371,6 +654,9 @@ static const char *findfile (lua_State *L, const char *name,
 }
 
 
+#endif /* #ifdef BUILD_REQUIRE_CACHE */
+
+
 static void loaderror (lua_State *L, const char *filename) {
   luaL_error(L, "error loading module " LUA_QS " from file " LUA_QS ":\n\t%s",
                 lua_tostring(L, 1), filename, lua_tostring(L, -1));
@@ -617,6 +903,11 @@ static void setpath (lua_State *L, const char *fieldname, const char *envname,
 static const luaL_Reg pk_funcs[] = {
   {"loadlib", ll_loadlib},
   {"seeall", ll_seeall},
+#ifdef BUILD_REQUIRE_CACHE
+  {"flushcache", ll_flushcache},
+  {"savecache", ll_savecache},
+  {"loadcache", ll_loadcache},
+#endif
   {NULL, NULL}
 };
 
@@ -75,6 +75,10 @@ int luaO_rawequalObj (const TValue *t1, const TValue *t2) {
     case LUA_TNIL:
       return 1;
     case LUA_TNUMBER:
+#ifdef LUA_NUMBER_DUAL
+      if (ttisint(t1) && ttisint(t2))
+        return ivalue(t1) == ivalue(t2);
+#endif
       return luai_numeq(nvalue(t1), nvalue(t2));
     case LUA_TBOOLEAN:
       return bvalue(t1) == bvalue(t2);  /* boolean true must be 1 !! */
@@ -89,6 +93,24 @@ int luaO_rawequalObj (const TValue *t1, const TValue *t2) {
 }
 
 
+#ifdef LUA_NUMBER_DUAL
+/*
+** sets 'o' to the number 'n', using the integer subtype if 'n' has an
+** integer value that fits in an int (-0 stays a float, its sign matters)
+*/
+void luaO_setnum (TValue *o, lua_Number n) {
+  int i;
+  lua_number2int(i, n);
+  if (luai_numeq(cast_num(i), n) && (i != 0 || luai_numlt(0, 1/n))) {
+    setivalue(o, i);
+  }
+  else {
+    setnvalue(o, n);
+  }
+}
+#endif
+
+
 int luaO_str2d (const char *s, lua_Number *result) {
   char *endptr;
   *result = lua_str2number(s, &endptr);
@@ -133,7 +155,7 @@ const char *luaO_pushvfstring (lua_State *L, const char *fmt, va_list argp) {
         break;
       }
       case 'd': {
-        setnvalue(L->top, cast_num(va_arg(argp, int)));
+        setivalue(L->top, va_arg(argp, int));
         incr_top(L);
         break;
       }
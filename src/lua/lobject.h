@@ -32,6 +32,13 @@
 #define LUA_TUPVAL	(LAST_TAG+2)
 #define LUA_TDEADKEY	(LAST_TAG+3)
 
+/*
+** Subtype bit of numbers with an integer value (LUA_NUMBER_DUAL only).
+** It is kept in the 'tt' field of a TValue, but it is never returned by
+** ttype(), so these numbers are still LUA_TNUMBER for the rest of Lua.
+*/
+#define LUA_TINTBIT	64
+
 
 /*
 ** Union of all collectable objects
@@ -81,6 +88,7 @@ typedef union {
   void *p;
   lua_Number n;
   int b;
+  int i;
 } Value;
 #endif // #if defined( LUA_PACK_VALUE ) && defined( ELUA_ENDIAN_BIG )
 
@@ -160,7 +168,11 @@ typedef TValuefields TValue;
 
 /* Macros to access values */
 #ifndef LUA_PACK_VALUE
+#ifdef LUA_NUMBER_DUAL
+#define ttype(o)	((o)->tt & ~LUA_TINTBIT)
+#else
 #define ttype(o)	((o)->tt)
+#endif
 #else // #ifndef LUA_PACK_VALUE
 #define ttype(o)	((o)->_t.sig == LUA_NOTNUMBER_SIG ? (o)->_t.tt : LUA_TNUMBER)
 #define ttype_sig(o)	((o)->_ts.tt_sig)
@@ -169,7 +181,14 @@ typedef TValuefields TValue;
 #define pvalue(o)	check_exp(ttislightuserdata(o), (o)->value.p)
 #define rvalue(o)	check_exp(ttisrotable(o), (o)->value.p)
 #define fvalue(o) check_exp(ttislightfunction(o), (o)->value.p)
+#ifdef LUA_NUMBER_DUAL
+#define ttisint(o)	((o)->tt == (LUA_TNUMBER | LUA_TINTBIT))
+#define ivalue(o)	check_exp(ttisint(o), (o)->value.i)
+#define nvalue(o)	check_exp(ttisnumber(o), \
+  ttisint(o) ? cast_num((o)->value.i) : (o)->value.n)
+#else
 #define nvalue(o)	check_exp(ttisnumber(o), (o)->value.n)
+#endif
 #define rawtsvalue(o)	check_exp(ttisstring(o), &(o)->value.gc->ts)
 #define tsvalue(o)	(&rawtsvalue(o)->tsv)
 #define rawuvalue(o)	check_exp(ttisuserdata(o), &(o)->value.gc->u)
@@ -207,6 +226,13 @@ typedef TValuefields TValue;
 #define setnvalue(obj,x) \
   { lua_Number i_x = (x); TValue *i_o=(obj); i_o->value.n=i_x; i_o->tt=LUA_TNUMBER; }
 
+#ifdef LUA_NUMBER_DUAL
+#define setivalue(obj,x) \
+  { int i_x = (x); TValue *i_o=(obj); i_o->value.i=i_x; i_o->tt=LUA_TNUMBER|LUA_TINTBIT; }
+#else
+#define setivalue(obj,x)	setnvalue(obj, cast_num(x))
+#endif
+
 #define setpvalue(obj,x) \
   { void *i_x = (x); TValue *i_o=(obj); i_o->value.p=i_x; i_o->tt=LUA_TLIGHTUSERDATA; }
   
@@ -268,6 +294,8 @@ typedef TValuefields TValue;
 #define setnvalue(obj,x) \
   { TValue *i_o=(obj); i_o->value.n=(x); }
 
+#define setivalue(obj,x)	setnvalue(obj, cast_num(x))
+
 #define setpvalue(obj,x) \
   { TValue *i_o=(obj); i_o->value.p=(x); i_o->_ts.tt_sig=add_sig(LUA_TLIGHTUSERDATA);}
 
@@ -345,7 +373,7 @@ typedef TValuefields TValue;
 #define setsvalue2n	setsvalue
 
 #ifndef LUA_PACK_VALUE
-#define setttype(obj, tt) (ttype(obj) = (tt))
+#define setttype(obj, _tt) ((obj)->tt = (_tt))
 #else // #ifndef LUA_PACK_VALUE
 /* considering it used only in lgc to set LUA_TDEADKEY */
 /* we could define it this way */
@@ -546,6 +574,11 @@ LUAI_FUNC int luaO_log2 (unsigned int x);
 LUAI_FUNC int luaO_int2fb (unsigned int x);
 LUAI_FUNC int luaO_fb2int (int x);
 LUAI_FUNC int luaO_rawequalObj (const TValue *t1, const TValue *t2);
+#ifdef LUA_NUMBER_DUAL
+LUAI_FUNC void luaO_setnum (TValue *o, lua_Number n);
+#else
+#define luaO_setnum(o,n)	setnvalue(o,n)
+#endif
 LUAI_FUNC int luaO_str2d (const char *s, lua_Number *result);
 LUAI_FUNC const char *luaO_pushvfstring (lua_State *L, const char *fmt,
                                                        va_list argp);
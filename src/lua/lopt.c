@@ -0,0 +1,444 @@
+/*
+** $Id: lopt.c $
+** Bytecode optimizer for the cross compiler
+** See Copyright Notice in lua.h
+*/
+
+#include <string.h>
+
+#define luac_c
+#define LUA_CORE
+
+#include "lua.h"
+
+#include "ldebug.h"
+#include "lmem.h"
+#include "lobject.h"
+#include "lopcodes.h"
+#include "lstate.h"
+#include "lundump.h"
+
+/*
+** The optimizer works on the prototypes produced by the parser, one function
+** at a time, and only makes changes that keep the code verifiable by
+** luaG_checkcode (which is also run by luaU_undump on the target):
+** - jumps to jumps are threaded to their final destination
+** - unreachable code and jumps to the next instruction are removed
+** - redundant MOVEs are removed
+** - unused and duplicated constants are removed
+** - maxstacksize is recomputed from the registers that are actually used
+*/
+
+/* effect of an instruction on a register (see regeffect) */
+#define R_NONE		0	/* register is not used */
+#define R_WRITE		1	/* register is written without being read */
+#define R_READ		2	/* register may be read */
+#define R_STOP		3	/* unknown or control flow, stop scanning */
+
+
+/* 'i' is a test that skips the next instruction (which the VM reads) */
+static int isskip (Instruction i) {
+  OpCode op = GET_OPCODE(i);
+  return testTMode(op) || (op == OP_LOADBOOL && GETARG_C(i) != 0);
+}
+
+
+/* mark the words that are arguments of the previous instruction */
+static void markdata (const Proto *f, lu_byte *data) {
+  int pc;
+  memset(data, 0, f->sizecode);
+  for (pc = 0; pc < f->sizecode; pc++) {
+    Instruction i = f->code[pc];
+    if (GET_OPCODE(i) == OP_SETLIST && GETARG_C(i) == 0)
+      data[++pc] = 1;
+    else if (GET_OPCODE(i) == OP_CLOSURE) {
+      int nup = f->p[GETARG_Bx(i)]->nups;
+      while (nup-- > 0) data[++pc] = 1;
+    }
+  }
+}
+
+
+static int isjump (OpCode op) {
+  return op == OP_JMP || op == OP_FORLOOP || op == OP_FORPREP;
+}
+
+
+static int jumptarget (const Proto *f, int pc) {
+  return pc + 1 + GETARG_sBx(f->code[pc]);
+}
+
+
+/* retarget jumps to unconditional jumps */
+static void threadjumps (const Proto *f, const lu_byte *data) {
+  int pc;
+  for (pc = 0; pc < f->sizecode; pc++) {
+    int t, hops;
+    if (data[pc] || GET_OPCODE(f->code[pc]) != OP_JMP) continue;
+    t = jumptarget(f, pc);
+    for (hops = 0; hops < f->sizecode; hops++) {
+      int nt;
+      if (data[t] || GET_OPCODE(f->code[t]) != OP_JMP) break;
+      nt = jumptarget(f, t);
+      if (nt == t) break;  /* endless loop */
+      t = nt;
+    }
+    SETARG_sBx(f->code[pc], t - (pc + 1));
+  }
+}
+
+
+/* mark the instructions that can be executed */
+static void markreachable (lua_State *L, const Proto *f, const lu_byte *data,
+                           lu_byte *reach) {
+  int *stack = luaM_newvector(L, f->sizecode, int);
+  int top = 0;
+  memset(reach, 0, f->sizecode);
+  reach[0] = 1;
+  stack[top++] = 0;
+  while (top > 0) {
+    int pc = stack[--top];
+    Instruction i = f->code[pc];
+    int next[2];
+    int nnext = 0, j;
+    switch (GET_OPCODE(i)) {
+      case OP_JMP:
+      case OP_FORPREP:
+        next[nnext++] = jumptarget(f, pc);
+        break;
+      case OP_FORLOOP:
+        next[nnext++] = jumptarget(f, pc);
+        next[nnext++] = pc + 1;
+        break;
+      case OP_RETURN:
+        break;
+      case OP_LOADBOOL:
+        next[nnext++] = pc + (GETARG_C(i) ? 2 : 1);
+        break;
+      case OP_SETLIST:
+        if (GETARG_C(i) == 0) reach[++pc] = 1;
+        next[nnext++] = pc + 1;
+        break;
+      case OP_CLOSURE: {
+        int nup = f->p[GETARG_Bx(i)]->nups;
+        while (nup-- > 0) reach[++pc] = 1;
+        next[nnext++] = pc + 1;
+        break;
+      }
+      default:
+        next[nnext++] = pc + 1;
+        if (testTMode(GET_OPCODE(i)))
+          next[nnext++] = pc + 2;
+        break;
+    }
+    for (j = 0; j < nnext; j++) {
+      int t = next[j];
+      if (t < f->sizecode && !data[t] && !reach[t]) {
+        reach[t] = 1;
+        stack[top++] = t;
+      }
+    }
+  }
+  luaM_freearray(L, stack, f->sizecode, int);
+}
+
+
+/* number of active local variables at 'pc' */
+static int nactvar (const Proto *f, int pc) {
+  int i, n = 0;
+  for (i = 0; i < f->sizelocvars; i++)
+    if (f->locvars[i].startpc <= pc && pc < f->locvars[i].endpc) n++;
+  return n;
+}
+
+
+static int rkreads (int x, int r) {
+  return !ISK(x) && x == r;
+}
+
+
+/* effect of a simple (straight line) instruction on register 'r' */
+static int regeffect (Instruction i, int r) {
+  int a = GETARG_A(i);
+  int b = GETARG_B(i);
+  int c = GETARG_C(i);
+  switch (GET_OPCODE(i)) {
+    case OP_LOADK: case OP_GETUPVAL: case OP_GETGLOBAL: case OP_NEWTABLE:
+      return a == r ? R_WRITE : R_NONE;
+    case OP_LOADBOOL:
+      if (c != 0) return R_STOP;
+      return a == r ? R_WRITE : R_NONE;
+    case OP_LOADNIL:
+      return a <= r && r <= b ? R_WRITE : R_NONE;
+    case OP_MOVE: case OP_UNM: case OP_NOT: case OP_LEN:
+      if (b == r) return R_READ;
+      return a == r ? R_WRITE : R_NONE;
+    case OP_GETTABLE:
+      if (b == r || rkreads(c, r)) return R_READ;
+      return a == r ? R_WRITE : R_NONE;
+    case OP_SELF:
+      if (b == r || rkreads(c, r)) return R_READ;
+      return a == r || a + 1 == r ? R_WRITE : R_NONE;
+    case OP_ADD: case OP_SUB: case OP_MUL:
+    case OP_DIV: case OP_MOD: case OP_POW:
+      if (rkreads(b, r) || rkreads(c, r)) return R_READ;
+      return a == r ? R_WRITE : R_NONE;
+    case OP_CONCAT:
+      if (b <= r && r <= c) return R_READ;
+      return a == r ? R_WRITE : R_NONE;
+    case OP_SETGLOBAL: case OP_SETUPVAL:
+      return a == r ? R_READ : R_NONE;
+    case OP_SETTABLE:
+      if (a == r || rkreads(b, r) || rkreads(c, r)) return R_READ;
+      return R_NONE;
+    default:
+      return R_STOP;
+  }
+}
+
+
+/* the value written to temporary register 'r' at 'pc' is never read */
+static int deadstore (const Proto *f, int pc, int r) {
+  for (pc++; pc < f->sizecode; pc++) {
+    int e = regeffect(f->code[pc], r);
+    if (e == R_WRITE) return 1;
+    if (e != R_NONE) return 0;
+  }
+  return 0;
+}
+
+
+/* 'pc' is a MOVE that can be removed */
+static int redundantmove (const Proto *f, int pc, const lu_byte *data,
+                          const lu_byte *target, const lu_byte *remove) {
+  Instruction i = f->code[pc];
+  int a = GETARG_A(i);
+  int b = GETARG_B(i);
+  if (a == b) return 1;
+  if (pc > 0 && !data[pc-1] && !remove[pc-1] && !target[pc]) {
+    Instruction p = f->code[pc-1];
+    if (GET_OPCODE(p) == OP_MOVE && GETARG_A(p) == b && GETARG_B(p) == a)
+      return 1;  /* MOVE b a; MOVE a b */
+  }
+  /* without debug information the temporaries can't be told from locals */
+  if (f->sizelineinfo == 0 || a < nactvar(f, pc)) return 0;
+  return deadstore(f, pc, a);
+}
+
+
+/* remove the instructions marked in 'remove', fixing jumps and debug info */
+static void compactcode (lua_State *L, Proto *f, const lu_byte *data,
+                         const lu_byte *remove) {
+  int n = f->sizecode;
+  int *newpc = luaM_newvector(L, n + 1, int);
+  int pc, k = 0;
+  for (pc = 0; pc < n; pc++) {
+    newpc[pc] = k;
+    if (!remove[pc]) k++;
+  }
+  newpc[n] = k;
+  for (pc = 0; pc < n; pc++) {
+    Instruction i = f->code[pc];
+    if (remove[pc]) continue;
+    if (!data[pc] && isjump(GET_OPCODE(i))) {
+      int t = newpc[jumptarget(f, pc)];
+      SETARG_sBx(i, t - (newpc[pc] + 1));
+    }
+    f->code[newpc[pc]] = i;
+    if (f->sizelineinfo > 0)
+      f->lineinfo[newpc[pc]] = f->lineinfo[pc];
+  }
+  for (pc = 0; pc < f->sizelocvars; pc++) {
+    f->locvars[pc].startpc = newpc[f->locvars[pc].startpc];
+    f->locvars[pc].endpc = newpc[f->locvars[pc].endpc];
+  }
+  luaM_freearray(L, newpc, n + 1, int);
+  luaM_reallocvector(L, f->code, n, k, Instruction);
+  f->sizecode = k;
+  if (f->sizelineinfo > 0) {
+    luaM_reallocvector(L, f->lineinfo, n, k, int);
+    f->sizelineinfo = k;
+  }
+}
+
+
+/* one round of code removal; returns the number of removed instructions */
+static int removecode (lua_State *L, Proto *f) {
+  int n = f->sizecode;
+  lu_byte *data = luaM_newvector(L, 4 * n, lu_byte);
+  lu_byte *reach = data + n;
+  lu_byte *target = reach + n;
+  lu_byte *remove = target + n;
+  int pc, removed = 0;
+  markdata(f, data);
+  threadjumps(f, data);
+  markreachable(L, f, data, reach);
+  memset(target, 0, n);
+  for (pc = 0; pc < n; pc++)
+    if (!data[pc] && isjump(GET_OPCODE(f->code[pc])))
+      target[jumptarget(f, pc)] = 1;
+  for (pc = 0; pc < n; pc++) {
+    Instruction i = f->code[pc];
+    int r = 0;
+    if (pc == n - 1)
+      r = 0;  /* the final return is always kept */
+    else if (data[pc] || (pc > 0 && !data[pc-1] && isskip(f->code[pc-1])))
+      r = 0;  /* the VM reads or skips this instruction, keep it */
+    else if (!reach[pc])
+      r = 1;
+    else if (GET_OPCODE(i) == OP_JMP)
+      r = jumptarget(f, pc) == pc + 1;
+    else if (GET_OPCODE(i) == OP_MOVE)
+      r = redundantmove(f, pc, data, target, remove);
+    remove[pc] = cast_byte(r);
+    removed += r;
+  }
+  if (removed > 0)
+    compactcode(L, f, data, remove);
+  luaM_freearray(L, data, 4 * n, lu_byte);
+  return removed;
+}
+
+
+static int sameconstant (const TValue *a, const TValue *b) {
+  if (a->tt != b->tt) return 0;
+  if (ttisnumber(a)) {  /* bitwise, so that 0 and -0 are kept apart */
+    lua_Number x = nvalue(a), y = nvalue(b);
+    return luai_numeq(x, x) && memcmp(&x, &y, sizeof(lua_Number)) == 0;
+  }
+  return luaO_rawequalObj(a, b);
+}
+
+
+/* remove the unused constants and merge the duplicated ones */
+static void compactconstants (lua_State *L, Proto *f) {
+  int n = f->sizek;
+  int *newk = luaM_newvector(L, n, int);
+  int pc, k, nk = 0;
+  for (k = 0; k < n; k++) newk[k] = -1;
+  for (pc = 0; pc < f->sizecode; pc++) {
+    Instruction i = f->code[pc];
+    OpCode op = GET_OPCODE(i);
+    if (getOpMode(op) == iABx && getBMode(op) == OpArgK)
+      newk[GETARG_Bx(i)] = 0;
+    else if (getOpMode(op) == iABC) {
+      if (getBMode(op) == OpArgK && ISK(GETARG_B(i)))
+        newk[INDEXK(GETARG_B(i))] = 0;
+      if (getCMode(op) == OpArgK && ISK(GETARG_C(i)))
+        newk[INDEXK(GETARG_C(i))] = 0;
+    }
+    if (op == OP_SETLIST && GETARG_C(i) == 0) pc++;
+    else if (op == OP_CLOSURE) pc += f->p[GETARG_Bx(i)]->nups;
+  }
+  for (k = 0; k < n; k++) {
+    int j;
+    if (newk[k] < 0) continue;
+    for (j = 0; j < nk && !sameconstant(&f->k[j], &f->k[k]); j++) ;
+    newk[k] = j;
+    if (j == nk) {
+      setobj(L, &f->k[nk], &f->k[k]);
+      nk++;
+    }
+  }
+  for (pc = 0; pc < f->sizecode; pc++) {
+    Instruction *i = &f->code[pc];
+    OpCode op = GET_OPCODE(*i);
+    if (getOpMode(op) == iABx && getBMode(op) == OpArgK)
+      SETARG_Bx(*i, newk[GETARG_Bx(*i)]);
+    else if (getOpMode(op) == iABC) {
+      if (getBMode(op) == OpArgK && ISK(GETARG_B(*i)))
+        SETARG_B(*i, RKASK(newk[INDEXK(GETARG_B(*i))]));
+      if (getCMode(op) == OpArgK && ISK(GETARG_C(*i)))
+        SETARG_C(*i, RKASK(newk[INDEXK(GETARG_C(*i))]));
+    }
+    if (op == OP_SETLIST && GETARG_C(*i) == 0) pc++;
+    else if (op == OP_CLOSURE) pc += f->p[GETARG_Bx(*i)]->nups;
+  }
+  luaM_freearray(L, newk, n, int);
+  luaM_reallocvector(L, f->k, n, nk, TValue);
+  f->sizek = nk;
+}
+
+
+#define needreg(r)	{ if ((r) + 1 > size) size = (r) + 1; }
+
+/* number of registers used by the function */
+static int stacksize (const Proto *f, int strip) {
+  int size = 2;  /* the parser never uses less */
+  int pc;
+  if (f->numparams + (f->is_vararg & VARARG_HASARG) > size)
+    size = f->numparams + (f->is_vararg & VARARG_HASARG);
+  if (!strip) {  /* local variables can be accessed with the debug library */
+    for (pc = 0; pc < f->sizelocvars; pc++) {
+      int j, reg = 0;
+      for (j = 0; j < pc; j++)
+        if (f->locvars[j].endpc > f->locvars[pc].startpc) reg++;
+      needreg(reg);
+    }
+  }
+  for (pc = 0; pc < f->sizecode; pc++) {
+    Instruction i = f->code[pc];
+    OpCode op = GET_OPCODE(i);
+    int a = GETARG_A(i);
+    int b = GETARG_B(i);
+    int c = GETARG_C(i);
+    needreg(a);
+    if (getOpMode(op) == iABC) {
+      if (getBMode(op) == OpArgR || (getBMode(op) == OpArgK && !ISK(b)))
+        needreg(b);
+      if (getCMode(op) == OpArgR || (getCMode(op) == OpArgK && !ISK(c)))
+        needreg(c);
+    }
+    switch (op) {
+      case OP_SELF: needreg(a+1); break;
+      case OP_FORLOOP:
+      case OP_FORPREP: needreg(a+3); break;
+      case OP_TFORLOOP: needreg(a+2+c); needreg(a+5); break;
+      case OP_CALL:
+      case OP_TAILCALL:
+        if (b != 0) needreg(a+b-1);
+        if (c > 1) needreg(a+c-2);
+        break;
+      case OP_RETURN:
+      case OP_VARARG:
+        if (b > 1) needreg(a+b-2);
+        break;
+      case OP_SETLIST:
+        if (b > 0) needreg(a+b);
+        if (c == 0) pc++;
+        break;
+      case OP_CLOSURE: {
+        int nup = f->p[GETARG_Bx(i)]->nups;
+        for (; nup > 0; nup--) {
+          Instruction u = f->code[++pc];
+          if (GET_OPCODE(u) == OP_MOVE) needreg(GETARG_B(u));
+        }
+        break;
+      }
+      default: break;
+    }
+  }
+  return size;
+}
+
+
+static void optimize (lua_State *L, Proto *f, int strip) {
+  int i;
+  for (i = 0; i < f->sizep; i++)
+    optimize(L, f->p[i], strip);
+  while (removecode(L, f) > 0) ;
+  compactconstants(L, f);
+  f->maxstacksize = cast_byte(stacksize(f, strip));
+  if (!luaG_checkcode(f))
+    luaG_runerror(L, "optimized code of %s is not valid", getstr(f->source));
+}
+
+
+/*
+** optimize a function and all its nested functions. 'strip' tells that the
+** debug information won't be saved, so the local variables that are not
+** used by the code don't need registers
+*/
+void luaU_optimize (lua_State *L, Proto *f, int strip) {
+  optimize(L, f, strip);
+}
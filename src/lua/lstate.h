@@ -114,6 +114,8 @@ struct lua_State {
   CallInfo *base_ci;  /* array of CallInfo's */
   int stacksize;
   int size_ci;  /* size of array `base_ci' */
+  int stacklimit;  /* maximum stack size (0 means no limit) */
+  int stackpeak;  /* largest stack size reached */
   unsigned short nCcalls;  /* number of nested C calls */
   unsigned short baseCcalls;  /* nested C calls when resuming coroutine */
   lu_byte hookmask;
@@ -122,7 +122,8 @@ TString *luaS_newlstr (lua_State *L, const char *str, size_t l) {
 
 
 LUAI_FUNC TString *luaS_newrolstr (lua_State *L, const char *str, size_t l) {
-  if(l+1 > sizeof(char**) && l == strlen(str))
+  // The data can contain embedded zeros, but it must be zero terminated
+  if(l+1 > sizeof(char**) && str[l] == '\0')
     return luaS_newlstr_helper(L, str, l, LUAS_READONLY_STRING);
   else // no point in creating a RO string, as it would actually be larger
     return luaS_newlstr_helper(L, str, l, LUAS_REGULAR_STRING);
@@ -51,6 +51,7 @@
   
 #define hashstr(t,str)  hashpow2(t, (str)->tsv.hash)
 #define hashboolean(t,p)        hashpow2(t, p)
+#define hashint(t,i)            hashpow2(t, cast(unsigned int, (i)))
 
 
 /*
@@ -99,8 +100,20 @@ static Node *hashnum (const Table *t, lua_Number n) {
 */
 static Node *mainposition (const Table *t, const TValue *key) {
   switch (ttype(key)) {
-    case LUA_TNUMBER:
+    case LUA_TNUMBER: {
+#ifdef LUA_NUMBER_DUAL
+      /* integral keys are hashed as ints, whatever their subtype */
+      int k;
+      lua_Number n;
+      if (ttisint(key))
+        return hashint(t, ivalue(key));
+      n = nvalue(key);
+      lua_number2int(k, n);
+      if (luai_numeq(cast_num(k), n))
+        return hashint(t, k);
+#endif
       return hashnum(t, nvalue(key));
+    }
     case LUA_TSTRING:
       return hashstr(t, rawtsvalue(key));
     case LUA_TBOOLEAN:
@@ -120,6 +133,10 @@ static Node *mainposition (const Table *t, const TValue *key) {
 ** the array part of the table, -1 otherwise.
 */
 static int arrayindex (const TValue *key) {
+#ifdef LUA_NUMBER_DUAL
+  if (ttisint(key))
+    return ivalue(key);
+#endif
   if (ttisnumber(key)) {
     lua_Number n = nvalue(key);
     int k;
@@ -165,7 +182,7 @@ int luaH_next (lua_State *L, Table *t, StkId key) {
   int i = findindex(L, t, key);  /* find original element */
   for (i++; i < t->sizearray; i++) {  /* try first array part */
     if (!ttisnil(&t->array[i])) {  /* a non-nil value? */
-      setnvalue(key, cast_num(i+1));
+      setivalue(key, i+1);
       setobj2s(L, key+1, &t->array[i]);
       return 1;
     }
@@ -508,6 +525,28 @@ Table *luaH_new (lua_State *L, int narray, int nhash) {
 }
 
 
+/*
+** Remove all the elements of a table but keep its array and hash parts,
+** so it can be filled again without being reallocated
+*/
+void luaH_clear (Table *t) {
+  int i;
+  for (i = 0; i < t->sizearray; i++)
+    setnilvalue(&t->array[i]);
+  if (t->node != dummynode) {
+    int size = sizenode(t);
+    for (i = 0; i < size; i++) {
+      Node *n = gnode(t, i);
+      gnext(n) = NULL;
+      setnilvalue(gkey(n));
+      setnilvalue(gval(n));
+    }
+    t->lastfree = gnode(t, size);  /* reset lastfree to end of table. */
+  }
+  t->flags = cast_byte(~0);  /* no tag methods in an empty table */
+}
+
+
 void luaH_free (lua_State *L, Table *t) {
   if (t->node != dummynode)
     luaM_freearray(L, t->node, sizenode(t), Node);
@@ -565,6 +604,15 @@ const TValue *luaH_getnum (Table *t, int key) {
   if (cast(unsigned int, key-1) < cast(unsigned int, t->sizearray))
     return &t->array[key-1];
   else {
+#ifdef LUA_NUMBER_DUAL
+    /* integral keys are always stored with the integer subtype */
+    Node *n = hashint(t, key);
+    do {  /* check whether `key' is somewhere in the chain */
+      if (ttisint(gkey(n)) && ivalue(gkey(n)) == key)
+        return gval(n);  /* that's it */
+      else n = gnext(n);
+    } while (n);
+#else
     lua_Number nk = cast_num(key);
     Node *n = hashnum(t, nk);
     do {  /* check whether `key' is somewhere in the chain */
@@ -572,6 +620,7 @@ const TValue *luaH_getnum (Table *t, int key) {
         return gval(n);  /* that's it */
       else n = gnext(n);
     } while (n);
+#endif
     return luaO_nilobject;
   }
 }
@@ -617,7 +666,12 @@ const TValue *luaH_get (Table *t, const TValue *key) {
     case LUA_TSTRING: return luaH_getstr(t, rawtsvalue(key));
     case LUA_TNUMBER: {
       int k;
-      lua_Number n = nvalue(key);
+      lua_Number n;
+#ifdef LUA_NUMBER_DUAL
+      if (ttisint(key))
+        return luaH_getnum(t, ivalue(key));
+#endif
+      n = nvalue(key);
       lua_number2int(k, n);
       if (luai_numeq(cast_num(k), nvalue(key))) /* index is int? */
         return luaH_getnum(t, k);  /* use specialized version */
@@ -642,7 +696,12 @@ const TValue *luaH_get_ro (void *t, const TValue *key) {
     case LUA_TSTRING: return luaH_getstr_ro(t, rawtsvalue(key));
     case LUA_TNUMBER: {
       int k;
-      lua_Number n = nvalue(key);
+      lua_Number n;
+#ifdef LUA_NUMBER_DUAL
+      if (ttisint(key))
+        return luaH_getnum_ro(t, ivalue(key));
+#endif
+      n = nvalue(key);
       lua_number2int(k, n);
       if (luai_numeq(cast_num(k), nvalue(key))) /* index is int? */
         return luaH_getnum_ro(t, k);  /* use specialized version */
@@ -664,6 +723,19 @@ TValue *luaH_set (lua_State *L, Table *t, const TValue *key) {
     if (ttisnil(key)) luaG_runerror(L, "table index is nil");
     else if (ttisnumber(key) && luai_numisnan(nvalue(key)))
       luaG_runerror(L, "table index is NaN");
+#ifdef LUA_NUMBER_DUAL
+    else if (ttisnumber(key) && !ttisint(key)) {
+      /* store integral keys with the integer subtype (see luaH_getnum) */
+      TValue k;
+      int ik;
+      lua_Number n = nvalue(key);
+      lua_number2int(ik, n);
+      if (luai_numeq(cast_num(ik), n)) {
+        setivalue(&k, ik);
+        return newkey(L, t, &k);
+      }
+    }
+#endif
     return newkey(L, t, key);
   }
 }
@@ -675,7 +747,7 @@ TValue *luaH_setnum (lua_State *L, Table *t, int key) {
     return cast(TValue *, p);
   else {
     TValue k;
-    setnvalue(&k, cast_num(key));
+    setivalue(&k, key);
     return newkey(L, t, &k);
   }
 }
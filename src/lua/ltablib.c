@@ -142,6 +142,25 @@ static void addfield (lua_State *L, luaL_Buffer *b, int i) {
 }
 
 
+/* create a table with preallocated array and hash parts */
+static int tnew (lua_State *L) {
+  int narr = luaL_optint(L, 1, 0);
+  int nhash = luaL_optint(L, 2, 0);
+  luaL_argcheck(L, narr >= 0, 1, "invalid array size");
+  luaL_argcheck(L, nhash >= 0, 2, "invalid hash size");
+  lua_createtable(L, narr, nhash);
+  return 1;
+}
+
+
+/* remove all the elements of a table, keeping its memory for reuse */
+static int tclear (lua_State *L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_cleartable(L, 1);
+  return 0;
+}
+
+
 static int tconcat (lua_State *L) {
   luaL_Buffer b;
   size_t lsep;
@@ -270,12 +289,14 @@ static int sort (lua_State *L) {
 #define MIN_OPT_LEVEL 1
 #include "lrodefs.h"
 const LUA_REG_TYPE tab_funcs[] = {
+  {LSTRKEY("clear"), LFUNCVAL(tclear)},
   {LSTRKEY("concat"), LFUNCVAL(tconcat)},
   {LSTRKEY("foreach"), LFUNCVAL(foreach)},
   {LSTRKEY("foreachi"), LFUNCVAL(foreachi)},
   {LSTRKEY("getn"), LFUNCVAL(getn)},
   {LSTRKEY("maxn"), LFUNCVAL(maxn)},
   {LSTRKEY("insert"), LFUNCVAL(tinsert)},
+  {LSTRKEY("new"), LFUNCVAL(tnew)},
   {LSTRKEY("remove"), LFUNCVAL(tremove)},
   {LSTRKEY("setn"), LFUNCVAL(setn)},
   {LSTRKEY("sort"), LFUNCVAL(sort)},
@@ -196,6 +196,7 @@ LUA_API void  (lua_rawset) (lua_State *L, int idx);
 LUA_API void  (lua_rawseti) (lua_State *L, int idx, int n);
 LUA_API int   (lua_setmetatable) (lua_State *L, int objindex);
 LUA_API int   (lua_setfenv) (lua_State *L, int idx);
+LUA_API void  (lua_cleartable) (lua_State *L, int idx);
 
 
 /*
@@ -235,6 +236,21 @@ LUA_API int  (lua_status) (lua_State *L);
 LUA_API int (lua_gc) (lua_State *L, int what, int data);
 
 
+/*
+** thread stack control function and options
+*/
+
+#define LUA_STKSETLIMIT		0
+#define LUA_STKGETLIMIT		1
+#define LUA_STKSIZE		2
+#define LUA_STKPEAK		3
+#define LUA_STKCISIZE		4
+#define LUA_STKSHRINK		5
+#define LUA_STKBYTES		6
+
+LUA_API int (lua_stackctl) (lua_State *L, int what, int data);
+
+
 /*
 ** miscellaneous functions
 */
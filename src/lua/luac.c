@@ -29,6 +29,7 @@
 static int listing=0;			/* list bytecodes? */
 static int dumping=1;			/* dump bytecodes? */
 static int stripping=0;			/* strip debug information? */
+static int optimizing=0;		/* optimize bytecodes? */
 static char Output[]={ OUTPUT };	/* default output file name */
 static const char* output=Output;	/* actual output file name */
 static const char* progname=PROGNAME;	/* actual program name */
@@ -58,6 +59,7 @@ static void usage(const char* message)
  "  -        process stdin\n"
  "  -l       list\n"
  "  -o name  output to file " LUA_QL("name") " (default is \"%s\")\n"
+ "  -O       optimize bytecodes\n"
  "  -p       parse only\n"
  "  -s       strip debug information\n"
  "  -v       show version information\n"
@@ -96,6 +98,8 @@ static int doargs(int argc, char* argv[])
    if (output==NULL || *output==0) usage(LUA_QL("-o") " needs argument");
    if (IS("-")) output=NULL;
   }
+  else if (IS("-O"))			/* optimize */
+   optimizing=1;
   else if (IS("-p"))			/* parse only */
    dumping=0;
   else if (IS("-s"))			/* strip debug information */
@@ -198,6 +202,7 @@ static int pmain(lua_State* L)
  {
   const char* filename=IS("-") ? NULL : argv[i];
   if (luaL_loadfile(L,filename)!=0) fatal(lua_tostring(L,-1));
+  if (optimizing) luaU_optimize(L,toproto(L,-1),stripping);
  }
  f=combine(L,argc);
  if (listing) luaU_print(f,listing>1);
@@ -575,6 +575,20 @@
 #define LUA_NUMBER	double
 #endif
 
+/* Define LUA_NUMBER_DUAL (on top of the floating point build) to give
+   every number an internal integer or floating point subtype. Numbers
+   whose value fits in an int are kept as ints and the VM uses integer
+   operations on them (arithmetic, comparisons, numeric 'for' loops and
+   table indexing), switching to doubles only when the result isn't an
+   integer or doesn't fit in an int. The subtype is never visible to Lua
+   code (1 == 1.0 and t[1] is the same as t[1.0]) and the bytecode format
+   is the same as the one of the floating point build. This avoids the
+   (soft) floating point code for integer-only code on CPUs without a
+   FPU. */
+#if defined LUA_NUMBER_DUAL && (defined LUA_NUMBER_INTEGRAL || defined LUA_PACK_VALUE)
+#error "LUA_NUMBER_DUAL can't be used with LUA_NUMBER_INTEGRAL or LUA_PACK_VALUE"
+#endif
+
 /*
 @@ LUAI_UACNUMBER is the result of an 'usual argument conversion'
 @* over a number.
@@ -39,6 +39,9 @@ LUAI_FUNC int luaU_dump (lua_State* L, const Proto* f, lua_Writer w, void* data,
 #ifdef luac_c
 /* print one chunk; from print.c */
 LUAI_FUNC void luaU_print (const Proto* f, int full);
+
+/* optimize one chunk; from lopt.c */
+LUAI_FUNC void luaU_optimize (lua_State* L, Proto* f, int strip);
 #endif
 
 /* for header of binary files -- this is Lua 5.1 */
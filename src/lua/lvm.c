@@ -5,6 +5,7 @@
 */
 
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,6 +28,11 @@
 #include "lvm.h"
 #include "lrotable.h"
 
+#ifndef LUA_CROSS_COMPILER
+#include "platform_conf.h"
+#endif
+#include "elua_profile.h"
+
 
 /* limit for table tag-method chains (to avoid loops) */
 #define MAXTAGLOOP	100
@@ -69,8 +75,17 @@ int luaV_tostring (lua_State *L, StkId obj) {
   else {
     char s[LUAI_MAXNUMBER2STR];
     ptrdiff_t objr = savestack(L, obj);
+#ifdef LUA_NUMBER_DUAL
+    if (ttisint(obj))
+      sprintf(s, "%d", ivalue(obj));  /* same output as LUA_NUMBER_FMT */
+    else {
+      lua_Number n = nvalue(obj);
+      lua_number2str(s, n);
+    }
+#else
     lua_Number n = nvalue(obj);
     lua_number2str(s, n);
+#endif
     setsvalue2s(L, restorestack(L, objr), luaS_new(L, s));
     return 1;
   }
@@ -259,6 +274,10 @@ int luaV_lessthan (lua_State *L, const TValue *l, const TValue *r) {
   int res;
   if (ttype(l) != ttype(r))
     return luaG_ordererror(L, l, r);
+#ifdef LUA_NUMBER_DUAL
+  else if (ttisint(l) && ttisint(r))
+    return ivalue(l) < ivalue(r);
+#endif
   else if (ttisnumber(l))
     return luai_numlt(nvalue(l), nvalue(r));
   else if (ttisstring(l))
@@ -273,6 +292,10 @@ static int lessequal (lua_State *L, const TValue *l, const TValue *r) {
   int res;
   if (ttype(l) != ttype(r))
     return luaG_ordererror(L, l, r);
+#ifdef LUA_NUMBER_DUAL
+  else if (ttisint(l) && ttisint(r))
+    return ivalue(l) <= ivalue(r);
+#endif
   else if (ttisnumber(l))
     return luai_numle(nvalue(l), nvalue(r));
   else if (ttisstring(l))
@@ -290,7 +313,12 @@ int luaV_equalval (lua_State *L, const TValue *t1, const TValue *t2) {
   lua_assert(ttype(t1) == ttype(t2));
   switch (ttype(t1)) {
     case LUA_TNIL: return 1;
-    case LUA_TNUMBER: return luai_numeq(nvalue(t1), nvalue(t2));
+    case LUA_TNUMBER:
+#ifdef LUA_NUMBER_DUAL
+      if (ttisint(t1) && ttisint(t2))
+        return ivalue(t1) == ivalue(t2);
+#endif
+      return luai_numeq(nvalue(t1), nvalue(t2));
     case LUA_TBOOLEAN: return bvalue(t1) == bvalue(t2);  /* true must be 1 !! */
     case LUA_TLIGHTUSERDATA: 
     case LUA_TROTABLE:
@@ -362,6 +390,50 @@ void luaV_concat (lua_State *L, int total, int last) {
 }
 
 
+#ifdef LUA_NUMBER_DUAL
+/*
+** integer version of the arithmetic operators; returns 0 if the result
+** can't be represented exactly as an int (overflow, non-integral result,
+** -0), in which case the operation must be done on lua_Numbers
+*/
+static int arith_int (TMS op, int a, int b, int *res) {
+  switch (op) {
+    case TM_ADD:
+      *res = (int)((unsigned int)a + (unsigned int)b);
+      return ((a ^ *res) & (b ^ *res)) >= 0;
+    case TM_SUB:
+      *res = (int)((unsigned int)a - (unsigned int)b);
+      return ((a ^ b) & (a ^ *res)) >= 0;
+    case TM_MUL: {
+      long long p = (long long)a * b;
+      *res = (int)p;
+      return p == *res && (*res != 0 || (a >= 0 && b >= 0));
+    }
+    case TM_DIV:
+      if (b == 0 || b == -1 || a % b != 0 || (a == 0 && b < 0))
+        return 0;
+      *res = a / b;
+      return 1;
+    case TM_MOD:
+      if (b == 0)
+        return 0;
+      if (b == -1)
+        *res = 0;
+      else if ((*res = a % b) != 0 && (*res ^ b) < 0)
+        *res += b;  /* result has the sign of the divisor */
+      return 1;
+    case TM_UNM:
+      if (a == 0 || a == INT_MIN)
+        return 0;
+      *res = -a;
+      return 1;
+    default:
+      return 0;
+  }
+}
+#endif
+
+
 static void Arith (lua_State *L, StkId ra, const TValue *rb,
                    const TValue *rc, TMS op) {
   TValue tempb, tempc;
@@ -414,6 +486,23 @@ static void Arith (lua_State *L, StkId ra, const TValue *rb,
 #define Protect(x)	{ L->savedpc = pc; {x;}; base = L->base; }
 
 
+#ifdef LUA_NUMBER_DUAL
+#define arith_op(op,tm) { \
+        TValue *rb = RKB(i); \
+        TValue *rc = RKC(i); \
+        int ir; \
+        if (ttisint(rb) && ttisint(rc) && \
+            arith_int(tm, ivalue(rb), ivalue(rc), &ir)) { \
+          setivalue(ra, ir); \
+        } \
+        else if (ttisnumber(rb) && ttisnumber(rc)) { \
+          lua_Number nb = nvalue(rb), nc = nvalue(rc); \
+          setnvalue(ra, op(nb, nc)); \
+        } \
+        else \
+          Protect(Arith(L, ra, rb, rc, tm)); \
+      }
+#else
 #define arith_op(op,tm) { \
         TValue *rb = RKB(i); \
         TValue *rc = RKC(i); \
@@ -424,6 +513,7 @@ static void Arith (lua_State *L, StkId ra, const TValue *rb,
         else \
           Protect(Arith(L, ra, rb, rc, tm)); \
       }
+#endif
 
 
 
@@ -442,6 +532,7 @@ void luaV_execute (lua_State *L, int nexeccalls) {
   for (;;) {
     const Instruction i = *pc++;
     StkId ra;
+    elua_prof_opcode(GET_OPCODE(i));
     if ((L->hookmask & (LUA_MASKLINE | LUA_MASKCOUNT)) &&
         (--L->hookcount == 0 || L->hookmask & LUA_MASKLINE)) {
       traceexec(L, pc);
@@ -552,6 +643,13 @@ void luaV_execute (lua_State *L, int nexeccalls) {
       }
       case OP_UNM: {
         TValue *rb = RB(i);
+#ifdef LUA_NUMBER_DUAL
+        int ir;
+        if (ttisint(rb) && arith_int(TM_UNM, ivalue(rb), 0, &ir)) {
+          setivalue(ra, ir);
+        }
+        else
+#endif
         if (ttisnumber(rb)) {
           lua_Number nb = nvalue(rb);
           setnvalue(ra, luai_numunm(nb));
@@ -571,11 +669,11 @@ void luaV_execute (lua_State *L, int nexeccalls) {
         switch (ttype(rb)) {
           case LUA_TTABLE: 
           case LUA_TROTABLE: {
-            setnvalue(ra, ttistable(rb) ? cast_num(luaH_getn(hvalue(rb))) : cast_num(luaH_getn_ro(rvalue(rb))));
+            setivalue(ra, ttistable(rb) ? luaH_getn(hvalue(rb)) : luaH_getn_ro(rvalue(rb)));
             break;
           }
           case LUA_TSTRING: {
-            setnvalue(ra, cast_num(tsvalue(rb)->len));
+            setivalue(ra, tsvalue(rb)->len);
             break;
           }
           default: {  /* try metamethod */
@@ -682,6 +780,7 @@ void luaV_execute (lua_State *L, int nexeccalls) {
             ci->savedpc = L->savedpc;
             ci->tailcalls++;  /* one more call lost */
             L->ci--;  /* remove new frame */
+            elua_prof_tail(L);
             goto reentry;
           }
           case PCRC: {  /* it was a C function (`precall' called it) */
@@ -709,6 +808,21 @@ void luaV_execute (lua_State *L, int nexeccalls) {
         }
       }
       case OP_FORLOOP: {
+#ifdef LUA_NUMBER_DUAL
+        if (ttisint(ra)) {  /* integer loop (see OP_FORPREP) */
+          int step = ivalue(ra+2);
+          int limit = ivalue(ra+1);
+          int idx;
+          /* an overflow means that the index went past the limit */
+          if (arith_int(TM_ADD, ivalue(ra), step, &idx) &&
+              (step > 0 ? idx <= limit : limit <= idx)) {
+            dojump(L, pc, GETARG_sBx(i));  /* jump back */
+            setivalue(ra, idx);  /* update internal index... */
+            setivalue(ra+3, idx);  /* ...and external index */
+          }
+          continue;
+        }
+#endif
         lua_Number step = nvalue(ra+2);
         lua_Number idx = luai_numadd(nvalue(ra), step); /* increment index */
         lua_Number limit = nvalue(ra+1);
@@ -731,6 +845,21 @@ void luaV_execute (lua_State *L, int nexeccalls) {
           luaG_runerror(L, LUA_QL("for") " limit must be a number");
         else if (!tonumber(pstep, ra+2))
           luaG_runerror(L, LUA_QL("for") " step must be a number");
+#ifdef LUA_NUMBER_DUAL
+        {
+          /* use an integer loop only if all the control values are ints,
+             otherwise OP_FORLOOP expects all of them to be floats */
+          int ir;
+          if (ttisint(ra) && ttisint(ra+1) && ttisint(ra+2) &&
+              arith_int(TM_SUB, ivalue(ra), ivalue(ra+2), &ir)) {
+            setivalue(ra, ir);
+            dojump(L, pc, GETARG_sBx(i));
+            continue;
+          }
+          setnvalue(ra+1, nvalue(ra+1));
+          setnvalue(ra+2, nvalue(ra+2));
+        }
+#endif
         setnvalue(ra, luai_numsub(nvalue(ra), nvalue(pstep)));
         dojump(L, pc, GETARG_sBx(i));
         continue;
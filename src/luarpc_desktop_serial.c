@@ -119,6 +119,32 @@ void transport_read_buffer (Transport *tpt, u8 *buffer, int length)
   }
 }
 
+int transport_read_some( Transport *tpt, u8 *buffer, int maxlen )
+{
+  int n;
+  struct exception e;
+  TRANSPORT_VERIFY_OPEN;
+
+  n = ser_read( tpt->fd, buffer, maxlen );
+
+  // error handling
+  if( n == 0 )
+  {
+    e.errnum = ERR_NODATA;
+    e.type = nonfatal;
+    Throw( e );
+  }
+
+  if( n < 0 )
+  {
+    e.errnum = transport_errno;
+    e.type = fatal;
+    Throw( e );
+  }
+
+  return n;
+}
+
 void transport_write_buffer( Transport *tpt, const u8 *buffer, int length )
 {
   int n;
@@ -136,6 +136,38 @@ void transport_read_buffer( Transport *tpt, u8 *buffer, int length )
   }
 }
 
+// Wait for the first char, then take whatever else is already received
+int transport_read_some( Transport *tpt, u8 *buffer, int maxlen )
+{
+  int n = 0;
+  int c;
+  struct exception e;
+  timer_data_type uart_timeout = PLATFORM_TIMER_INF_TIMEOUT;
+
+  TRANSPORT_VERIFY_OPEN;
+  while( n < maxlen )
+  {
+    if ( adispatch_buff < 0 )
+      c = platform_uart_recv( tpt->fd, tpt->tmr_id, uart_timeout );
+    else
+    {
+      c = adispatch_buff;
+      adispatch_buff = -1;
+    }
+    if( c < 0 )
+      break;
+    buffer[ n ++ ] = ( u8 )c;
+    uart_timeout = 0;
+  }
+  if( n == 0 )
+  {
+    e.errnum = ERR_NODATA;
+    e.type = nonfatal;
+    Throw( e );
+  }
+  return n;
+}
+
 void transport_write_buffer( Transport *tpt, const u8 *buffer, int length )
 {
   int i;
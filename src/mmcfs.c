@@ -14,7 +14,17 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 
-#define MMCFS_MAX_FDS   4
+// Maximum number of open files
+#ifndef MMCFS_MAX_FDS
+#define MMCFS_MAX_FDS         4
+#endif
+
+// Initial size (in DWORDs) of the cluster link map of a file opened for
+// reading. The map uses 2 DWORDs for each fragment of the file, plus 2.
+#ifndef MMCFS_LINKMAP_SIZE
+#define MMCFS_LINKMAP_SIZE    16
+#endif
+
 static FIL mmcfs_fd_table[ MMCFS_MAX_FDS ];
 static int mmcfs_num_fd;
 
@@ -37,6 +47,184 @@ typedef struct
   struct dm_dirent *pdm;
 } MMCFS_DIRENT_DATA;
 
+// ****************************************************************************
+// Sector cache
+// FatFs reads and writes single sectors (FAT, directories and partial data
+// sectors) through a fully associative write-back cache with LRU replacement.
+// Multi-sector transfers go directly to the card. Dirty sectors are written
+// to the card when they are evicted and when FatFs syncs the file system
+// (f_sync and f_close).
+
+#if defined( MMCFS_CACHE_SECTORS ) && MMCFS_CACHE_SECTORS > 0
+
+typedef struct
+{
+  DWORD sector;
+  u32 stamp;                    // time of the last access, 0 if the entry is free
+  BYTE drv;
+  BYTE dirty;
+  BYTE data[ _MAX_SS ];
+} MMCFS_CACHE_ENTRY;
+
+static MMCFS_CACHE_ENTRY mmcfs_cache[ MMCFS_CACHE_SECTORS ];
+static u32 mmcfs_cache_clock;
+
+static void mmcfs_cache_touch( MMCFS_CACHE_ENTRY *pe )
+{
+  if( ++ mmcfs_cache_clock == 0 )
+    mmcfs_cache_clock = 1;
+  pe->stamp = mmcfs_cache_clock;
+}
+
+static MMCFS_CACHE_ENTRY* mmcfs_cache_find( BYTE drv, DWORD sector )
+{
+  unsigned i;
+
+  for( i = 0; i < MMCFS_CACHE_SECTORS; i ++ )
+    if( mmcfs_cache[ i ].stamp && mmcfs_cache[ i ].drv == drv && mmcfs_cache[ i ].sector == sector )
+      return mmcfs_cache + i;
+  return NULL;
+}
+
+static DRESULT mmcfs_cache_writeback( MMCFS_CACHE_ENTRY *pe )
+{
+  DRESULT res;
+
+  if( !pe->dirty )
+    return RES_OK;
+  if( ( res = disk_write( pe->drv, pe->data, pe->sector, 1 ) ) == RES_OK )
+    pe->dirty = 0;
+  return res;
+}
+
+// Return a cache entry for the given sector, evicting the least recently
+// used entry if needed (NULL if the evicted sector could not be written)
+static MMCFS_CACHE_ENTRY* mmcfs_cache_alloc( BYTE drv, DWORD sector )
+{
+  MMCFS_CACHE_ENTRY *pe = mmcfs_cache;
+  unsigned i;
+
+  for( i = 1; i < MMCFS_CACHE_SECTORS && pe->stamp; i ++ )
+    if( mmcfs_cache[ i ].stamp < pe->stamp )
+      pe = mmcfs_cache + i;
+  if( pe->stamp && mmcfs_cache_writeback( pe ) != RES_OK )
+    return NULL;
+  pe->drv = drv;
+  pe->sector = sector;
+  pe->dirty = 0;
+  pe->stamp = 0;
+  return pe;
+}
+
+DSTATUS mmcfs_cache_initialize( BYTE drv )
+{
+  unsigned i;
+
+  // The card might have been changed, drop its cached sectors
+  for( i = 0; i < MMCFS_CACHE_SECTORS; i ++ )
+    if( mmcfs_cache[ i ].drv == drv )
+      mmcfs_cache[ i ].stamp = 0;
+  return disk_initialize( drv );
+}
+
+DRESULT mmcfs_cache_read( BYTE drv, BYTE *buff, DWORD sector, BYTE count )
+{
+  MMCFS_CACHE_ENTRY *pe;
+  DRESULT res;
+  unsigned i;
+
+  if( count > 1 )
+  {
+    if( ( res = disk_read( drv, buff, sector, count ) ) != RES_OK )
+      return res;
+    // The cached sectors might be more recent than the ones on the card
+    for( i = 0, pe = mmcfs_cache; i < MMCFS_CACHE_SECTORS; i ++, pe ++ )
+      if( pe->stamp && pe->dirty && pe->drv == drv && pe->sector - sector < count )
+        memcpy( buff + ( pe->sector - sector ) * _MAX_SS, pe->data, _MAX_SS );
+    return RES_OK;
+  }
+  if( ( pe = mmcfs_cache_find( drv, sector ) ) == NULL )
+  {
+    if( ( pe = mmcfs_cache_alloc( drv, sector ) ) == NULL )
+      return RES_ERROR;
+    if( ( res = disk_read( drv, pe->data, sector, 1 ) ) != RES_OK )
+      return res;
+  }
+  mmcfs_cache_touch( pe );
+  memcpy( buff, pe->data, _MAX_SS );
+  return RES_OK;
+}
+
+DRESULT mmcfs_cache_write( BYTE drv, const BYTE *buff, DWORD sector, BYTE count )
+{
+  MMCFS_CACHE_ENTRY *pe;
+  DRESULT res;
+  unsigned i;
+
+  if( count > 1 )
+  {
+    if( ( res = disk_write( drv, buff, sector, count ) ) != RES_OK )
+      return res;
+    // Update the cached copies of the written sectors
+    for( i = 0, pe = mmcfs_cache; i < MMCFS_CACHE_SECTORS; i ++, pe ++ )
+      if( pe->stamp && pe->drv == drv && pe->sector - sector < count )
+      {
+        memcpy( pe->data, buff + ( pe->sector - sector ) * _MAX_SS, _MAX_SS );
+        pe->dirty = 0;
+      }
+    return RES_OK;
+  }
+  if( ( pe = mmcfs_cache_find( drv, sector ) ) == NULL )
+    if( ( pe = mmcfs_cache_alloc( drv, sector ) ) == NULL )
+      return RES_ERROR;
+  memcpy( pe->data, buff, _MAX_SS );
+  pe->dirty = 1;
+  mmcfs_cache_touch( pe );
+  return RES_OK;
+}
+
+DRESULT mmcfs_cache_ioctl( BYTE drv, BYTE ctrl, void *buff )
+{
+  unsigned i;
+
+  if( ctrl == CTRL_SYNC )
+    for( i = 0; i < MMCFS_CACHE_SECTORS; i ++ )
+      if( mmcfs_cache[ i ].stamp && mmcfs_cache[ i ].drv == drv && mmcfs_cache_writeback( mmcfs_cache + i ) != RES_OK )
+        return RES_ERROR;
+  return disk_ioctl( drv, ctrl, buff );
+}
+
+#endif // #if defined( MMCFS_CACHE_SECTORS ) && MMCFS_CACHE_SECTORS > 0
+
+// ****************************************************************************
+// File system functions
+
+#if _USE_FASTSEEK
+// Create the cluster link map of a file, so that seeking in the file doesn't
+// follow its cluster chain. If the map can't be created the file is used
+// without it.
+static void mmcfs_create_linkmap( FIL *fp )
+{
+  DWORD size = MMCFS_LINKMAP_SIZE;
+  FRESULT res;
+
+  while( 1 )
+  {
+    if( ( fp->cltbl = ( DWORD* )malloc( size * sizeof( DWORD ) ) ) == NULL )
+      return;
+    fp->cltbl[ 0 ] = size;
+    if( ( res = f_lseek( fp, CREATE_LINKMAP ) ) == FR_OK )
+      return;
+    // Try again (only once) with a table large enough for all the fragments
+    size = res == FR_NOT_ENOUGH_CORE && size == MMCFS_LINKMAP_SIZE ? fp->cltbl[ 0 ] : 0;
+    free( fp->cltbl );
+    fp->cltbl = NULL;
+    if( size == 0 )
+      return;
+  }
+}
+#endif // #if _USE_FASTSEEK
+
 static int mmcfs_find_empty_fd( void )
 {
   int i;
@@ -125,6 +313,11 @@ static int mmcfs_open_r( struct _reent *r, const char *path, int flags, int mode
 
   if (mode & O_APPEND)
     mmc_fileObject.fptr = mmc_fileObject.fsize;
+#if _USE_FASTSEEK
+  // Files opened for reading that span more than one cluster use fast seek
+  if( !( mmc_mode & FA_WRITE ) && mmc_fileObject.fsize > ( DWORD )mmc_fileObject.fs->csize * _MAX_SS )
+    mmcfs_create_linkmap( &mmc_fileObject );
+#endif
   fd = mmcfs_find_empty_fd();
   memcpy(mmcfs_fd_table + fd, &mmc_fileObject, sizeof(FIL));
   mmcfs_num_fd ++;
@@ -137,6 +330,9 @@ static int mmcfs_close_r( struct _reent *r, int fd, void *pdata )
   FIL* pFile = mmcfs_fd_table + fd;
 
   f_close( pFile );
+#if _USE_FASTSEEK
+  free( pFile->cltbl );
+#endif
   memset(pFile, 0, sizeof(FIL));
   mmcfs_num_fd --;
   return 0;
@@ -320,7 +516,8 @@ static const DM_DEVICE mmcfs_device =
   mmcfs_mkdir_r,        // mkdir
   mmcfs_unlink_r,       // unlink
   mmcfs_unlink_r,       // rmdir
-  mmcfs_rename_r        // rename
+  mmcfs_rename_r,       // rename
+  NULL                  // map
 };
 
 int mmcfs_init()
@@ -9,6 +9,7 @@
 #include "lrotable.h"
 #include "platform_conf.h"
 #include "elua_adc.h"
+#include "buf.h"
 
 #ifdef BUILD_ADC
 
@@ -226,6 +227,51 @@ static int adc_insertsamples( lua_State* L )
   
   return 0;
 }
+
+// Lua: count = readsamples( id, array, [idx], [count] )
+// Copies samples straight into a preallocated bitarray (8, 16 or 32 bit
+// elements), so no Lua objects are created in the acquisition loop
+static int adc_readsamples( lua_State* L )
+{
+  unsigned id;
+  u32 capacity, startidx, count;
+  u8 elsize, *pdata;
+
+  id = luaL_checkinteger( L, 1 );
+  MOD_CHECK_ID( adc, id );
+  pdata = bitarray_getdata( L, 2, &capacity, &elsize );
+  if( elsize < 8 )
+    return luaL_error( L, "array element size must be 8, 16 or 32 bits" );
+  startidx = ( u32 )luaL_optinteger( L, 3, 1 );
+  if( startidx == 0 || startidx > capacity )
+    return luaL_error( L, "invalid index" );
+  count = ( u32 )luaL_optinteger( L, 4, capacity - startidx + 1 );
+  if( count > capacity - startidx + 1 )
+    return luaL_error( L, "not enough room in array" );
+  if( count > 0xFFFF )
+    count = 0xFFFF;
+  
+  adc_wait_samples( id, count );
+  pdata += ( startidx - 1 ) * ( elsize >> 3 );
+  lua_pushinteger( L, adc_read_samples( id, pdata, ( u16 )count, elsize >> 3 ) );
+  return 1;
+}
+
+// Lua: setnotify( id, count )
+// Fire INT_ADC_READY when at least 'count' samples are buffered (0 disables)
+static int adc_setnotify( lua_State* L )
+{
+  unsigned id;
+  u32 count;
+
+  id = luaL_checkinteger( L, 1 );
+  MOD_CHECK_ID( adc, id );
+  count = ( u32 )luaL_checkinteger( L, 2 );
+  if( count > buf_get_size( BUF_ID_ADC, id ) )
+    return luaL_error( L, "count larger than the sample buffer" );
+  adc_set_notify( id, ( u16 )count );
+  return 0;
+}
 #endif
 
 // Module function map
@@ -243,6 +289,8 @@ const LUA_REG_TYPE adc_map[] =
 #if defined( BUF_ENABLE_ADC )
   { LSTRKEY( "getsamples" ), LFUNCVAL( adc_getsamples ) },
   { LSTRKEY( "insertsamples" ), LFUNCVAL( adc_insertsamples ) },
+  { LSTRKEY( "readsamples" ), LFUNCVAL( adc_readsamples ) },
+  { LSTRKEY( "setnotify" ), LFUNCVAL( adc_setnotify ) },
 #endif
   { LNILKEY, LNILVAL }
 };
@@ -6,6 +6,7 @@
 #define __AUXMODS_H__
 
 #include "lua.h"
+#include "type.h"
 
 #define AUXLIB_PIO      "pio"
 LUALIB_API int ( luaopen_pio )( lua_State *L );
@@ -51,6 +52,7 @@ LUALIB_API int ( luaopen_rpc )( lua_State *L );
 
 #define AUXLIB_BITARRAY "bitarray"
 LUALIB_API int ( luaopen_bitarray )( lua_State *L );
+u8* bitarray_getdata( lua_State *L, int idx, u32 *pcapacity, u8 *pelsize );
 
 #define AUXLIB_ELUA "elua"
 LUALIB_API int ( luaopen_elua )( lua_State *L );
@@ -61,6 +63,9 @@ LUALIB_API int ( luaopen_i2c )( lua_State *L );
 #define AUXLIB_FS "fs"
 LUALIB_API int ( luaopen_fs )( lua_State *L );
 
+#define AUXLIB_SCHED "sched"
+LUALIB_API int ( luaopen_sched )( lua_State *L );
+
 // Helper macros
 #define MOD_CHECK_ID( mod, id )\
   if( !platform_ ## mod ## _exists( id ) )\
@@ -301,6 +301,20 @@ static int bitarray_totable( lua_State *L )
   return 1;  
 }
 
+// C API: return the raw storage of the bitarray at stack index 'idx' (raises
+// a Lua error if it's not a bitarray). This lets other modules fill arrays
+// in place without going through the VM for each element.
+u8* bitarray_getdata( lua_State *L, int idx, u32 *pcapacity, u8 *pelsize )
+{
+  bitarray_t *pa = ( bitarray_t* )luaL_checkudata( L, idx, META_NAME );
+
+  if( pcapacity )
+    *pcapacity = pa->capacity;
+  if( pelsize )
+    *pelsize = pa->elsize;
+  return pa->values;
+}
+
 // Module function map
 #define MIN_OPT_LEVEL 2
 #include "lrodefs.h"
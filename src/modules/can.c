@@ -6,6 +6,12 @@
 #include "platform.h"
 #include "auxmods.h"
 #include "lrotable.h"
+#include "common.h"
+#include <string.h>
+
+// Size of a frame record in the string returned by can.recvmany:
+// CAN ID (u32, little endian), ID type (u8), length (u8), data (8 bytes, zero padded)
+#define CAN_RECORD_SIZE       ( 4 + 1 + 1 + PLATFORM_CAN_MAXLEN )
 
 // Lua: result = setup( id, clock )
 static int can_setup( lua_State* L )
@@ -67,6 +73,89 @@ static int can_recv( lua_State* L )
     return 0;
 }
 
+// Lua: data, count, dropped = recvmany( id, max )
+static int can_recvmany( lua_State* L )
+{
+  unsigned id, max, count;
+  u32 canid;
+  u8 idtype, len;
+  char rec[ CAN_RECORD_SIZE ];
+  luaL_Buffer b;
+
+  id = luaL_checkinteger( L, 1 );
+  MOD_CHECK_ID( can, id );
+  max = luaL_checkinteger( L, 2 );
+  luaL_buffinit( L, &b );
+  for( count = 0; count < max; count ++ )
+  {
+    memset( rec + 6, 0, PLATFORM_CAN_MAXLEN );
+    if( platform_can_recv( id, &canid, &idtype, &len, ( u8* )rec + 6 ) != PLATFORM_OK )
+      break;
+    rec[ 0 ] = canid & 0xFF;
+    rec[ 1 ] = ( canid >> 8 ) & 0xFF;
+    rec[ 2 ] = ( canid >> 16 ) & 0xFF;
+    rec[ 3 ] = canid >> 24;
+    rec[ 4 ] = idtype;
+    rec[ 5 ] = len;
+    luaL_addlstring( &b, rec, CAN_RECORD_SIZE );
+  }
+  luaL_pushresult( &b );
+  lua_pushinteger( L, count );
+  lua_pushinteger( L, platform_can_get_dropped( id ) );
+  return 3;
+}
+
+// Lua: set_buffer( id, size )
+static int can_set_buffer( lua_State* L )
+{
+  unsigned id = luaL_checkinteger( L, 1 );
+  u32 size = ( u32 )luaL_checkinteger( L, 2 );
+
+  MOD_CHECK_ID( can, id );
+  if( size == 1 || ( size & ( size - 1 ) ) )
+    return luaL_error( L, "the buffer size must be a power of 2 greater than 1, or 0" );
+  if( platform_can_set_buffer( id, intlog2( size ) ) == PLATFORM_ERR )
+    return luaL_error( L, "unable to set CAN buffer" );
+  return 0;
+}
+
+// Lua: set_filters( id, [ { canid, mask, [canidtype] }, ... ] )
+static int can_set_filters( lua_State* L )
+{
+  unsigned id = luaL_checkinteger( L, 1 );
+  unsigned i, n = 0;
+  u32 canid[ PLATFORM_CAN_MAX_FILTERS ], mask[ PLATFORM_CAN_MAX_FILTERS ];
+  int idtype[ PLATFORM_CAN_MAX_FILTERS ];
+
+  MOD_CHECK_ID( can, id );
+  // Read all the filters first, so the old ones are kept if there's an error
+  if( !lua_isnoneornil( L, 2 ) )
+  {
+    luaL_checktype( L, 2, LUA_TTABLE );
+    n = lua_objlen( L, 2 );
+    if( n > PLATFORM_CAN_MAX_FILTERS )
+      return luaL_error( L, "too many filters (maximum is %d)", PLATFORM_CAN_MAX_FILTERS );
+    for( i = 0; i < n; i ++ )
+    {
+      lua_rawgeti( L, 2, i + 1 );
+      if( !lua_istable( L, -1 ) )
+        return luaL_error( L, "invalid filter at index %d", i + 1 );
+      lua_rawgeti( L, -1, 1 );
+      lua_rawgeti( L, -2, 2 );
+      lua_rawgeti( L, -3, 3 );
+      if( !lua_isnumber( L, -3 ) || !lua_isnumber( L, -2 ) )
+        return luaL_error( L, "invalid filter at index %d", i + 1 );
+      canid[ i ] = ( u32 )lua_tonumber( L, -3 );
+      mask[ i ] = ( u32 )lua_tonumber( L, -2 );
+      idtype[ i ] = lua_isnil( L, -1 ) ? PLATFORM_CAN_ID_ANY : lua_tointeger( L, -1 );
+      lua_pop( L, 4 );
+    }
+  }
+  platform_can_clear_filters( id );
+  for( i = 0; i < n; i ++ )
+    platform_can_add_filter( id, canid[ i ], mask[ i ], idtype[ i ] );
+  return 0;
+}
 
 // Module function map
 #define MIN_OPT_LEVEL 2
@@ -76,6 +165,9 @@ const LUA_REG_TYPE can_map[] =
   { LSTRKEY( "setup" ),  LFUNCVAL( can_setup ) },
   { LSTRKEY( "send" ),  LFUNCVAL( can_send ) },  
   { LSTRKEY( "recv" ),  LFUNCVAL( can_recv ) },
+  { LSTRKEY( "recvmany" ),  LFUNCVAL( can_recvmany ) },
+  { LSTRKEY( "set_buffer" ),  LFUNCVAL( can_set_buffer ) },
+  { LSTRKEY( "set_filters" ),  LFUNCVAL( can_set_filters ) },
 #if LUA_OPTIMIZE_MEMORY > 0
   { LSTRKEY( "ID_STD" ), LNUMVAL( ELUA_CAN_ID_STD ) },
   { LSTRKEY( "ID_EXT" ), LNUMVAL( ELUA_CAN_ID_EXT ) },
@@ -10,6 +10,10 @@
 #include "platform_conf.h"
 #include "linenoise.h"
 #include "shell.h"
+#include "elua_snapshot.h"
+#include "elua_profile.h"
+#include "genstd.h"
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -85,6 +89,74 @@ static int elua_save_history( lua_State *L )
 #endif // #ifdef BUILD_LINENOISE
 }
 
+// Lua: elua.snapshot( filename )
+static int elua_snapshot( lua_State *L )
+{
+  elua_snapshot_save( L, luaL_checkstring( L, 1 ) );
+  return 0;
+}
+
+// Lua: res = elua.restore( filename )
+static int elua_restore( lua_State *L )
+{
+  lua_pushboolean( L, elua_snapshot_restore( L, luaL_checkstring( L, 1 ) ) );
+  return 1;
+}
+
+#ifdef BUILD_LUA_PROFILER
+// Lua: [report] = elua.profile( "start" | "stop" | "flat" | "folded" | "opcodes" )
+static int elua_profile( lua_State *L )
+{
+  static const char *const cmds[] = { "start", "stop", "flat", "folded", "opcodes", NULL };
+
+  switch( luaL_checkoption( L, 1, NULL, cmds ) )
+  {
+    case 0:
+      elua_prof_start();
+      return 0;
+
+    case 1:
+      elua_prof_stop();
+      return 0;
+
+    case 2:
+      elua_prof_push_flat( L );
+      break;
+
+    case 3:
+      elua_prof_push_folded( L );
+      break;
+
+    case 4:
+      elua_prof_push_opcodes( L );
+      break;
+  }
+  return 1;
+}
+#endif // #ifdef BUILD_LUA_PROFILER
+
+#ifdef BUILD_CON_GENERIC
+// Lua: prevmode = elua.con_buffer( [ "no" | "line" | "full" ] )
+static int elua_con_buffer( lua_State *L )
+{
+  static const char *const modes[] = { "no", "line", "full", NULL };
+  int prev = std_get_buffer_mode();
+
+  if( lua_gettop( L ) >= 1 && std_set_buffer_mode( luaL_checkoption( L, 1, NULL, modes ) ) != PLATFORM_OK )
+    return luaL_error( L, "console output buffer not available" );
+  lua_pushstring( L, modes[ prev ] );
+  return 1;
+}
+
+// Lua: elua.con_flush()
+static int elua_con_flush( lua_State *L )
+{
+  fflush( stdout );
+  std_flush();
+  return 0;
+}
+#endif // #ifdef BUILD_CON_GENERIC
+
 #ifdef BUILD_SHELL
 // Lua: elua.shell( <shell_command> )
 static int elua_shell( lua_State *L )
@@ -112,6 +184,15 @@ const LUA_REG_TYPE elua_map[] =
   { LSTRKEY( "heapstats" ), LFUNCVAL( elua_heapstats ) },
   { LSTRKEY( "version" ), LFUNCVAL( elua_version ) },
   { LSTRKEY( "save_history" ), LFUNCVAL( elua_save_history ) },
+  { LSTRKEY( "snapshot" ), LFUNCVAL( elua_snapshot ) },
+  { LSTRKEY( "restore" ), LFUNCVAL( elua_restore ) },
+#ifdef BUILD_LUA_PROFILER
+  { LSTRKEY( "profile" ), LFUNCVAL( elua_profile ) },
+#endif
+#ifdef BUILD_CON_GENERIC
+  { LSTRKEY( "con_buffer" ), LFUNCVAL( elua_con_buffer ) },
+  { LSTRKEY( "con_flush" ), LFUNCVAL( elua_con_flush ) },
+#endif
 #ifdef BUILD_SHELL
   { LSTRKEY( "shell" ), LFUNCVAL( elua_shell ) },
 #endif
@@ -136,6 +136,137 @@ static int i2c_read( lua_State *L )
   return 1;
 }
 
+// Helper: get the data to write in a transfer (a string, a table of numbers,
+// a number or nil). Pushes a new string on the stack if the data is not a
+// string, returns NULL if the data is invalid.
+static const char* i2ch_get_wdata( lua_State *L, int idx, size_t *plen )
+{
+  luaL_Buffer b;
+  size_t i, len;
+  int numdata;
+
+  *plen = 0;
+  switch( lua_type( L, idx ) )
+  {
+    case LUA_TNONE:
+    case LUA_TNIL:
+      return "";
+
+    case LUA_TSTRING:
+      return lua_tolstring( L, idx, plen );
+
+    case LUA_TNUMBER:
+    case LUA_TTABLE:
+      luaL_buffinit( L, &b );
+      len = lua_istable( L, idx ) ? lua_objlen( L, idx ) : 1;
+      for( i = 0; i < len; i ++ )
+      {
+        if( lua_istable( L, idx ) )
+        {
+          lua_rawgeti( L, idx, i + 1 );
+          numdata = lua_isnumber( L, -1 ) ? ( int )lua_tointeger( L, -1 ) : -1;
+          lua_pop( L, 1 );
+        }
+        else
+          numdata = ( int )lua_tointeger( L, idx );
+        if( numdata < 0 || numdata > 255 )
+          return NULL;
+        luaL_addchar( &b, ( char )numdata );
+      }
+      luaL_pushresult( &b );
+      return lua_tolstring( L, -1, plen );
+  }
+  return NULL;
+}
+
+// Helper: run a single transfer and push the data read (a string) or nil
+// if the transfer failed
+static void i2ch_transfer( lua_State *L, unsigned id, int address, const char *wdata, size_t wlen, u32 rlen )
+{
+  luaL_Buffer b;
+  u8 *rdata;
+
+  if( rlen <= LUAL_BUFFERSIZE )
+  {
+    luaL_buffinit( L, &b );
+    rdata = ( u8* )luaL_prepbuffer( &b );
+  }
+  else
+    rdata = ( u8* )lua_newuserdata( L, rlen );
+  if( platform_i2c_transfer( id, ( u16 )address, ( const u8* )wdata, wlen, rdata, rlen ) == 0 )
+  {
+    if( rlen <= LUAL_BUFFERSIZE )
+      luaL_pushresult( &b );
+    lua_pop( L, 1 );
+    lua_pushnil( L );
+  }
+  else if( rlen <= LUAL_BUFFERSIZE )
+  {
+    luaL_addsize( &b, rlen );
+    luaL_pushresult( &b );
+  }
+  else
+  {
+    lua_pushlstring( L, ( const char* )rdata, rlen );
+    lua_remove( L, -2 );
+  }
+}
+
+// Lua: data = i2c.transfer( id, address, [wdata], [rsize] )
+// Lua: results = i2c.transfer( id, { { address, [wdata], [rsize] }, ... } )
+// wdata can be either a string, a table or an 8-bit number
+static int i2c_transfer( lua_State *L )
+{
+  unsigned id = luaL_checkinteger( L, 1 );
+  int address, rsize, top;
+  const char *wdata;
+  size_t wlen, i, n;
+
+  MOD_CHECK_ID( i2c, id );
+  if( lua_istable( L, 2 ) ) // list of transfers
+  {
+    n = lua_objlen( L, 2 );
+    lua_createtable( L, n, 0 );
+    for( i = 1; i <= n; i ++ )
+    {
+      lua_rawgeti( L, 2, i );
+      if( !lua_istable( L, -1 ) )
+        return luaL_error( L, "transfer %d: invalid transfer", ( int )i );
+      top = lua_gettop( L );
+      lua_rawgeti( L, top, 1 );
+      lua_rawgeti( L, top, 2 );
+      lua_rawgeti( L, top, 3 );
+      address = lua_isnumber( L, top + 1 ) ? ( int )lua_tointeger( L, top + 1 ) : -1;
+      rsize = ( int )lua_tointeger( L, top + 3 );
+      if( address < 0 || address > 127 )
+        return luaL_error( L, "transfer %d: slave address must be from 0 to 127", ( int )i );
+      if( rsize < 0 )
+        return luaL_error( L, "transfer %d: invalid read size", ( int )i );
+      if( ( wdata = i2ch_get_wdata( L, top + 2, &wlen ) ) == NULL )
+        return luaL_error( L, "transfer %d: invalid data", ( int )i );
+      i2ch_transfer( L, id, address, wdata, wlen, ( u32 )rsize );
+      if( lua_isnil( L, -1 ) )
+      {
+        lua_pop( L, 1 );
+        lua_pushboolean( L, 0 );
+      }
+      lua_rawseti( L, top - 1, i );
+      lua_settop( L, top - 1 );
+    }
+    return 1;
+  }
+  address = luaL_checkinteger( L, 2 );
+  rsize = luaL_optinteger( L, 4, 0 );
+  if( address < 0 || address > 127 )
+    return luaL_error( L, "slave address must be from 0 to 127" );
+  if( rsize < 0 )
+    return luaL_error( L, "invalid read size" );
+  if( ( wdata = i2ch_get_wdata( L, 3, &wlen ) ) == NULL )
+    return luaL_error( L, "numeric data must be from 0 to 255" );
+  i2ch_transfer( L, id, address, wdata, wlen, ( u32 )rsize );
+  return 1;
+}
+
 // Module function map
 #define MIN_OPT_LEVEL   2
 #include "lrodefs.h"
@@ -147,6 +278,7 @@ const LUA_REG_TYPE i2c_map[] =
   { LSTRKEY( "address" ), LFUNCVAL( i2c_address ) },
   { LSTRKEY( "write" ), LFUNCVAL( i2c_write ) },
   { LSTRKEY( "read" ), LFUNCVAL( i2c_read ) },
+  { LSTRKEY( "transfer" ), LFUNCVAL( i2c_transfer ) },
 #if LUA_OPTIMIZE_MEMORY > 0
   { LSTRKEY( "FAST" ), LNUMVAL( PLATFORM_I2C_SPEED_FAST ) },
   { LSTRKEY( "SLOW" ), LNUMVAL( PLATFORM_I2C_SPEED_SLOW ) },
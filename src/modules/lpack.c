@@ -31,6 +31,7 @@
 #define OP_NATIVE       '='             /* native endian */
 
 #include <ctype.h>
+#include <limits.h>
 #include <string.h>
 
 #include "lualib.h"
@@ -68,6 +69,347 @@ static void doswap(int swap, void *p, size_t n)
  }
 }
 
+/* compiled formats (pack.compile) */
+
+#define FORMAT_NAME     "pack.format"
+
+typedef union
+{
+ lua_Number n;
+#ifndef LUA_NUMBER_INTEGRAL
+ double d;
+ float f;
+#endif
+ char c;
+ unsigned char b;
+ short h;
+ unsigned short H;
+ int i;
+ unsigned int I;
+ long l;
+ unsigned long L;
+ size_t a;
+} Data;
+
+typedef struct
+{
+ unsigned char op;              /* format code */
+ unsigned char swap;            /* swap the bytes of the values? */
+ unsigned char size;            /* size of a number or of a string length */
+ int count;                     /* number of values (length of OP_STRING) */
+} Item;
+
+typedef struct
+{
+ int nitems;
+ int nvalues;                   /* number of values returned by unpack */
+ size_t size;                   /* size of the packed data, 0 if variable */
+ char *buffer;                  /* pack buffer (after the items), if size>0 */
+ Item items[1];
+} Format;
+
+static int codesize(int c)
+{
+ switch (c)
+ {
+  case OP_ZSTRING: case OP_STRING: return 0;
+  case OP_BSTRING: return sizeof(unsigned char);
+  case OP_WSTRING: return sizeof(unsigned short);
+  case OP_SSTRING: return sizeof(size_t);
+  case OP_NUMBER: return sizeof(lua_Number);
+#ifndef LUA_NUMBER_INTEGRAL
+  case OP_DOUBLE: return sizeof(double);
+  case OP_FLOAT: return sizeof(float);
+#endif
+  case OP_CHAR: return sizeof(char);
+  case OP_BYTE: return sizeof(unsigned char);
+  case OP_SHORT: return sizeof(short);
+  case OP_USHORT: return sizeof(unsigned short);
+  case OP_INT: return sizeof(int);
+  case OP_UINT: return sizeof(unsigned int);
+  case OP_LONG: return sizeof(long);
+  case OP_ULONG: return sizeof(unsigned long);
+  default: return -1;
+ }
+}
+
+/* the code is a number (fixed size when packed) */
+static int isnumcode(int c)
+{
+ return codesize(c)>0 && c!=OP_BSTRING && c!=OP_WSTRING && c!=OP_SSTRING;
+}
+
+/* parse a format into 'p' (the items are stored only if 'store' is set) */
+static void parse(lua_State *L, const char *f, Format *p, int store)
+{
+ int swap=0;
+ int last=0;                    /* code of the previous number item */
+ int lastswap=0;
+ int fixed=1;
+ p->nitems=p->nvalues=0;
+ p->size=0;
+ while (*f)
+ {
+  int c=*f++;
+  int N=1;
+  if (isdigit((unsigned char)(*f)))
+  {
+   N=0;
+   while (isdigit((unsigned char)(*f)))
+   {
+    if (N>(INT_MAX-9)/10) luaL_argerror(L,1,"format too large");
+    N=10*N+(*f++-'0');
+   }
+  }
+  if (c==OP_LITTLEENDIAN || c==OP_BIGENDIAN || c==OP_NATIVE)
+   swap=doendian(c);
+  else if (c==' ' || c==',')
+   ;
+  else if (codesize(c)<0)
+   badcode(L,c);
+  else if (N>0 || c==OP_STRING)
+  {
+   if (N>INT_MAX-p->nvalues) luaL_argerror(L,1,"format too large");
+   p->nvalues+=c==OP_STRING ? 1 : N;
+   if (isnumcode(c))
+   {
+    if ((size_t)N>((size_t)-1-p->size)/codesize(c))
+     luaL_argerror(L,1,"format too large");
+    p->size+=codesize(c)*(size_t)N;
+   }
+   else
+    fixed=0;
+   if (c==last && swap==lastswap)
+   {
+    if (store) p->items[p->nitems-1].count+=N;  /* merge with the previous item */
+    continue;
+   }
+   if (store)
+   {
+    Item *it=p->items+p->nitems;
+    it->op=(unsigned char)c;
+    it->swap=(unsigned char)swap;
+    it->size=(unsigned char)codesize(c);
+    it->count=N;
+   }
+   last=isnumcode(c) ? c : 0;
+   lastswap=swap;
+   p->nitems++;
+  }
+ }
+ if (!fixed) p->size=0;
+}
+
+static Format *checkformat(lua_State *L, int narg)
+{
+ return (Format*)luaL_checkudata(L,narg,FORMAT_NAME);
+}
+
+static lua_Number getnumber(const Item *p, const char *s)
+{
+ Data v;
+ memcpy(&v,s,p->size);
+ doswap(p->swap,&v,p->size);
+ switch (p->op)
+ {
+  case OP_NUMBER: return v.n;
+#ifndef LUA_NUMBER_INTEGRAL
+  case OP_DOUBLE: return (lua_Number)v.d;
+  case OP_FLOAT: return (lua_Number)v.f;
+#endif
+  case OP_CHAR: return (lua_Number)v.c;
+  case OP_BYTE: return (lua_Number)v.b;
+  case OP_SHORT: return (lua_Number)v.h;
+  case OP_USHORT: return (lua_Number)v.H;
+  case OP_INT: return (lua_Number)v.i;
+  case OP_UINT: return (lua_Number)v.I;
+  case OP_LONG: return (lua_Number)v.l;
+  default: return (lua_Number)v.L;
+ }
+}
+
+static void putnumber(const Item *p, char *s, lua_Number x)
+{
+ Data v;
+ switch (p->op)
+ {
+  case OP_NUMBER: v.n=x; break;
+#ifndef LUA_NUMBER_INTEGRAL
+  case OP_DOUBLE: v.d=(double)x; break;
+  case OP_FLOAT: v.f=(float)x; break;
+#endif
+  case OP_CHAR: v.c=(char)x; break;
+  case OP_BYTE: v.b=(unsigned char)x; break;
+  case OP_SHORT: v.h=(short)x; break;
+  case OP_USHORT: v.H=(unsigned short)x; break;
+  case OP_INT: v.i=(int)x; break;
+  case OP_UINT: v.I=(unsigned int)x; break;
+  case OP_LONG: v.l=(long)x; break;
+  default: v.L=(unsigned long)x; break;
+ }
+ doswap(p->swap,&v,p->size);
+ memcpy(s,&v,p->size);
+}
+
+static int l_compile(lua_State *L)              /** compile(f) */
+{
+ const char *f=luaL_checkstring(L,1);
+ Format h,*p;
+ size_t itemsize;
+ parse(L,f,&h,0);
+ itemsize=sizeof(Format)+(h.nitems>0 ? h.nitems-1 : 0)*sizeof(Item);
+ if (h.size>(size_t)-1-itemsize) luaL_argerror(L,1,"format too large");
+ p=(Format*)lua_newuserdata(L,itemsize+h.size);
+ parse(L,f,p,1);
+ p->buffer=p->size>0 ? (char*)p+itemsize : NULL;
+ luaL_getmetatable(L,FORMAT_NAME);
+ lua_setmetatable(L,-2);
+ return 1;
+}
+
+#define STOREVALUE()                            \
+   if (t) lua_rawseti(L,t,++n); else ++n
+
+static int unpackformat(lua_State *L, const char *s, size_t len, const Format *f)
+{
+ int i=luaL_optnumber(L,3,1)-1;
+ int t=lua_isnoneornil(L,4) ? 0 : 4;
+ int n=0;
+ int k;
+ if (t)
+  luaL_checktype(L,t,LUA_TTABLE);
+ else
+ {
+  if (f->nvalues>=LUAI_MAXCSTACK) luaL_error(L,"too many values to unpack");
+  luaL_checkstack(L,f->nvalues+1,"too many values to unpack");
+  lua_pushnil(L);
+ }
+ for (k=0; k<f->nitems; k++)
+ {
+  const Item *p=f->items+k;
+  int N=p->count;
+  int m=p->size;
+  switch (p->op)
+  {
+   case OP_STRING:
+    if (((unsigned long)i+N)>len) goto done;
+    lua_pushlstring(L,s+i,N);
+    i+=N;
+    STOREVALUE();
+    break;
+   case OP_ZSTRING:
+    while (N--)
+    {
+     size_t l;
+     if (((unsigned long)i)>=len) goto done;
+     l=strlen(s+i);
+     lua_pushlstring(L,s+i,l);
+     i+=l+1;
+     STOREVALUE();
+    }
+    break;
+   case OP_BSTRING:
+   case OP_WSTRING:
+   case OP_SSTRING:
+    while (N--)
+    {
+     Data v;
+     size_t l;
+     if (((unsigned long)i+m)>len) goto done;
+     memcpy(&v,s+i,m);
+     doswap(p->swap,&v,m);
+     l=p->op==OP_BSTRING ? v.b : p->op==OP_WSTRING ? v.H : v.a;
+     if (((unsigned long)i+m+l)>len) goto done;
+     i+=m;
+     lua_pushlstring(L,s+i,l);
+     i+=l;
+     STOREVALUE();
+    }
+    break;
+   default:
+    while (N--)
+    {
+     if (((unsigned long)i+m)>len) goto done;
+     lua_pushnumber(L,getnumber(p,s+i));
+     i+=m;
+     STOREVALUE();
+    }
+    break;
+  }
+ }
+done:
+ lua_pushnumber(L,i+1);
+ if (t)
+ {
+  lua_pushinteger(L,n);
+  return 2;
+ }
+ lua_replace(L,-n-2);
+ return n+1;
+}
+
+static int packformat(lua_State *L, const Format *f)
+{
+ int i=2;
+ int k;
+ luaL_Buffer b;
+ char *s=f->buffer;
+ if (s==NULL) luaL_buffinit(L,&b);
+ for (k=0; k<f->nitems; k++)
+ {
+  const Item *p=f->items+k;
+  int N=p->count;
+  switch (p->op)
+  {
+   case OP_STRING:
+   case OP_ZSTRING:
+    while (N--)
+    {
+     size_t l;
+     const char *a=luaL_checklstring(L,i++,&l);
+     luaL_addlstring(&b,a,l+(p->op==OP_ZSTRING));
+    }
+    break;
+   case OP_BSTRING:
+   case OP_WSTRING:
+   case OP_SSTRING:
+    while (N--)
+    {
+     Data v;
+     size_t l;
+     const char *a=luaL_checklstring(L,i++,&l);
+     if (p->op==OP_BSTRING) v.b=(unsigned char)l;
+     else if (p->op==OP_WSTRING) v.H=(unsigned short)l;
+     else v.a=l;
+     doswap(p->swap,&v,p->size);
+     luaL_addlstring(&b,(void*)&v,p->size);
+     luaL_addlstring(&b,a,l);
+    }
+    break;
+   default:
+    while (N--)
+    {
+     lua_Number x=luaL_checknumber(L,i++);
+     if (s)
+     {
+      putnumber(p,s,x);
+      s+=p->size;
+     }
+     else
+     {
+      char a[sizeof(Data)];
+      putnumber(p,a,x);
+      luaL_addlstring(&b,a,p->size);
+     }
+    }
+    break;
+  }
+ }
+ if (s) lua_pushlstring(L,f->buffer,f->size);
+ else luaL_pushresult(&b);
+ return 1;
+}
+
 #define UNPACKNUMBER(OP,T)                      \
    case OP:                                     \
    {                                            \
@@ -98,14 +440,16 @@ static void doswap(int swap, void *p, size_t n)
     break;                                      \
    }
 
-static int l_unpack(lua_State *L)               /** unpack(s,f,[init]) */
+static int l_unpack(lua_State *L)               /** unpack(s,f,[init],[t]) */
 {
  size_t len;
  const char *s=luaL_checklstring(L,1,&len);
- const char *f=luaL_checkstring(L,2);
- int i=luaL_optnumber(L,3,1)-1;
- int n=0;
+ const char *f;
+ int i,n=0;
  int swap=0;
+ if (lua_isuserdata(L,2)) return unpackformat(L,s,len,checkformat(L,2));
+ f=luaL_checkstring(L,2);
+ i=luaL_optnumber(L,3,1)-1;
  lua_pushnil(L);
  while (*f)
  {
@@ -115,8 +459,9 @@ static int l_unpack(lua_State *L)               /** unpack(s,f,[init]) */
   {
    N=0;
    while (isdigit((unsigned char)(*f))) N=10*N+(*f++)-'0';
-   if (N==0 && c==OP_STRING) { lua_pushliteral(L,""); ++n; }
   }
+  luaL_checkstack(L,c==OP_STRING ? 1 : N,"too many values to unpack");
+  if (N==0 && c==OP_STRING) { lua_pushliteral(L,""); ++n; }
   while (N--) switch (c)
   {
    case OP_LITTLEENDIAN:
@@ -200,9 +545,11 @@ done:
 static int l_pack(lua_State *L)                 /** pack(f,...) */
 {
  int i=2;
- const char *f=luaL_checkstring(L,1);
+ const char *f;
  int swap=0;
  luaL_Buffer b;
+ if (lua_isuserdata(L,1)) return packformat(L,checkformat(L,1));
+ f=luaL_checkstring(L,1);
  luaL_buffinit(L,&b);
  while (*f)
  {
@@ -264,10 +611,24 @@ const LUA_REG_TYPE pack_map[] =
 {
   { LSTRKEY( "pack" ),  LFUNCVAL( l_pack ) },
   { LSTRKEY( "unpack" ), LFUNCVAL( l_unpack ) },
+  { LSTRKEY( "compile" ), LFUNCVAL( l_compile ) },
+  { LNILKEY, LNILVAL }
+};
+
+static const LUA_REG_TYPE pack_format_mt_map[] =
+{
   { LNILKEY, LNILVAL }
 };
 
 int luaopen_pack( lua_State *L )
 {
+#if ( MIN_OPT_LEVEL > 0 ) && ( LUA_OPTIMIZE_MEMORY >= MIN_OPT_LEVEL )
+  luaL_rometatable( L, FORMAT_NAME, ( void* )pack_format_mt_map );
+  return 0;
+#else
+  luaL_newmetatable( L, FORMAT_NAME );
+  luaL_register( L, NULL, pack_format_mt_map );
+  lua_pop( L, 1 );
   LREGISTER( L, AUXLIB_PACK, pack_map );
+#endif
 }
@@ -115,7 +115,8 @@ enum
   RPC_CMD_CALL = 1,
   RPC_CMD_GET,
   RPC_CMD_CON,
-  RPC_CMD_NEWINDEX
+  RPC_CMD_NEWINDEX,
+  RPC_CMD_ACALL
 };
 
 // RPC Status Codes
@@ -126,7 +127,14 @@ enum
   RPC_DONE
 };
 
-enum { RPC_PROTOCOL_VERSION = 3 };
+enum { RPC_PROTOCOL_VERSION = 5 };
+
+// Command target encoding: the length of the target path can carry flags
+// to define an id for the path (length and path follow) or to use a path id
+// defined before (nothing follows)
+#define RPC_PATH_DEFINE_ID    0x40000000UL
+#define RPC_PATH_USE_ID       0x80000000UL
+#define RPC_PATH_ID_MASK      0x3FFFFFFFUL
 
 
 // return a string representation of an error number
@@ -146,20 +154,94 @@ static const char * errorString( int n )
 }
 
 
+// **************************************************************************
+// buffered transport I/O
+//   outgoing data is assembled in the transport's write buffer and handed to
+//   transport_write_buffer when the buffer fills up, before blocking for a
+//   read, or at the end of a server command (transport_flush). incoming data
+//   is read in chunks into the read buffer.
+
+static void transport_buf_reset( Transport *tpt )
+{
+  tpt->wpos = 0;
+  tpt->rpos = tpt->rlen = 0;
+}
+
+// send any buffered output
+static void transport_flush( Transport *tpt )
+{
+  int len = tpt->wpos;
+
+  if( len > 0 )
+  {
+    tpt->wpos = 0;
+    transport_write_buffer( tpt, tpt->wbuf, len );
+  }
+}
+
+static void transport_buf_write( Transport *tpt, const u8 *buffer, int length )
+{
+  if( tpt->wpos + length > LUARPC_WBUF_SIZE )
+  {
+    transport_flush( tpt );
+    if( length >= LUARPC_WBUF_SIZE ) // large data goes out directly
+    {
+      transport_write_buffer( tpt, buffer, length );
+      return;
+    }
+  }
+  memcpy( tpt->wbuf + tpt->wpos, buffer, length );
+  tpt->wpos += length;
+}
+
+static void transport_buf_read( Transport *tpt, u8 *buffer, int length )
+{
+  int n;
+
+  while( length > 0 )
+  {
+    if( tpt->rpos == tpt->rlen )
+    {
+      // we're about to block, so the other side must get our output first
+      transport_flush( tpt );
+      tpt->rpos = tpt->rlen = 0;
+      if( length >= LUARPC_RBUF_SIZE ) // large data is read directly
+      {
+        transport_read_buffer( tpt, buffer, length );
+        return;
+      }
+      tpt->rlen = ( u16 )transport_read_some( tpt, tpt->rbuf, LUARPC_RBUF_SIZE );
+    }
+    n = tpt->rlen - tpt->rpos;
+    if( n > length )
+      n = length;
+    memcpy( buffer, tpt->rbuf + tpt->rpos, n );
+    tpt->rpos += n;
+    buffer += n;
+    length -= n;
+  }
+}
+
+// check if data is available (buffered or on the transport itself)
+static int transport_buf_readable( Transport *tpt )
+{
+  return tpt->rpos < tpt->rlen || transport_readable( tpt );
+}
+
 // **************************************************************************
 // transport layer generics
 
 // read arbitrary length from the transport into a string buffer.
 static void transport_read_string( Transport *tpt, const char *buffer, int length )
 {
-  transport_read_buffer( tpt, ( u8 * )buffer, length );
+  transport_buf_read( tpt, ( u8 * )buffer, length );
 }
 
 
 // write arbitrary length string buffer to the transport
 static void transport_write_string( Transport *tpt, const char *buffer, int length )
 {
-  transport_write_buffer( tpt, ( u8 * )buffer, length );
+  transport_buf_write( tpt, ( u8 * )buffer, length );
 }
 
 
@@ -169,7 +251,7 @@ static u8 transport_read_u8( Transport *tpt )
   u8 b;
   struct exception e;
   TRANSPORT_VERIFY_OPEN;
-  transport_read_buffer( tpt, &b, 1 );
+  transport_buf_read( tpt, &b, 1 );
   return b;
 }
 
@@ -179,7 +261,7 @@ static void transport_write_u8( Transport *tpt, u8 x )
 {
   struct exception e;
   TRANSPORT_VERIFY_OPEN;
-  transport_write_buffer( tpt, &x, 1 );
+  transport_buf_write( tpt, &x, 1 );
 }
 
 static void swap_bytes( uint8_t *number, size_t numbersize )
@@ -204,7 +286,7 @@ static u32 transport_read_u32( Transport *tpt )
   union u32_bytes ub;
   struct exception e;
   TRANSPORT_VERIFY_OPEN;
-  transport_read_buffer ( tpt, ub.b, 4 );
+  transport_buf_read( tpt, ub.b, 4 );
   if( tpt->net_little != tpt->loc_little )
     swap_bytes( ( uint8_t * )ub.b, 4 );
   return ub.i;
@@ -220,7 +302,7 @@ static void transport_write_u32( Transport *tpt, u32 x )
   ub.i = ( uint32_t )x;
   if( tpt->net_little != tpt->loc_little )
     swap_bytes( ( uint8_t * )ub.b, 4 );
-  transport_write_buffer( tpt, ub.b, 4 );
+  transport_buf_write( tpt, ub.b, 4 );
 }
 
 // read a lua number from the transport
@@ -230,7 +312,7 @@ static lua_Number transport_read_number( Transport *tpt )
   u8 b[ tpt->lnum_bytes ];
   struct exception e;
   TRANSPORT_VERIFY_OPEN;
-  transport_read_buffer ( tpt, b, tpt->lnum_bytes );
+  transport_buf_read( tpt, b, tpt->lnum_bytes );
 
   if( tpt->net_little != tpt->loc_little )
     swap_bytes( ( uint8_t * )b, tpt->lnum_bytes );
@@ -277,25 +359,25 @@ static void transport_write_number( Transport *tpt, lua_Number x )
     {
       case 1: {
         int8_t y = ( int8_t )x;
-        transport_write_buffer( tpt, ( u8 * )&y, 1 );
+        transport_buf_write( tpt, ( u8 * )&y, 1 );
       } break;
       case 2: {
         int16_t y = ( int16_t )x;
         if( tpt->net_little != tpt->loc_little )
           swap_bytes( ( uint8_t * )&y, 2 );
-        transport_write_buffer( tpt, ( u8 * )&y, 2 );
+        transport_buf_write( tpt, ( u8 * )&y, 2 );
       } break;
       case 4: {
         int32_t y = ( int32_t )x;
         if( tpt->net_little != tpt->loc_little )
           swap_bytes( ( uint8_t * )&y, 4 );
-        transport_write_buffer( tpt,( u8 * )&y, 4 );
+        transport_buf_write( tpt,( u8 * )&y, 4 );
       } break;
       case 8: {
         int64_t y = ( int64_t )x;
         if( tpt->net_little != tpt->loc_little )
           swap_bytes( ( uint8_t * )&y, 8 );
-        transport_write_buffer( tpt, ( u8 * )&y, 8 );
+        transport_buf_write( tpt, ( u8 * )&y, 8 );
       } break;
       default: lua_assert(0);
     }
@@ -304,7 +386,7 @@ static void transport_write_number( Transport *tpt, lua_Number x )
   {
     if( tpt->net_little != tpt->loc_little )
        swap_bytes( ( uint8_t * )&x, 8 );
-    transport_write_buffer( tpt, ( u8 * )&x, 8 );
+    transport_buf_write( tpt, ( u8 * )&x, 8 );
   }
 }
 
@@ -435,7 +517,7 @@ static void write_function( Transport *tpt, lua_State *L, int var_index )
 }
 #endif
 
-static void helper_remote_index( Helper *helper );
+static void helper_remote_index( lua_State *L, Helper *helper );
 
 // write a variable at the given index in the stack. the index must be absolute
 // (i.e. positive).
@@ -488,7 +570,7 @@ static void write_variable( Transport *tpt, lua_State *L, int var_index )
       if( lua_isuserdata( L, var_index ) && ismetatable_type( L, var_index, "rpc.helper" ) )
       {
         transport_write_u8( tpt, RPC_REMOTE );
-        helper_remote_index( ( Helper * )lua_touserdata( L, var_index ) );
+        helper_remote_index( L, ( Helper * )lua_touserdata( L, var_index ) );
       } else
         luaL_error( L, "userdata transmission unsupported" );
       break;
@@ -711,8 +793,13 @@ static void server_negotiate( Transport *tpt )
 }
 
 
+static void handle_reset_paths( lua_State *L, Handle *handle );
+
 static int generic_catch_handler(lua_State *L, Handle *handle, struct exception e )
 {
+  handle->tpt.wpos = 0; // drop partial request
+  // the remote side might have missed path id definitions
+  handle_reset_paths( L, handle );
   deal_with_error( L, handle, errorString( e.errnum ) );
   switch( e.type )
   {
@@ -762,11 +849,35 @@ Handle *handle_create( lua_State *L )
   luaL_getmetatable( L, "rpc.handle" );
   lua_setmetatable( L, -2 );
   h->error_handler = LUA_NOREF;
-  h->async = 0;
-  h->read_reply_count = 0;
+  h->seq = 0;
+  h->npending = 0;
+  lua_newtable( L );
+  h->pending_ref = luaL_ref( L, LUA_REGISTRYINDEX );
+  h->paths_ref = LUA_NOREF;
+  handle_reset_paths( L, h );
   return h;
 }
 
+static int handle_close( lua_State *L )
+{
+  Handle *h = ( Handle * )luaL_checkudata( L, 1, "rpc.handle" );
+  luaL_argcheck( L, h, 1, "handle expected" );
+
+  luaL_unref( L, LUA_REGISTRYINDEX, h->pending_ref );
+  luaL_unref( L, LUA_REGISTRYINDEX, h->paths_ref );
+  h->pending_ref = h->paths_ref = LUA_NOREF;
+  return 0;
+}
+
+// forget all the path ids defined on the handle
+static void handle_reset_paths( lua_State *L, Handle *handle )
+{
+  luaL_unref( L, LUA_REGISTRYINDEX, handle->paths_ref );
+  lua_newtable( L );
+  handle->paths_ref = luaL_ref( L, LUA_REGISTRYINDEX );
+  handle->npaths = 0;
+}
+
 static Helper *helper_create( lua_State *L, Handle *handle, const char *funcname )
 {
   Helper *h = ( Helper * )lua_newuserdata( L, sizeof( Helper ) );
@@ -827,47 +938,87 @@ static int handle_newindex( lua_State *L )
   return 0;
 }
 
-// replays series of indexes to remote side as a string
-static void helper_remote_index( Helper *helper )
+// push the dotted path of a helper (e.g. "pio.pin.setval")
+static void helper_push_path( lua_State *L, Helper *helper )
 {
-  int i, len;
+  int i;
   Helper **hstack;
-  Transport *tpt = &helper->handle->tpt;
+  luaL_Buffer b;
+
+  hstack = ( Helper ** )alloca( sizeof( Helper * ) * ( helper->nparents + 1 ) );
+  hstack[ helper->nparents ] = helper;
+  for( i = helper->nparents; i > 0; i -- )
+    hstack[ i - 1 ] = hstack[ i ]->parent;
 
-  // get length of name & make stack of helpers
-  len = ( u32 )strlen( helper->funcname );
-  if( helper->nparents > 0 ) // If helper has parents, build string to remote index
+  luaL_buffinit( L, &b );
+  for( i = 0; i <= helper->nparents; i ++ )
   {
-    hstack = ( Helper ** )alloca( sizeof( Helper * ) * helper->nparents );
-    hstack[ helper->nparents - 1 ] = helper->parent;
-    len += strlen( hstack[ helper->nparents - 1 ]->funcname ) + 1;
+    if( i > 0 )
+      luaL_addchar( &b, '.' );
+    luaL_addstring( &b, hstack[ i ]->funcname );
+  }
+  luaL_pushresult( &b );
+}
 
-    for( i = helper->nparents - 1 ; i > 0 ; i -- )
-    {
-      hstack[ i - 1 ] = hstack[ i ]->parent;
-      len += strlen( hstack[ i - 1 ]->funcname ) + 1;
-    }
+// replays series of indexes to remote side as a string
+static void helper_remote_index( lua_State *L, Helper *helper )
+{
+  Transport *tpt = &helper->handle->tpt;
+  size_t len;
+  const char *path;
 
-    transport_write_u32( tpt, len );
+  helper_push_path( L, helper );
+  path = lua_tolstring( L, -1, &len );
+  transport_write_u32( tpt, ( u32 )len );
+  transport_write_string( tpt, path, ( int )len );
+  lua_pop( L, 1 );
+}
 
-    // replay helper key names
-    for( i = 0 ; i < helper->nparents ; i ++ )
-    {
-      transport_write_string( tpt, hstack[ i ]->funcname, ( int )strlen( hstack[ i ]->funcname ) );
-      transport_write_string( tpt, ".", 1 );
-    }
+// write the target of a command. the first time a path is used it gets an id,
+// which is sent instead of the path afterwards.
+static void helper_remote_target( lua_State *L, Helper *helper )
+{
+  Handle *handle = helper->handle;
+  Transport *tpt = &handle->tpt;
+  size_t len;
+  const char *path;
+  u32 id = 0;
+
+  helper_push_path( L, helper );
+  lua_rawgeti( L, LUA_REGISTRYINDEX, handle->paths_ref );
+  lua_pushvalue( L, -2 );
+  lua_rawget( L, -2 );
+  if( lua_isnumber( L, -1 ) )
+  {
+    transport_write_u32( tpt, RPC_PATH_USE_ID | ( u32 )lua_tointeger( L, -1 ) );
+    lua_pop( L, 3 );
+    return;
   }
-  else // If helper has no parents, just use length of global
-    transport_write_u32( tpt, len );
-
-  transport_write_string( tpt, helper->funcname, ( int )strlen( helper->funcname ) );
+  lua_pop( L, 1 );
+  if( handle->npaths < RPC_MAX_PATH_IDS )
+  {
+    id = ++ handle->npaths;
+    lua_pushvalue( L, -2 );
+    lua_pushinteger( L, id );
+    lua_rawset( L, -3 );
+    transport_write_u32( tpt, RPC_PATH_DEFINE_ID | id );
+  }
+  path = lua_tolstring( L, -2, &len );
+  transport_write_u32( tpt, ( u32 )len );
+  transport_write_string( tpt, path, ( int )len );
+  lua_pop( L, 2 );
 }
 
-static void helper_wait_ready( Transport *tpt, u8 cmd )
+static void handle_drain_async( lua_State *L, Handle *handle );
+
+static void helper_wait_ready( lua_State *L, Handle *handle, u8 cmd )
 {
   struct exception e;
   u8 cmdresp;
+  Transport *tpt = &handle->tpt;
 
+  // replies to pending async calls come first
+  handle_drain_async( L, handle );
   transport_write_u8( tpt, cmd );
   cmdresp = transport_read_u8( tpt );
   if( cmdresp != RPC_READY )
@@ -887,8 +1038,8 @@ static int helper_get( lua_State *L, Helper *helper )
 
   Try
   {
-    helper_wait_ready( tpt, RPC_CMD_GET );
-    helper_remote_index( helper );
+    helper_wait_ready( L, helper->handle, RPC_CMD_GET );
+    helper_remote_target( L, helper );
 
     read_variable( tpt, L );
 
@@ -902,37 +1053,162 @@ static int helper_get( lua_State *L, Helper *helper )
 }
 
 
-// static int helper_async( lua_State *L )
-// {
-//     /* first read out any pending return values for old async calls */
-//     for (; h->handle->read_reply_count > 0; h->handle->read_reply_count--) {
-//       ret_code = transport_read_u8 (tpt);   /* return code */
-//       if( ret_code == 0 )
-//       {
-//         /* read return arguments, ignore everything we read */
-//         nret = transport_read_u32( tpt );
-//
-//         for (i=0; i < ( ( int ) nret ); i++)
-//           read_variable (tpt,L);
-//
-//         lua_pop (L,nret);
-//       }
-//       else
-//       {
-//         /* read error and handle it */
-//         u32 code = transport_read_u32( tpt );
-//         u32 len = transport_read_u32( tpt );
-//         char *err_string = ( char * )alloca( len + 1 );
-//         transport_read_string( tpt, err_string, len );
-//         err_string[ len ] = 0;
-//
-//         deal_with_error( L, h->handle, err_string );
-//         freturn = 0;
-//       }
-//     }
-// }
+// **************************************************************************
+// asynchronous (pipelined) calls
+//   h.func:async( ... ) sends the call without waiting for the remote side and
+//   returns a future. replies are tagged with the call's sequence number and
+//   are read (in order) by rpc.wait/rpc.poll, or before the next synchronous
+//   command on the same handle.
+
+static Future *future_create( lua_State *L, Handle *handle )
+{
+  Future *f = ( Future * )lua_newuserdata( L, sizeof( Future ) );
+  luaL_getmetatable( L, "rpc.future" );
+  lua_setmetatable( L, -2 );
+
+  lua_pushvalue( L, 1 ); // keep the helper (and thus the handle) alive
+  f->href = luaL_ref( L, LUA_REGISTRYINDEX );
+  f->rref = LUA_NOREF;
+  f->handle = handle;
+  f->seq = 0;
+  f->state = RPC_FUTURE_PENDING;
+  return f;
+}
+
+// read the reply to an async call and store it in the call's future
+static void handle_read_async_reply( lua_State *L, Handle *handle )
+{
+  struct exception e;
+  Transport *tpt = &handle->tpt;
+  int top = lua_gettop( L );
+  int i, ptable, rtable;
+  u32 seq, nret;
+  Future *f;
+
+  seq = transport_read_u32( tpt );
+  lua_rawgeti( L, LUA_REGISTRYINDEX, handle->pending_ref );
+  ptable = lua_gettop( L );
+  lua_pushnumber( L, seq );
+  lua_rawget( L, ptable );
+  if( ( f = ( Future * )lua_touserdata( L, -1 ) ) == NULL )
+  {
+    lua_settop( L, top );
+    e.errnum = ERR_PROTOCOL;
+    e.type = nonfatal;
+    Throw( e );
+  }
+  lua_pushnumber( L, seq );
+  lua_pushnil( L );
+  lua_rawset( L, ptable );
+  handle->npending --;
+
+  lua_newtable( L );
+  rtable = lua_gettop( L );
+  if( transport_read_u8( tpt ) == 0 )
+  {
+    // read return values into the results table
+    nret = transport_read_u32( tpt );
+    for( i = 1; i <= ( int )nret; i ++ )
+    {
+      read_variable( tpt, L );
+      lua_rawseti( L, rtable, i );
+    }
+    lua_pushnumber( L, nret );
+    lua_setfield( L, rtable, "n" );
+    f->state = RPC_FUTURE_DONE;
+  }
+  else
+  {
+    // read error string
+    transport_read_u32( tpt ); // read code (not being used here)
+    u32 len = transport_read_u32( tpt );
+    char *err_string = ( char * )alloca( len + 1 );
+    transport_read_string( tpt, err_string, len );
+    err_string[ len ] = 0;
+    lua_pushstring( L, err_string );
+    lua_rawseti( L, rtable, 1 );
+    f->state = RPC_FUTURE_ERROR;
+  }
+  f->rref = luaL_ref( L, LUA_REGISTRYINDEX );
+  lua_settop( L, top );
+}
+
+// read the replies to all the pending async calls
+static void handle_drain_async( lua_State *L, Handle *handle )
+{
+  while( handle->npending > 0 )
+    handle_read_async_reply( L, handle );
+}
 
+// h.func:async( ... ) - called on the "async" helper whose parent is h.func
+static int helper_async( lua_State *L, Helper *helper )
+{
+  struct exception e;
+  Handle *handle = helper->handle;
+  Transport *tpt = &handle->tpt;
+  int i, n = lua_gettop( L );
+  Future *f;
 
+  f = future_create( L, handle );
+  Try
+  {
+    f->seq = handle->seq ++;
+    transport_write_u8( tpt, RPC_CMD_ACALL );
+    transport_write_u32( tpt, f->seq );
+    helper_remote_target( L, helper );
+
+    // write arguments (the first two are the helpers)
+    transport_write_u32( tpt, n - 2 );
+    for( i = 3; i <= n; i ++ )
+      write_variable( tpt, L, i );
+    transport_flush( tpt );
+
+    // remember the future until its reply arrives
+    lua_rawgeti( L, LUA_REGISTRYINDEX, handle->pending_ref );
+    lua_pushnumber( L, f->seq );
+    lua_pushvalue( L, n + 1 );
+    lua_rawset( L, -3 );
+    lua_pop( L, 1 );
+    handle->npending ++;
+  }
+  Catch( e )
+  {
+    return generic_catch_handler( L, handle, e );
+  }
+  return 1;
+}
+
+static int future_close( lua_State *L )
+{
+  Future *f = ( Future * )luaL_checkudata( L, 1, "rpc.future" );
+  luaL_argcheck( L, f, 1, "future expected" );
+
+  luaL_unref( L, LUA_REGISTRYINDEX, f->rref );
+  luaL_unref( L, LUA_REGISTRYINDEX, f->href );
+  f->rref = f->href = LUA_NOREF;
+  return 0;
+}
+
+// push the results of a completed async call
+static int future_results( lua_State *L, Future *f )
+{
+  int i, n;
+
+  lua_rawgeti( L, LUA_REGISTRYINDEX, f->rref );
+  if( f->state == RPC_FUTURE_ERROR )
+  {
+    lua_rawgeti( L, -1, 1 );
+    deal_with_error( L, f->handle, lua_tostring( L, -1 ) );
+    return 0;
+  }
+  lua_getfield( L, -1, "n" );
+  n = lua_tointeger( L, -1 );
+  lua_pop( L, 1 );
+  luaL_checkstack( L, n, "too many results" );
+  for( i = 1; i <= n; i ++ )
+    lua_rawgeti( L, -i, i );
+  return n;
+}
 
 
 static int helper_call (lua_State *L)
@@ -953,6 +1229,8 @@ static int helper_call (lua_State *L)
     helper_get( L, h->parent );
     freturn = 1;
   }
+  else if( h->parent && strcmp( "async", h->funcname ) == 0 )
+    freturn = helper_async( L, h->parent );
   else
   {
     Try
@@ -961,8 +1239,8 @@ static int helper_call (lua_State *L)
       u32 nret,ret_code;
 
       // write function name
-      helper_wait_ready( tpt, RPC_CMD_CALL );
-      helper_remote_index( h );
+      helper_wait_ready( L, h->handle, RPC_CMD_CALL );
+      helper_remote_target( L, h );
 
       // write number of arguments
       n = lua_gettop( L );
@@ -972,13 +1250,6 @@ static int helper_call (lua_State *L)
       for( i = 2; i <= n; i ++ )
         write_variable( tpt, L, i );
 
-      /* if we're in async mode, we're done */
-      /*if ( h->handle->async )
-      {
-        h->handle->read_reply_count++;
-        freturn = 0;
-      }*/
-
       // read return code
       ret_code = transport_read_u8( tpt );
 
@@ -1032,8 +1303,8 @@ static int helper_newindex( lua_State *L )
   Try
   {
     // index destination on remote side
-    helper_wait_ready( tpt, RPC_CMD_NEWINDEX );
-    helper_remote_index( h );
+    helper_wait_ready( L, h->handle, RPC_CMD_NEWINDEX );
+    helper_remote_target( L, h );
 
     write_variable( tpt, L, lua_gettop( L ) - 1 );
     write_variable( tpt, L, lua_gettop( L ) );
@@ -1116,9 +1387,12 @@ static ServerHandle *server_handle_create( lua_State *L )
   lua_setmetatable( L, -2 );
 
   h->link_errs = 0;
+  h->paths_ref = h->values_ref = LUA_NOREF;
 
   transport_init( &h->ltpt );
   transport_init( &h->atpt );
+  transport_buf_reset( &h->ltpt );
+  transport_buf_reset( &h->atpt );
   return h;
 }
 
@@ -1128,9 +1402,43 @@ static void server_handle_shutdown( ServerHandle *h )
   transport_close( &h->atpt );
 }
 
-static void server_handle_destroy( ServerHandle *h )
+static void server_handle_unref( lua_State *L, ServerHandle *h )
+{
+  luaL_unref( L, LUA_REGISTRYINDEX, h->paths_ref );
+  luaL_unref( L, LUA_REGISTRYINDEX, h->values_ref );
+  h->paths_ref = h->values_ref = LUA_NOREF;
+}
+
+static void server_handle_destroy( lua_State *L, ServerHandle *h )
 {
   server_handle_shutdown( h );
+  server_handle_unref( L, h );
+}
+
+static int server_handle_close( lua_State *L )
+{
+  ServerHandle *h = ( ServerHandle * )luaL_checkudata( L, 1, "rpc.server_handle" );
+  luaL_argcheck( L, h, 1, "server handle expected" );
+
+  server_handle_unref( L, h );
+  return 0;
+}
+
+// forget the resolved paths (the remote side changed something)
+static void server_handle_reset_values( lua_State *L, ServerHandle *h )
+{
+  luaL_unref( L, LUA_REGISTRYINDEX, h->values_ref );
+  lua_newtable( L );
+  h->values_ref = luaL_ref( L, LUA_REGISTRYINDEX );
+}
+
+// forget the path ids and resolved paths (new connection)
+static void server_handle_reset_paths( lua_State *L, ServerHandle *h )
+{
+  luaL_unref( L, LUA_REGISTRYINDEX, h->paths_ref );
+  lua_newtable( L );
+  h->paths_ref = luaL_ref( L, LUA_REGISTRYINDEX );
+  server_handle_reset_values( L, h );
 }
 
 // **************************************************************************
@@ -1150,6 +1458,7 @@ static int rpc_connect( lua_State *L )
   {
     handle = handle_create ( L );
     transport_open_connection( L, handle );
+    transport_buf_reset( &handle->tpt );
 
     transport_write_u8( &handle->tpt, RPC_CMD_CON );
     client_negotiate( &handle->tpt );
@@ -1194,28 +1503,51 @@ static int rpc_close( lua_State *L )
 }
 
 
-// rpc_async (handle,)
-//     this sets a handle's asynchronous calling mode (0/nil=off, other=on).
-//     (this is for the client only).
-//     @@@ Before re-enabling, this should be brought up to date with multi-command architecture
+// rpc_wait( future )
+//     wait for the reply to an async call and return its results. errors are
+//     handled like the errors of a synchronous call.
 
-// static int rpc_async (lua_State *L)
-// {
-//   Handle *handle;
-//   check_num_args( L, 2 );
-//
-//   if ( !lua_isuserdata( L, 1 ) || !ismetatable_type( L, 1, "rpc.handle" ) )
-//     my_lua_error( L, "first arg must be client handle" );
-//
-//   handle = ( Handle * )lua_touserdata( L, 1 );
-//
-//   if ( lua_isnil( L, 2 ) || ( lua_isnumber( L, 2 ) && lua_tonumber( L, 2 ) == 0) )
-//     handle->async = 0;
-//   else
-//     handle->async = 1;
-//
-//   return 0;
-// }
+static int rpc_wait( lua_State *L )
+{
+  struct exception e;
+  Future *f = ( Future * )luaL_checkudata( L, 1, "rpc.future" );
+  luaL_argcheck( L, f, 1, "future expected" );
+
+  Try
+  {
+    while( f->state == RPC_FUTURE_PENDING )
+      handle_read_async_reply( L, f->handle );
+  }
+  Catch( e )
+  {
+    return generic_catch_handler( L, f->handle, e );
+  }
+  return future_results( L, f );
+}
+
+
+// rpc_poll( future )
+//     read the replies that are already available, without blocking. returns
+//     true if the reply to the async call has arrived.
+
+static int rpc_poll( lua_State *L )
+{
+  struct exception e;
+  Future *f = ( Future * )luaL_checkudata( L, 1, "rpc.future" );
+  luaL_argcheck( L, f, 1, "future expected" );
+
+  Try
+  {
+    while( f->state == RPC_FUTURE_PENDING && transport_buf_readable( &f->handle->tpt ) )
+      handle_read_async_reply( L, f->handle );
+  }
+  Catch( e )
+  {
+    return generic_catch_handler( L, f->handle, e );
+  }
+  lua_pushboolean( L, f->state != RPC_FUTURE_PENDING );
+  return 1;
+}
 
 //****************************************************************************
 // lua remote function server
@@ -1223,21 +1555,85 @@ static int rpc_close( lua_State *L )
 //   stack on entry and exit. This sets a custom error handler to catch errors
 //   around the function call.
 
-static void read_cmd_call( Transport *tpt, lua_State *L )
+// read the target path of a command (see RPC_PATH_xxx), push it as a string and
+// return it. *pid is set to the path id (0 if the path doesn't have one)
+static const char *read_cmd_path( ServerHandle *handle, lua_State *L, u32 *pid, size_t *plen )
+{
+  struct exception e;
+  Transport *tpt = &handle->atpt;
+  u32 len, id = 0;
+  char *path;
+
+  len = transport_read_u32( tpt );
+  if( len & RPC_PATH_USE_ID )
+  {
+    *pid = len & RPC_PATH_ID_MASK;
+    lua_rawgeti( L, LUA_REGISTRYINDEX, handle->paths_ref );
+    lua_rawgeti( L, -1, *pid );
+    lua_remove( L, -2 );
+    if( !lua_isstring( L, -1 ) )
+    {
+      e.errnum = ERR_PROTOCOL;
+      e.type = nonfatal;
+      Throw( e );
+    }
+    return lua_tolstring( L, -1, plen );
+  }
+  if( len & RPC_PATH_DEFINE_ID )
+  {
+    id = len & RPC_PATH_ID_MASK;
+    len = transport_read_u32( tpt );
+  }
+  path = ( char * )alloca( len + 1 );
+  transport_read_string( tpt, path, len );
+  lua_pushlstring( L, path, len );
+  if( id )
+  {
+    // remember the path, and forget what the id was resolved to before
+    lua_rawgeti( L, LUA_REGISTRYINDEX, handle->paths_ref );
+    lua_pushvalue( L, -2 );
+    lua_rawseti( L, -2, id );
+    lua_rawgeti( L, LUA_REGISTRYINDEX, handle->values_ref );
+    lua_pushnil( L );
+    lua_rawseti( L, -2, id );
+    lua_pop( L, 2 );
+  }
+  *pid = id;
+  return lua_tolstring( L, -1, plen );
+}
+
+static void read_cmd_call( ServerHandle *handle, lua_State *L, int async )
 {
   int i, stackpos, good_function, nargs;
-  u32 len;
+  u32 seq = 0, id;
+  size_t len;
+  const char *path;
   char *funcname;
   char *token = NULL;
+  Transport *tpt = &handle->atpt;
+
+  // async calls have a sequence number that must be sent back with the reply
+  if( async )
+    seq = transport_read_u32( tpt );
 
   // read function name
-  len = transport_read_u32( tpt ); /* function name string length */
+  path = read_cmd_path( handle, L, &id, &len );
   funcname = ( char * )alloca( len + 1 );
-  transport_read_string( tpt, funcname, len );
-  funcname[ len ] = 0;
+  memcpy( funcname, path, len + 1 );
+  lua_pop( L, 1 );
+
+  // use the function resolved before for this path id, if any
+  if( id )
+  {
+    lua_rawgeti( L, LUA_REGISTRYINDEX, handle->values_ref );
+    lua_rawgeti( L, -1, id );
+    lua_remove( L, -2 );
+    if( LUA_ISCALLABLE( L, -1 ) )
+      goto resolved;
+    lua_pop( L, 1 );
+  }
 
   // get function
-  // @@@ perhaps handle more like variables instead of using a long string?
   // @@@ also strtok is not thread safe
   token = strtok( funcname, "." );
   lua_getglobal( L, token );
@@ -1257,6 +1653,15 @@ static void read_cmd_call( Transport *tpt, lua_State *L )
       }
     }
   }
+  if( id && LUA_ISCALLABLE( L, -1 ) )
+  {
+    // keep the function for the next calls with this path id
+    lua_rawgeti( L, LUA_REGISTRYINDEX, handle->values_ref );
+    lua_pushvalue( L, -2 );
+    lua_rawseti( L, -2, id );
+    lua_pop( L, 1 );
+  }
+resolved:
   stackpos = lua_gettop( L ) - 1;
   good_function = LUA_ISCALLABLE( L, -1 );
 
@@ -1267,6 +1672,10 @@ static void read_cmd_call( Transport *tpt, lua_State *L )
   for ( i = 0; i < nargs; i ++ )
     read_variable( tpt, L );
 
+  // output is buffered, so the reply can start here
+  if( async )
+    transport_write_u32( tpt, seq );
+
   // call the function
   if( good_function )
   {
@@ -1318,20 +1727,22 @@ static void read_cmd_call( Transport *tpt, lua_State *L )
 }
 
 
-static void read_cmd_get( Transport *tpt, lua_State *L )
+static void read_cmd_get( ServerHandle *handle, lua_State *L )
 {
-  u32 len;
+  u32 id;
+  size_t len;
+  const char *path;
   char *funcname;
   char *token = NULL;
+  Transport *tpt = &handle->atpt;
 
-  // read function name
-  len = transport_read_u32( tpt ); // function name string length
+  // read variable name (values are always looked up again, they change)
+  path = read_cmd_path( handle, L, &id, &len );
   funcname = ( char * )alloca( len + 1 );
-  transport_read_string( tpt, funcname, len );
-  funcname[ len ] = 0;
+  memcpy( funcname, path, len + 1 );
+  lua_pop( L, 1 );
 
-  // get function
-  // @@@ perhaps handle more like variables instead of using a long string?
+  // get variable
   // @@@ also strtok is not thread safe
   token = strtok( funcname, "." );
   lua_getglobal( L, token );
@@ -1351,20 +1762,22 @@ static void read_cmd_get( Transport *tpt, lua_State *L )
 }
 
 
-static void read_cmd_newindex( Transport *tpt, lua_State *L )
+static void read_cmd_newindex( ServerHandle *handle, lua_State *L )
 {
-  u32 len;
+  u32 id;
+  size_t len;
+  const char *path;
   char *funcname;
   char *token = NULL;
+  Transport *tpt = &handle->atpt;
 
-  // read function name
-  len = transport_read_u32( tpt ); // function name string length
+  // read table name
+  path = read_cmd_path( handle, L, &id, &len );
   funcname = ( char * )alloca( len + 1 );
-  transport_read_string( tpt, funcname, len );
-  funcname[ len ] = 0;
+  memcpy( funcname, path, len + 1 );
+  lua_pop( L, 1 );
 
-  // get function
-  // @@@ perhaps handle more like variables instead of using a long string?
+  // get table
   // @@@ also strtok is not thread safe
   if( strlen( funcname ) > 0 )
   {
@@ -1387,6 +1800,8 @@ static void read_cmd_newindex( Transport *tpt, lua_State *L )
     read_variable( tpt, L ); // value
     lua_setglobal( L, lua_tostring( L, -2 ) );
   }
+  // the assignment might change the target of any resolved path
+  server_handle_reset_values( L, handle );
   // Write out 0 to indicate no error and that we're done
   transport_write_u8( tpt, 0 );
 
@@ -1422,7 +1837,7 @@ static ServerHandle *rpc_listen_helper( lua_State *L )
   Catch( e )
   {
     if( handle )
-      server_handle_destroy( handle );
+      server_handle_destroy( L, handle );
 
     deal_with_error( L, 0, errorString( e.errnum ) );
     return 0;
@@ -1459,7 +1874,7 @@ static int rpc_peek( lua_State *L )
   // if accepting transport is open, see if there is any data to read
   if ( transport_is_open( &handle->atpt ) )
   {
-    if ( transport_readable( &handle->atpt ) )
+    if ( transport_buf_readable( &handle->atpt ) )
       lua_pushnumber( L, 1 );
     else
       lua_pushnil( L );
@@ -1498,18 +1913,22 @@ static void rpc_dispatch_helper( lua_State *L, ServerHandle *handle )
         {
           case RPC_CMD_CALL:  // call function
             transport_write_u8( &handle->atpt, RPC_READY );
-            read_cmd_call( &handle->atpt, L );
+            read_cmd_call( handle, L, 0 );
+            break;
+          case RPC_CMD_ACALL: // pipelined call (no handshake)
+            read_cmd_call( handle, L, 1 );
             break;
           case RPC_CMD_GET: // get server-side variable for client
             transport_write_u8( &handle->atpt, RPC_READY );
-            read_cmd_get( &handle->atpt, L );
+            read_cmd_get( handle, L );
             break;
           case RPC_CMD_CON: //  allow client to renegotiate active connection
             server_negotiate( &handle->atpt );
+            server_handle_reset_paths( L, handle );
             break;
           case RPC_CMD_NEWINDEX: // assign new variable on server
             transport_write_u8( &handle->atpt, RPC_READY );
-            read_cmd_newindex( &handle->atpt, L );
+            read_cmd_newindex( handle, L );
             break;
           default: // complain and throw exception if unknown command
             transport_write_u8(&handle->atpt, RPC_UNSUPPORTED_CMD );
@@ -1517,6 +1936,9 @@ static void rpc_dispatch_helper( lua_State *L, ServerHandle *handle )
             e.errnum = ERR_COMMAND;
             Throw( e );
         }
+        // send the response, unless more (pipelined) commands are waiting
+        if( handle->atpt.rpos == handle->atpt.rlen )
+          transport_flush( &handle->atpt );
 
         handle->link_errs = 0;
       }
@@ -1528,6 +1950,7 @@ static void rpc_dispatch_helper( lua_State *L, ServerHandle *handle )
             Throw( e );
 
           case nonfatal:
+            handle->atpt.wpos = 0; // drop partial response
             handle->link_errs++;
             if ( handle->link_errs > MAX_LINK_ERRS )
             {
@@ -1546,11 +1969,14 @@ static void rpc_dispatch_helper( lua_State *L, ServerHandle *handle )
       // if accepting transport is not open, accept a new connection from the
       // listening transport
       transport_accept( &handle->ltpt, &handle->atpt );
+      transport_buf_reset( &handle->atpt );
 
       switch ( transport_read_u8( &handle->atpt ) )
       {
         case RPC_CMD_CON:
           server_negotiate( &handle->atpt );
+          server_handle_reset_paths( L, handle );
+          transport_flush( &handle->atpt );
           break;
         default: // connection must be established to issue any other commands
           e.type = nonfatal;
@@ -1598,7 +2024,7 @@ static int rpc_adispatch_helper( lua_State *L, ServerHandle * handle )
 {
   // Check if we have waiting data that we can dispatch on,
   // don't block if we don't have any data
-  if( transport_readable( &handle->atpt ) || transport_readable( &handle->ltpt ) )
+  if( transport_buf_readable( &handle->atpt ) || transport_readable( &handle->ltpt ) )
       rpc_dispatch_helper( L, handle );
 
   return 0;
@@ -1639,7 +2065,7 @@ static int rpc_server( lua_State *L )
     rpc_dispatch_helper( L, handle );
 
   luaL_unref( L, LUA_REGISTRYINDEX, shref );
-  server_handle_destroy( handle );
+  server_handle_destroy( L, handle );
   return 0;
 }
 
@@ -1682,6 +2108,7 @@ const LUA_REG_TYPE rpc_handle[] =
 {
   { LSTRKEY( "__index" ), LFUNCVAL( handle_index ) },
   { LSTRKEY( "__newindex"), LFUNCVAL( handle_newindex )},
+  { LSTRKEY( "__gc" ), LFUNCVAL( handle_close ) },
   { LNILKEY, LNILVAL }
 };
 
@@ -1694,8 +2121,15 @@ const LUA_REG_TYPE rpc_helper[] =
   { LNILKEY, LNILVAL }
 };
 
+const LUA_REG_TYPE rpc_future[] =
+{
+  { LSTRKEY( "__gc" ), LFUNCVAL( future_close ) },
+  { LNILKEY, LNILVAL }
+};
+
 const LUA_REG_TYPE rpc_server_handle[] =
 {
+  { LSTRKEY( "__gc" ), LFUNCVAL( server_handle_close ) },
   { LNILKEY, LNILVAL }
 };
 
@@ -1709,7 +2143,8 @@ const LUA_REG_TYPE rpc_map[] =
   {  LSTRKEY( "peek" ), LFUNCVAL( rpc_peek ) },
   {  LSTRKEY( "dispatch" ), LFUNCVAL( rpc_dispatch ) },
   {  LSTRKEY( "adispatch" ), LFUNCVAL( rpc_adispatch ) },
-//  {  LSTRKEY( "rpc_async" ), LFUNCVAL( rpc_async ) },
+  {  LSTRKEY( "wait" ), LFUNCVAL( rpc_wait ) },
+  {  LSTRKEY( "poll" ), LFUNCVAL( rpc_poll ) },
 #if LUA_OPTIMIZE_MEMORY > 0
 // {  LSTRKEY("mode"), LSTRVAL( LUARPC_MODE ) },
 #endif // #if LUA_OPTIMIZE_MEMORY > 0
@@ -1722,6 +2157,7 @@ LUALIB_API int luaopen_rpc(lua_State *L)
 #if LUA_OPTIMIZE_MEMORY > 0
   luaL_rometatable(L, "rpc.helper", (void*)rpc_helper);
   luaL_rometatable(L, "rpc.handle", (void*)rpc_handle);
+  luaL_rometatable(L, "rpc.future", (void*)rpc_future);
   luaL_rometatable(L, "rpc.server_handle", (void*)rpc_server_handle);
 #else
   luaL_register( L, "rpc", rpc_map );
@@ -1734,7 +2170,11 @@ LUALIB_API int luaopen_rpc(lua_State *L)
   luaL_newmetatable( L, "rpc.handle" );
   luaL_register( L, NULL, rpc_handle );
 
+  luaL_newmetatable( L, "rpc.future" );
+  luaL_register( L, NULL, rpc_future );
+
   luaL_newmetatable( L, "rpc.server_handle" );
+  luaL_register( L, NULL, rpc_server_handle );
 #endif
   return 1;
 }
@@ -1745,6 +2185,7 @@ static const luaL_reg rpc_handle[] =
 {
   { "__index", handle_index },
   { "__newindex", handle_newindex },
+  { "__gc", handle_close },
   { NULL, NULL }
 };
 
@@ -1757,8 +2198,15 @@ static const luaL_reg rpc_helper[] =
   { NULL, NULL }
 };
 
+static const luaL_reg rpc_future[] =
+{
+  { "__gc", future_close },
+  { NULL, NULL }
+};
+
 static const luaL_reg rpc_server_handle[] =
 {
+  { "__gc", server_handle_close },
   { NULL, NULL }
 };
 
@@ -1772,7 +2220,8 @@ static const luaL_reg rpc_map[] =
   { "peek", rpc_peek },
   { "dispatch", rpc_dispatch },
   { "adispatch", rpc_adispatch },
-//  { "rpc_async", rpc_async },
+  { "wait", rpc_wait },
+  { "poll", rpc_poll },
   { NULL, NULL }
 };
 
@@ -1789,7 +2238,11 @@ LUALIB_API int luaopen_rpc(lua_State *L)
   luaL_newmetatable( L, "rpc.handle" );
   luaL_register( L, NULL, rpc_handle );
 
+  luaL_newmetatable( L, "rpc.future" );
+  luaL_register( L, NULL, rpc_future );
+
   luaL_newmetatable( L, "rpc.server_handle" );
+  luaL_register( L, NULL, rpc_server_handle );
 
   return 1;
 }
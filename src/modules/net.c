@@ -222,6 +222,78 @@ static int net_lookup( lua_State* L )
   return 1;
 }
 
+// Lua: res = setblocking( sock, blocking )
+static int net_setblocking( lua_State *L )
+{
+  int sock = ( int )luaL_checkinteger( L, 1 );
+
+  luaL_checktype( L, 2, LUA_TBOOLEAN );
+  lua_pushinteger( L, elua_net_set_blocking( sock, lua_toboolean( L, 2 ) ) );
+  return 1;
+}
+
+// Helper for select: check the sockets in the table at 'idx' for the given 
+// readiness flag. If 'res' is not 0, add the ready sockets to the table at 'res'
+// Returns the number of ready sockets
+static int neth_select_check( lua_State *L, int idx, int flag, int res )
+{
+  int i, n, sock, ready, total = 0;
+
+  if( lua_isnoneornil( L, idx ) )
+    return 0;
+  n = lua_objlen( L, idx );
+  for( i = 1; i <= n; i ++ )
+  {
+    lua_rawgeti( L, idx, i );
+    sock = ( int )lua_tointeger( L, -1 );
+    lua_pop( L, 1 );
+    if( ( ready = elua_net_get_ready( sock ) ) == -1 )
+      return luaL_error( L, "socket %d is not in non-blocking mode", sock );
+    if( ready & flag )
+    {
+      total ++;
+      if( res )
+      {
+        lua_pushinteger( L, sock );
+        lua_rawseti( L, res, total );
+      }
+    }
+  }
+  return total;
+}
+
+// Lua: readable, writable = select( readset, writeset, [timer_id, timeout] )
+// Waits until at least one of the (non-blocking) sockets in readset/writeset
+// is ready or the timeout expires
+static int net_select( lua_State *L )
+{
+  unsigned timer_id = PLATFORM_TIMER_SYS_ID;
+  timer_data_type timeout = PLATFORM_TIMER_INF_TIMEOUT;
+  timer_data_type tmrstart = 0;
+
+  if( !lua_isnoneornil( L, 1 ) )
+    luaL_checktype( L, 1, LUA_TTABLE );
+  if( !lua_isnoneornil( L, 2 ) )
+    luaL_checktype( L, 2, LUA_TTABLE );
+  cmn_get_timeout_data( L, 3, &timer_id, &timeout );
+  lua_settop( L, 2 );
+  if( timeout > 0 && timeout != PLATFORM_TIMER_INF_TIMEOUT )
+    tmrstart = platform_timer_start( timer_id );
+  // Scan without creating anything until a socket is ready
+  while( neth_select_check( L, 1, ELUA_NET_READY_READ, 0 ) + neth_select_check( L, 2, ELUA_NET_READY_WRITE, 0 ) == 0 )
+  {
+    if( timeout == 0 )
+      break;
+    if( timeout != PLATFORM_TIMER_INF_TIMEOUT && platform_timer_get_diff_crt( timer_id, tmrstart ) >= timeout )
+      break;
+  }
+  lua_newtable( L );
+  neth_select_check( L, 1, ELUA_NET_READY_READ, 3 );
+  lua_newtable( L );
+  neth_select_check( L, 2, ELUA_NET_READY_WRITE, 4 );
+  return 2;
+}
+
 // Module function map
 #define MIN_OPT_LEVEL 2
 #include "lrodefs.h"
@@ -238,6 +310,8 @@ const LUA_REG_TYPE net_map[] =
   { LSTRKEY( "lookup" ), LFUNCVAL( net_lookup ) },
   { LSTRKEY( "listen" ), LFUNCVAL( net_listen ) }, // TH
   { LSTRKEY( "unlisten" ), LFUNCVAL( net_unlisten ) }, // TH
+  { LSTRKEY( "setblocking" ), LFUNCVAL( net_setblocking ) },
+  { LSTRKEY( "select" ), LFUNCVAL( net_select ) },
 #if LUA_OPTIMIZE_MEMORY > 0
   { LSTRKEY( "SOCK_STREAM" ), LNUMVAL( ELUA_NET_SOCK_STREAM ) },
   { LSTRKEY( "SOCK_DGRAM" ), LNUMVAL( ELUA_NET_SOCK_DGRAM ) },
@@ -248,6 +322,7 @@ const LUA_REG_TYPE net_map[] =
   { LSTRKEY( "ERR_OVERFLOW" ), LNUMVAL( ELUA_NET_ERR_OVERFLOW ) },
   { LSTRKEY( "ERR_LIMIT_EXCEEDED" ), LNUMVAL( ELUA_NET_ERR_LIMIT_EXCEEDED ) }, //TH
   { LSTRKEY( "ERR_WAIT_TIMEDOUT" ), LNUMVAL( ELUA_NET_ERR_WAIT_TIMEDOUT ) }, //TH
+  { LSTRKEY( "ERR_WOULDBLOCK" ), LNUMVAL( ELUA_NET_ERR_WOULDBLOCK ) },
 
   { LSTRKEY( "NO_TIMEOUT" ), LNUMVAL( 0 ) },
   { LSTRKEY( "INF_TIMEOUT" ), LNUMVAL( PLATFORM_TIMER_INF_TIMEOUT ) },
@@ -270,6 +345,7 @@ LUALIB_API int luaopen_net( lua_State *L )
   MOD_REG_NUMBER( L, "ERR_CLOSED", ELUA_NET_ERR_CLOSED );
   MOD_REG_NUMBER( L, "ERR_ABORTED", ELUA_NET_ERR_ABORTED );
   MOD_REG_NUMBER( L, "ERR_OVERFLOW", ELUA_NET_ERR_OVERFLOW );
+  MOD_REG_NUMBER( L, "ERR_WOULDBLOCK", ELUA_NET_ERR_WOULDBLOCK );
   MOD_REG_NUMBER( L, "NO_TIMEOUT", 0 );
   MOD_REG_NUMBER( L, "INF_TIMEOUT", PLATFORM_TIMER_INF_TIMEOUT );
 
@@ -0,0 +1,498 @@
+// Module for cooperative multitasking (coroutine scheduler)
+
+//#include "lua.h"
+#include "lualib.h"
+#include "lauxlib.h"
+#include "platform.h"
+#include "auxmods.h"
+#include "lrotable.h"
+#include "elua_int.h"
+#include "platform_conf.h"
+#include "buf.h"
+#ifdef BUILD_UIP
+#include "elua_net.h"
+#endif
+#include <string.h>
+
+// Every task is a coroutine that runs until it calls one of the 'wait'
+// functions below (sched.sleep, sched.wait_int ...), which yield back to
+// the scheduler (sched.run). The scheduler resumes a task when the event
+// it waits for happens. Interrupts are taken from the eLua interrupt queue
+// (see elua_int.c), timeouts use the system timer. When all the tasks are
+// waiting, the scheduler waits for events without running any Lua code and
+// lets the CPU sleep (platform_cpu_idle) until an interrupt or a timeout.
+
+// Maximum number of tasks
+#ifndef SCHED_MAX_TASKS
+#define SCHED_MAX_TASKS         16
+#endif
+
+// Task table key in the registry
+#define SCHED_TASKS_KEY         ( int )&sched_tasks
+
+// Task states
+enum
+{
+  SCHED_FREE,
+  SCHED_READY,
+  SCHED_SLEEP,
+  SCHED_WAIT_INT,
+  SCHED_WAIT_UART,
+  SCHED_WAIT_SOCKET
+};
+
+// Wait results
+enum
+{
+  SCHED_RES_PENDING,
+  SCHED_RES_OK,
+  SCHED_RES_TIMEOUT
+};
+
+// Resource number that matches any resource in sched.wait_int
+#define SCHED_ANY_RESNUM        0xFFFF
+
+typedef struct
+{
+  timer_data_type start;
+  timer_data_type timeout;
+  u16 res;                      // interrupt resnum, UART data, socket
+  u8 state;
+  u8 result;
+  u8 id;                        // interrupt ID, UART ID, socket readiness flag
+  u8 nargs;                     // number of arguments for the first resume
+} sched_task;
+
+static sched_task sched_tasks[ SCHED_MAX_TASKS ];
+static int sched_crt = -1;      // currently running task
+static lua_State *sched_crt_state;
+static int sched_running;       // 1 if sched.run is active
+#ifdef BUILD_LUA_INT_HANDLERS
+// Interrupts watched by the scheduler and interrupts received while no task
+// was waiting for them (they will end the next wait immediately)
+static u32 sched_int_watched[ LUA_INT_MAX_SOURCES / 32 ];
+static u32 sched_int_pending[ LUA_INT_MAX_SOURCES / 32 ];
+static elua_int_resnum sched_int_pending_res[ LUA_INT_MAX_SOURCES ];
+#endif
+
+#define SCHED_BIT_IS_SET( a, n )  ( ( a )[ ( n ) >> 5 ] & ( 1 << ( ( n ) & 0x1F ) ) )
+#define SCHED_BIT_SET( a, n )     ( a )[ ( n ) >> 5 ] |= 1 << ( ( n ) & 0x1F )
+#define SCHED_BIT_CLEAR( a, n )   ( a )[ ( n ) >> 5 ] &= ~( 1 << ( ( n ) & 0x1F ) )
+
+// ****************************************************************************
+// Helpers
+
+// Return the current task or raise an error if not called from a task
+// (a coroutine created by the task itself can't wait for events)
+static sched_task* schedh_get_crt( lua_State *L )
+{
+  if( sched_crt == -1 || L != sched_crt_state )
+    luaL_error( L, "this function can only be called from a scheduler task" );
+  return sched_tasks + sched_crt;
+}
+
+// Read the optional timeout (in microseconds) at 'idx'
+static void schedh_set_timeout( lua_State *L, sched_task *pt, int idx, int required )
+{
+  lua_Number tempn;
+
+  pt->timeout = PLATFORM_TIMER_INF_TIMEOUT;
+  if( required || !lua_isnoneornil( L, idx ) )
+  {
+    tempn = luaL_checknumber( L, idx );
+    if( tempn < 0 || tempn >= PLATFORM_TIMER_INF_TIMEOUT )
+      luaL_error( L, "invalid timeout value" );
+    pt->timeout = ( timer_data_type )tempn;
+  }
+  if( pt->timeout != PLATFORM_TIMER_INF_TIMEOUT )
+  {
+    if( !platform_timer_sys_available() )
+      luaL_error( L, "the system timer is not implemented on this platform" );
+    pt->start = platform_timer_read_sys();
+  }
+}
+
+// Suspend the current task until the event in 'pt' happens
+static int schedh_wait( lua_State *L, sched_task *pt, int state )
+{
+  pt->state = state;
+  pt->result = SCHED_RES_PENDING;
+  return lua_yield( L, 0 );
+}
+
+#ifdef BUILD_LUA_INT_HANDLERS
+// Interrupt notification (called from the eLua interrupt hook)
+static void schedh_int_notify( elua_int_id id, elua_int_resnum resnum )
+{
+  unsigned i;
+  int found = 0;
+
+  if( !SCHED_BIT_IS_SET( sched_int_watched, id ) )
+    return;
+  for( i = 0; i < SCHED_MAX_TASKS; i ++ )
+    if( sched_tasks[ i ].state == SCHED_WAIT_INT && sched_tasks[ i ].result == SCHED_RES_PENDING &&
+        sched_tasks[ i ].id == id && ( sched_tasks[ i ].res == SCHED_ANY_RESNUM || sched_tasks[ i ].res == resnum ) )
+    {
+      sched_tasks[ i ].res = resnum;
+      sched_tasks[ i ].result = SCHED_RES_OK;
+      found = 1;
+    }
+  if( !found )
+  {
+    SCHED_BIT_SET( sched_int_pending, id );
+    sched_int_pending_res[ id ] = resnum;
+  }
+}
+#endif // #ifdef BUILD_LUA_INT_HANDLERS
+
+// Check if the event that task 'pt' waits for happened
+// Returns 1 if the task can be resumed, 0 otherwise
+static int schedh_check( sched_task *pt )
+{
+  int data;
+
+  if( pt->state == SCHED_READY || pt->result != SCHED_RES_PENDING )
+    return 1;
+  switch( pt->state )
+  {
+#if NUM_UART > 0
+    case SCHED_WAIT_UART:
+      if( ( data = platform_uart_recv( pt->id, PLATFORM_TIMER_SYS_ID, 0 ) ) != -1 )
+      {
+        pt->res = ( u16 )data;
+        pt->result = SCHED_RES_OK;
+        return 1;
+      }
+      break;
+#endif
+
+#ifdef BUILD_UIP
+    case SCHED_WAIT_SOCKET:
+      if( ( data = elua_net_get_ready( pt->res ) ) == -1 || ( data & pt->id ) )
+      {
+        pt->result = SCHED_RES_OK;
+        return 1;
+      }
+      break;
+#endif
+  }
+  if( pt->timeout != PLATFORM_TIMER_INF_TIMEOUT &&
+      platform_timer_get_diff_crt( PLATFORM_TIMER_SYS_ID, pt->start ) >= pt->timeout )
+  {
+    pt->result = pt->state == SCHED_SLEEP ? SCHED_RES_OK : SCHED_RES_TIMEOUT;
+    return 1;
+  }
+  ( void )data;
+  return 0;
+}
+
+// Return how long the CPU can sleep when no task could run: until the first
+// timeout expires (PLATFORM_TIMER_INF_TIMEOUT if there's none) or 0 if an
+// event is already pending. Tasks that wait for data on an unbuffered UART
+// must be polled, so the CPU doesn't sleep in this case.
+static timer_data_type schedh_idle_time( void )
+{
+  timer_data_type wait = PLATFORM_TIMER_INF_TIMEOUT, elapsed;
+  sched_task *pt;
+  unsigned i;
+
+  // Interrupts waiting in the eLua queue set a hook
+  if( lua_gethookmask( lua_getstate() ) != 0 )
+    return 0;
+  for( i = 0; i < SCHED_MAX_TASKS; i ++ )
+  {
+    pt = sched_tasks + i;
+    if( pt->state == SCHED_FREE )
+      continue;
+    if( pt->state == SCHED_READY || pt->result != SCHED_RES_PENDING )
+      return 0;
+#if NUM_UART > 0
+    if( pt->state == SCHED_WAIT_UART &&
+        ( !buf_is_enabled( BUF_ID_UART, pt->id ) || buf_get_count( BUF_ID_UART, pt->id ) > 0 ) )
+      return 0;
+#endif
+    if( pt->timeout != PLATFORM_TIMER_INF_TIMEOUT )
+    {
+      elapsed = platform_timer_get_diff_crt( PLATFORM_TIMER_SYS_ID, pt->start );
+      if( elapsed >= pt->timeout )
+        return 0;
+      if( pt->timeout - elapsed < wait )
+        wait = pt->timeout - elapsed;
+    }
+  }
+  return wait;
+}
+
+// Let the CPU sleep until an interrupt happens or until the first timeout
+static void schedh_idle( void )
+{
+  timer_data_type wait;
+  int old_status;
+
+  // An interrupt that happens after the checks wakes the CPU up
+  old_status = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  if( ( wait = schedh_idle_time() ) > 0 )
+    platform_cpu_idle( wait );
+  platform_cpu_set_global_interrupts( old_status );
+}
+
+// Push the results of the wait of task 'pt' on the stack of 'co'
+// Returns the number of results
+static int schedh_push_results( lua_State *co, sched_task *pt )
+{
+  int state = pt->state;
+  char c;
+
+  pt->state = SCHED_READY;
+  if( state == SCHED_READY || state == SCHED_SLEEP )
+    return 0;
+  if( pt->result == SCHED_RES_TIMEOUT )
+  {
+    lua_pushnil( co );
+    return 1;
+  }
+  switch( state )
+  {
+    case SCHED_WAIT_INT:
+      lua_pushinteger( co, pt->res );
+      break;
+
+    case SCHED_WAIT_UART:
+      c = ( char )pt->res;
+      lua_pushlstring( co, &c, 1 );
+      break;
+
+    default:
+      lua_pushboolean( co, 1 );
+      break;
+  }
+  return 1;
+}
+
+// ****************************************************************************
+// Lua functions
+
+// Lua: co = spawn( f, [arg1], [arg2], ... )
+static int sched_spawn( lua_State *L )
+{
+  unsigned i;
+  int nargs = lua_gettop( L ) - 1;
+  lua_State *co;
+
+  if( lua_type( L, 1 ) != LUA_TFUNCTION && lua_type( L, 1 ) != LUA_TLIGHTFUNCTION )
+    return luaL_typerror( L, 1, "function" );
+  if( nargs > 255 )
+    return luaL_error( L, "too many arguments" );
+  for( i = 0; i < SCHED_MAX_TASKS; i ++ )
+    if( sched_tasks[ i ].state == SCHED_FREE )
+      break;
+  if( i == SCHED_MAX_TASKS )
+    return luaL_error( L, "too many tasks" );
+  lua_rawgeti( L, LUA_REGISTRYINDEX, SCHED_TASKS_KEY );
+  co = lua_newthread( L );
+  lua_pushvalue( L, -1 );
+  lua_rawseti( L, -3, i + 1 );
+  lua_insert( L, 1 );
+  lua_pop( L, 1 );
+  lua_xmove( L, co, nargs + 1 );
+  memset( sched_tasks + i, 0, sizeof( sched_task ) );
+  sched_tasks[ i ].state = SCHED_READY;
+  sched_tasks[ i ].nargs = nargs;
+  return 1;
+}
+
+// Lua: run()
+// Runs the tasks until all of them finish
+static int sched_run( lua_State *L )
+{
+  unsigned i, ntasks, nrun;
+  int nres, res;
+  lua_State *co;
+
+  if( sched_running )
+    return luaL_error( L, "scheduler already running" );
+  lua_settop( L, 0 );
+  lua_rawgeti( L, LUA_REGISTRYINDEX, SCHED_TASKS_KEY );
+  sched_running = 1;
+  while( 1 )
+  {
+    elua_int_poll( L );
+    for( i = ntasks = nrun = 0; i < SCHED_MAX_TASKS; i ++ )
+    {
+      if( sched_tasks[ i ].state == SCHED_FREE )
+        continue;
+      ntasks ++;
+      if( !schedh_check( sched_tasks + i ) )
+        continue;
+      nrun ++;
+      lua_rawgeti( L, 1, i + 1 );
+      co = lua_tothread( L, -1 );
+      if( lua_status( co ) == 0 ) // first run, the arguments are already on the stack
+      {
+        nres = sched_tasks[ i ].nargs;
+        sched_tasks[ i ].state = SCHED_READY;
+      }
+      else
+        nres = schedh_push_results( co, sched_tasks + i );
+      sched_crt = i;
+      sched_crt_state = co;
+      res = lua_resume( co, nres );
+      sched_crt = -1;
+      sched_crt_state = NULL;
+      if( res != LUA_YIELD )
+      {
+        // The task finished (or raised an error)
+        sched_tasks[ i ].state = SCHED_FREE;
+        lua_pushnil( L );
+        lua_rawseti( L, 1, i + 1 );
+        if( res != 0 )
+        {
+          sched_running = 0;
+          lua_xmove( co, L, 1 );
+          return lua_error( L );
+        }
+      }
+      else
+        lua_settop( co, 0 );
+      lua_pop( L, 1 );
+      elua_int_poll( L );
+    }
+    if( ntasks == 0 )
+      break;
+    if( nrun == 0 )
+      schedh_idle();
+  }
+  sched_running = 0;
+  return 0;
+}
+
+// Lua: yield()
+// Lets the other tasks run
+static int sched_yield( lua_State *L )
+{
+  return schedh_wait( L, schedh_get_crt( L ), SCHED_READY );
+}
+
+// Lua: sleep( us )
+static int sched_sleep( lua_State *L )
+{
+  sched_task *pt = schedh_get_crt( L );
+
+  schedh_set_timeout( L, pt, 1, 1 );
+  return schedh_wait( L, pt, SCHED_SLEEP );
+}
+
+#ifdef BUILD_LUA_INT_HANDLERS
+// Lua: resnum = wait_int( id, [resnum], [timeout] )
+// Returns the resource number of the interrupt or nil on timeout
+static int sched_wait_int( lua_State *L )
+{
+  sched_task *pt = schedh_get_crt( L );
+  elua_int_id id = ( elua_int_id )luaL_checkinteger( L, 1 );
+  unsigned resnum = ( unsigned )luaL_optinteger( L, 2, SCHED_ANY_RESNUM );
+
+  if( id < ELUA_INT_FIRST_ID || id > INT_ELUA_LAST )
+    return luaL_error( L, "invalid interrupt ID" );
+  schedh_set_timeout( L, pt, 3, 0 );
+  // Start watching this interrupt (the interrupt must be enabled in eLua,
+  // otherwise elua_int_add ignores it)
+  if( !SCHED_BIT_IS_SET( sched_int_watched, id ) )
+  {
+    SCHED_BIT_SET( sched_int_watched, id );
+    elua_int_enable( id );
+  }
+  pt->id = id;
+  pt->res = resnum;
+  if( SCHED_BIT_IS_SET( sched_int_pending, id ) && ( resnum == SCHED_ANY_RESNUM || resnum == sched_int_pending_res[ id ] ) )
+  {
+    SCHED_BIT_CLEAR( sched_int_pending, id );
+    lua_pushinteger( L, sched_int_pending_res[ id ] );
+    return 1;
+  }
+  return schedh_wait( L, pt, SCHED_WAIT_INT );
+}
+#endif // #ifdef BUILD_LUA_INT_HANDLERS
+
+#if NUM_UART > 0
+// Lua: data = wait_uart( id, [timeout] )
+// Returns the received character or nil on timeout
+static int sched_wait_uart( lua_State *L )
+{
+  sched_task *pt = schedh_get_crt( L );
+  unsigned id = luaL_checkinteger( L, 1 );
+
+  MOD_CHECK_ID( uart, id );
+  schedh_set_timeout( L, pt, 2, 0 );
+  pt->id = id;
+  return schedh_wait( L, pt, SCHED_WAIT_UART );
+}
+#endif // #if NUM_UART > 0
+
+#ifdef BUILD_UIP
+// Lua: res = wait_socket( sock, mode, [timeout] )
+// 'mode' is "r" (wait until readable) or "w" (wait until writable)
+// Returns true or nil on timeout
+static int sched_wait_socket( lua_State *L )
+{
+  sched_task *pt = schedh_get_crt( L );
+  int sock = ( int )luaL_checkinteger( L, 1 );
+  const char *mode = luaL_checkstring( L, 2 );
+
+  if( elua_net_get_ready( sock ) == -1 )
+    return luaL_error( L, "socket %d is not in non-blocking mode", sock );
+  if( !strcmp( mode, "r" ) )
+    pt->id = ELUA_NET_READY_READ;
+  else if( !strcmp( mode, "w" ) )
+    pt->id = ELUA_NET_READY_WRITE;
+  else
+    return luaL_error( L, "invalid mode" );
+  schedh_set_timeout( L, pt, 3, 0 );
+  pt->res = ( u16 )sock;
+  return schedh_wait( L, pt, SCHED_WAIT_SOCKET );
+}
+#endif // #ifdef BUILD_UIP
+
+// Module function map
+#define MIN_OPT_LEVEL 2
+#include "lrodefs.h"
+const LUA_REG_TYPE sched_map[] =
+{
+  { LSTRKEY( "spawn" ), LFUNCVAL( sched_spawn ) },
+  { LSTRKEY( "run" ), LFUNCVAL( sched_run ) },
+  { LSTRKEY( "yield" ), LFUNCVAL( sched_yield ) },
+  { LSTRKEY( "sleep" ), LFUNCVAL( sched_sleep ) },
+#ifdef BUILD_LUA_INT_HANDLERS
+  { LSTRKEY( "wait_int" ), LFUNCVAL( sched_wait_int ) },
+#endif
+#if NUM_UART > 0
+  { LSTRKEY( "wait_uart" ), LFUNCVAL( sched_wait_uart ) },
+#endif
+#ifdef BUILD_UIP
+  { LSTRKEY( "wait_socket" ), LFUNCVAL( sched_wait_socket ) },
+#endif
+  { LNILKEY, LNILVAL }
+};
+
+LUALIB_API int luaopen_sched( lua_State *L )
+{
+  // Create the task table and reset the scheduler state
+  lua_newtable( L );
+  lua_rawseti( L, LUA_REGISTRYINDEX, SCHED_TASKS_KEY );
+  memset( sched_tasks, 0, sizeof( sched_tasks ) );
+  sched_crt = -1;
+  sched_crt_state = NULL;
+  sched_running = 0;
+#ifdef BUILD_LUA_INT_HANDLERS
+  memset( sched_int_watched, 0, sizeof( sched_int_watched ) );
+  memset( sched_int_pending, 0, sizeof( sched_int_pending ) );
+  elua_int_set_notify( schedh_int_notify );
+#endif
+
+#if LUA_OPTIMIZE_MEMORY > 0
+  return 0;
+#else // #if LUA_OPTIMIZE_MEMORY > 0
+  luaL_register( L, AUXLIB_SCHED, sched_map );
+  return 1;
+#endif // #if LUA_OPTIMIZE_MEMORY > 0
+}
+
@@ -13,6 +13,9 @@
 
 static DM_INSTANCE_DATA dm_list[ DM_MAX_DEVICES ];            // list of devices
 static int dm_num_devs;                                       // number of devices
+static u32 dm_gen_list[ DM_MAX_DEVICES ];                     // generation of each device
+static u32 dm_crt_gen = 1;                                    // generation counter
+static u32 dm_mount_gen = 1;                                  // generation of the last (un)registration
 
 // "Shared" variables: these can be used by any FS that implements 'ls' via opendir/readdir/closedir
 struct dm_dirent dm_shared_dirent;
@@ -44,6 +47,7 @@ int dm_register( const char *name, void *pdata, const DM_DEVICE *pdev )
   dm_list[ i ].name = name;
   dm_list[ i ].pdata = pdata;
   dm_list[ i ].pdev = pdev;
+  dm_gen_list[ i ] = dm_mount_gen = ++ dm_crt_gen;
   dm_num_devs ++;
   return i;
 }
@@ -88,8 +92,12 @@ int dm_unregister( const char* name )
   
   // Remove it
   if( i != dm_num_devs - 1 )
+  {
     memmove( dm_list + i, dm_list + i + 1, sizeof( DM_INSTANCE_DATA ) * ( dm_num_devs - i - 1 ) );
+    memmove( dm_gen_list + i, dm_gen_list + i + 1, sizeof( u32 ) * ( dm_num_devs - i - 1 ) );
+  }
   dm_num_devs --;
+  dm_mount_gen = ++ dm_crt_gen;
   return DM_OK;
 }
 
@@ -115,6 +123,46 @@ int dm_get_num_devices(void)
   return dm_num_devs;
 }
 
+// Mark the content of a device as changed
+void dm_set_changed( int idx )
+{
+  if( idx >= 0 && idx < dm_num_devs )
+    dm_gen_list[ idx ] = ++ dm_crt_gen;
+}
+
+// Called after a file was opened on a device
+void dm_notify_open( int idx, int flags )
+{
+  if( flags & O_CREAT )
+    dm_set_changed( idx );
+}
+
+// Get the generation of the device that contains 'path'
+// The device is found using the same rules as 'open' (see stubs.c)
+u32 dm_get_generation( const char *path )
+{
+  const char *p;
+  unsigned len;
+  int i;
+
+  if( path == NULL || *path != '/' )
+    return dm_mount_gen;
+  if( ( p = strchr( path + 1, '/' ) ) == NULL )
+    len = 1;
+  else if( ( len = p - path ) > DM_MAX_DEV_NAME )
+    return dm_mount_gen;
+  for( i = 0; i < dm_num_devs; i ++ )
+    if( strlen( dm_list[ i ].name ) == len && !strncasecmp( path, dm_list[ i ].name, len ) )
+      return dm_gen_list[ i ];
+  return dm_mount_gen;
+}
+
+// Get the current value of the generation counter
+u32 dm_get_current_generation(void)
+{
+  return dm_crt_gen;
+}
+
 // Initialize device manager
 // This initializes the standard descriptors (stdin, stdout, stderr)
 // At this point it is assumed that the std device (usually UART) is already initialized
@@ -213,3 +261,24 @@ const char* dm_getaddr( int fd )
   return pinst->pdev->p_getaddr_r( _REENT, DM_GET_FD( fd ), pinst->pdata );
 }
 
+// Map (at most) '*plen' bytes of the file starting at offset 'off' directly
+// in the CPU address space. On success '*plen' is updated with the actual
+// number of mapped bytes (smaller if the end of the file was reached). The
+// mapped data stays valid and unchanged for the lifetime of the firmware and
+// it is always followed by a 0 byte if it extends to the end of the file.
+// The file offset is not changed.
+const char* dm_map( int fd, off_t off, size_t *plen )
+{
+  const DM_INSTANCE_DATA *pinst;
+
+  // Find device, check map function
+  pinst = dm_get_instance_at( DM_GET_DEVID( fd ) );
+  if( !pinst || pinst->pdev->p_map_r == NULL )
+  {
+    _REENT->_errno = ENOSYS;
+    return NULL;
+  }
+
+  return pinst->pdev->p_map_r( _REENT, DM_GET_FD( fd ), off, plen, pinst->pdata );
+}
+
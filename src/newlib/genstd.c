@@ -9,12 +9,138 @@
 #include <stdio.h>
 #include <errno.h>
 #include <ctype.h>
+#include <string.h>
 #include "utils.h"
 
 static p_std_send_char std_send_char_func;
 static p_std_get_char std_get_char_func;
 int std_prev_char = -1;
 
+// ****************************************************************************
+// Console output buffer
+// The data written to stdout is added to a circular buffer and sent later,
+// either by the platform (std_tx_start_func starts the transmission and the
+// platform gets the data with std_tx_get_char, usually from an interrupt
+// handler) or by std_flush itself if there's no std_tx_start_func. The read
+// and write pointers are free running and each one is changed by a single
+// side, so no locking is needed.
+
+#if STD_TX_BUF_SIZE > 0
+
+#if ( STD_TX_BUF_SIZE & ( STD_TX_BUF_SIZE - 1 ) ) != 0 || STD_TX_BUF_SIZE > 32768
+#error "STD_TX_BUF_SIZE must be a power of 2 not larger than 32768"
+#endif
+
+static char std_tx_buf[ STD_TX_BUF_SIZE ];
+static volatile u16 std_tx_wptr, std_tx_rptr;
+static p_std_tx_start std_tx_start_func;
+static int std_buf_mode = STD_BUF_NONE;
+
+#define STD_TX_COUNT          ( ( u16 )( std_tx_wptr - std_tx_rptr ) )
+
+// Get the next character to send from the output buffer (-1 if empty)
+int std_tx_get_char()
+{
+  int c;
+
+  if( std_tx_rptr == std_tx_wptr )
+    return -1;
+  c = ( u8 )std_tx_buf[ std_tx_rptr & ( STD_TX_BUF_SIZE - 1 ) ];
+  std_tx_rptr ++;
+  return c;
+}
+
+// Start sending the data in the output buffer
+static void stdh_tx_start()
+{
+  int c;
+
+  // If the platform can't send the data in the background or if the
+  // interrupts are disabled, send everything now
+  if( std_tx_start_func == NULL || !platform_cpu_get_global_interrupts() )
+  {
+    while( ( c = std_tx_get_char() ) != -1 )
+      std_send_char_func( DM_STDOUT_NUM, c );
+  }
+  else
+    std_tx_start_func();
+}
+
+// Add a character to the output buffer, waiting for room if needed
+static void stdh_tx_put( char c )
+{
+  if( STD_TX_COUNT == STD_TX_BUF_SIZE )
+  {
+    stdh_tx_start();
+    while( STD_TX_COUNT == STD_TX_BUF_SIZE )
+      if( !platform_cpu_get_global_interrupts() )
+        stdh_tx_start();
+  }
+  std_tx_buf[ std_tx_wptr & ( STD_TX_BUF_SIZE - 1 ) ] = c;
+  std_tx_wptr ++;
+}
+
+void std_flush()
+{
+  if( STD_TX_COUNT == 0 )
+    return;
+  stdh_tx_start();
+  while( STD_TX_COUNT > 0 )
+    if( !platform_cpu_get_global_interrupts() )
+      stdh_tx_start();
+}
+
+int std_set_buffer_mode( int mode )
+{
+  if( mode < STD_BUF_NONE || mode > STD_BUF_FULL )
+    return PLATFORM_ERR;
+  std_flush();
+  std_buf_mode = mode;
+  return PLATFORM_OK;
+}
+
+int std_get_buffer_mode()
+{
+  return std_buf_mode;
+}
+
+void std_set_tx_start_func( p_std_tx_start pfunc )
+{
+  std_tx_start_func = pfunc;
+}
+
+#else // #if STD_TX_BUF_SIZE > 0
+
+#define std_buf_mode          STD_BUF_NONE
+
+int std_tx_get_char()
+{
+  return -1;
+}
+
+void std_flush()
+{
+}
+
+int std_set_buffer_mode( int mode )
+{
+  return mode == STD_BUF_NONE ? PLATFORM_OK : PLATFORM_ERR;
+}
+
+int std_get_buffer_mode()
+{
+  return STD_BUF_NONE;
+}
+
+void std_set_tx_start_func( p_std_tx_start pfunc )
+{
+}
+
+#endif // #if STD_TX_BUF_SIZE > 0
+
+// ****************************************************************************
+// Device functions
+
 // 'read'
 static _ssize_t std_read( struct _reent *r, int fd, void* vptr, size_t len, void *pdata )
 {
@@ -39,7 +165,9 @@ static _ssize_t std_read( struct _reent *r, int fd, void* vptr, size_t len, void
     r->_errno = EINVAL;
     return -1;
   }      
-  
+
+  // Send the pending output before echoing the input
+  std_flush();
   i = 0;
   while( i < len )
   {  
@@ -111,6 +239,22 @@ static _ssize_t std_write( struct _reent *r, int fd, const void* vptr, size_t le
     return -1;
   }  
   
+#if STD_TX_BUF_SIZE > 0
+  // stderr is never buffered
+  if( std_buf_mode != STD_BUF_NONE && fd == DM_STDOUT_NUM )
+  {
+    for( i = 0; i < len; i ++ )
+    {
+      if( ptr[ i ] == '\n' )
+        stdh_tx_put( '\r' );
+      stdh_tx_put( ptr[ i ] );
+    }
+    if( std_buf_mode == STD_BUF_LINE && memchr( ptr, '\n', len ) != NULL )
+      stdh_tx_start();
+    return len;
+  }
+  std_flush();
+#endif // #if STD_TX_BUF_SIZE > 0
   for( i = 0; i < len; i ++ ) 
   {
     if( ptr[ i ] == '\n' )
@@ -146,7 +290,8 @@ static const DM_DEVICE std_device =
   NULL,                 // mkdir
   NULL,                 // unlink
   NULL,                 // rmdir
-  NULL                  // rename
+  NULL,                 // rename
+  NULL                  // map
 };
 
 int std_register()
@@ -97,7 +97,8 @@ static const DM_DEVICE std_device =
   NULL,                 // mkdir
   NULL,                 // unlink
   NULL,                 // rmdir
-  NULL                  // rename
+  NULL,                 // rename
+  NULL                  // map
 };
 
 
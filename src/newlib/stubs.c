@@ -98,6 +98,7 @@ int _open_r( struct _reent *r, const char *name, int flags, int mode )
   // Device found, call its function
   if( ( res = pinst->pdev->p_open_r( r, actname, flags, mode, pinst->pdata ) ) < 0 )
     return res;
+  dm_notify_open( devid, flags );
   return DM_MAKE_DESC( devid, res );
 }
 
@@ -228,6 +229,7 @@ int _mkdir_r( struct _reent *r, const char *path, mkdir_mode_t mode )
   }
 
   // Device found, call its function
+  dm_set_changed( devid );
   return pinst->pdev->p_mkdir_r( r, actname - 1, mode, pinst->pdata );
 }
 
@@ -258,6 +260,7 @@ int _unlink_r( struct _reent *r, const char *fname )
   }
 
   // Device found, call its function
+  dm_set_changed( devid );
   return pinst->pdev->p_unlink_r( r, actname, pinst->pdata );
 }
 
@@ -289,6 +292,7 @@ int rmdir( const char *path )
   }
 
   // Device found, call its function
+  dm_set_changed( devid );
   return pinst->pdev->p_rmdir_r( _REENT, actname, pinst->pdata );
 }
 
@@ -322,6 +326,7 @@ int _rename_r( struct _reent *r, const char *oldname, const char *newname )
     }
 
     // Device found, call its function
+    dm_set_changed( devid_old );
     return pinst->pdev->p_rename_r( r, actname_old, actname_new, pinst->pdata );
   }
   // Cannot rename between different devices (EXDEV)
@@ -139,6 +139,11 @@ typedef unsigned short uip_stats_t;
 //
 #define UIP_CONF_BYTE_ORDER         UIP_BIG_ENDIAN
 
+//
+// Use the word-at-a-time checksum functions from elua_chksum.c
+//
+#define UIP_ARCH_CHKSUM             1
+
 //
 // Here we include the header file for the application we are using in
 // this example
@@ -48,7 +48,8 @@
   _C( INT_UART_RX ),\
   _C( INT_GPIO_POSEDGE ),\
   _C( INT_GPIO_NEGEDGE ),\
-  _C( INT_TMR_MATCH ),
+  _C( INT_TMR_MATCH ),\
+  _C( INT_ADC_READY ),
 
 #endif // #ifndef __CPU_LM3S8962_H__
 
@@ -374,7 +374,7 @@ int platform_can_send( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data
   return PLATFORM_OK;
 }
 
-int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
+int platform_s_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
 {
   // wait for a message
   if( can_rx_flag != 0 )
@@ -893,6 +893,9 @@ void ADCIntHandler( void )
     }
 #endif
 
+    // Let Lua know if enough samples are waiting in the buffer
+    adc_check_notify( s->id );
+
     // If we have the number of requested samples, stop sampling
     if ( adc_samples_available( s->id ) >= s->reqsamples && s->freerunning == 0 )
       platform_adc_stop( s->id );
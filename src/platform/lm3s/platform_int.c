@@ -7,6 +7,7 @@
 #include "platform.h"
 #include "elua_int.h"
 #include "common.h"
+#include "elua_adc.h"
 
 // Platform includes
 #if defined( FORLM3S9B92 )
@@ -416,7 +417,12 @@ const elua_int_descriptor elua_int_table[ INT_ELUA_LAST ] =
   { int_uart_rx_set_status, int_uart_rx_get_status, int_uart_rx_get_flag },
   { int_gpio_posedge_set_status, int_gpio_posedge_get_status, int_gpio_posedge_get_flag },
   { int_gpio_negedge_set_status, int_gpio_negedge_get_status, int_gpio_negedge_get_flag },
-  { int_tmr_match_set_status, int_tmr_match_get_status, int_tmr_match_get_flag }
+  { int_tmr_match_set_status, int_tmr_match_get_status, int_tmr_match_get_flag },
+#ifdef BUILD_ADC
+  { adc_int_ready_set_status, adc_int_ready_get_status, adc_int_ready_get_flag }
+#else
+  { NULL, NULL, NULL }
+#endif
 };
 
 #else // #if defined( BUILD_C_INT_HANDLERS ) || defined( BUILD_LUA_INT_HANDLERS )
@@ -10,7 +10,8 @@
 #define INT_GPIO_POSEDGE      ( ELUA_INT_FIRST_ID + 1 )
 #define INT_GPIO_NEGEDGE      ( ELUA_INT_FIRST_ID + 2 )
 #define INT_TMR_MATCH         ( ELUA_INT_FIRST_ID + 3 )
-#define INT_ELUA_LAST         INT_TMR_MATCH
+#define INT_ADC_READY         ( ELUA_INT_FIRST_ID + 4 )
+#define INT_ELUA_LAST         INT_ADC_READY
 
 #endif // #ifndef __PLATFORM_INTS_H__
 
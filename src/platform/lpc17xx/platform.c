@@ -839,7 +839,7 @@ int platform_can_send( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data
   return PLATFORM_OK;
 }
 
-int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
+int platform_s_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
 {
   // wait for a message
   if( can_rx_flag[id] != 0 )
@@ -3,11 +3,13 @@
 #ifndef __CPU_LINUX_H__
 #define __CPU_LINUX_H__
 
+#include "platform_ints.h"
+
 // Number of resources (0 if not available/not implemented)
 #define NUM_PIO               0
 #define NUM_SPI               0
 #define NUM_UART              0
-#define NUM_TIMER             0
+#define NUM_TIMER             4
 #define NUM_PWM               0
 #define NUM_ADC               0
 #define NUM_CAN               0
@@ -33,5 +35,8 @@ extern void *memory_end_address;
 #define INTERNAL_RAM1_FIRST_FREE ( void* )memory_start_address
 #define INTERNAL_RAM1_LAST_FREE  ( void* )memory_end_address
 
+#define PLATFORM_CPU_CONSTANTS_INTS\
+ _C( INT_TMR_MATCH ),
+
 #endif
 
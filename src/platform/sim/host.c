@@ -8,6 +8,11 @@
 #define __NR_close            6
 #define __NR_gettimeofday     78
 #define __NR_lseek            19
+#define __NR_clock_gettime    265
+#define __NR_nanosleep        162
+#define __NR_setitimer        104
+#define __NR_rt_sigaction     174
+#define __NR_rt_sigprocmask   175
 
 int host_errno = 0;
 
@@ -51,6 +56,17 @@ __asm__ volatile ("int $0x80" \
 __syscall_return(type,__res); \
 }
 
+#define _syscall4(type,name,type1,arg1,type2,arg2,type3,arg3,type4,arg4) \
+type host_##name(type1 arg1,type2 arg2,type3 arg3,type4 arg4) \
+{ \
+long __res; \
+__asm__ volatile ("int $0x80" \
+        : "=a" (__res) \
+        : "0" (__NR_##name),"b" ((long)(arg1)),"c" ((long)(arg2)), \
+                  "d" ((long)(arg3)),"S" ((long)(arg4))); \
+__syscall_return(type,__res); \
+}
+
 #define _syscall6(type,name,type1,arg1,type2,arg2,type3,arg3,type4,arg4, \
           type5,arg5,type6,arg6) \
 type host_##name (type1 arg1,type2 arg2,type3 arg3,type4 arg4,type5 arg5,type6 arg6) \
@@ -72,4 +88,9 @@ _syscall1(void, exit, int, status);
 _syscall1(int, close, int, status);
 _syscall2(int, gettimeofday, struct timeval*, tv, struct timezone*, tz);
 _syscall3(long, lseek, int, fd, long, offset, int, whence );
+_syscall2(int, clock_gettime, int, clk_id, struct host_timespec*, tp);
+_syscall2(int, nanosleep, const struct host_timespec*, req, struct host_timespec*, rem);
+_syscall3(int, setitimer, int, which, const struct host_itimerval*, value, struct host_itimerval*, ovalue);
+_syscall4(int, rt_sigaction, int, sig, const struct host_sigaction*, act, struct host_sigaction*, oact, size_t, sigsetsize);
+_syscall4(int, rt_sigprocmask, int, how, const unsigned long*, set, unsigned long*, oset, size_t, sigsetsize);
 
@@ -31,9 +31,46 @@ long host_lseek( int fd, long pos, int whence );
 
 #define MAP_FAILED (void *)(-1)
 
+// Kernel (i386) structures and constants for the time and signal functions
+struct host_timespec
+{
+  long tv_sec;
+  long tv_nsec;
+};
+
+struct host_itimerval
+{
+  struct timeval it_interval;
+  struct timeval it_value;
+};
+
+struct host_sigaction
+{
+  void ( *handler )( int );
+  unsigned long flags;
+  void ( *restorer )( void );
+  unsigned long mask[ 2 ];
+};
+
+#define HOST_CLOCK_MONOTONIC  1
+#define HOST_ITIMER_REAL      0
+#define HOST_SIGALRM          14
+#define HOST_SA_RESTART       0x10000000
+#define HOST_SA_RESTORER      0x04000000
+#define HOST_SIG_BLOCK        0
+#define HOST_SIG_UNBLOCK      1
+#define HOST_EINTR            4
+
 void *host_mmap2(void *addr, size_t length, int prot, int flags, int fd, off_t pgoffset);
 int host_gettimeofday( struct timeval *tv, struct timezone *tz );
 void host_exit(int status);
+int host_clock_gettime( int clk_id, struct host_timespec *tp );
+int host_nanosleep( const struct host_timespec *req, struct host_timespec *rem );
+int host_setitimer( int which, const struct host_itimerval *value, struct host_itimerval *ovalue );
+int host_rt_sigaction( int sig, const struct host_sigaction *act, struct host_sigaction *oact, size_t sigsetsize );
+int host_rt_sigprocmask( int how, const unsigned long *set, unsigned long *oset, size_t sigsetsize );
+// Signal return trampoline (utils.s)
+void host_sigreturn( void );
 
 #endif // _HOST_H
 
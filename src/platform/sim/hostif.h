@@ -38,5 +38,23 @@ long hostif_lseek( int fd, long pos, int whence );
 // Get time
 s64 hostif_gettime();
 
+// Get the time of the host's monotonic clock in nanoseconds
+u64 hostif_gettime_ns();
+
+// Sleep for the given number of nanoseconds
+void hostif_sleep_ns( u64 ns );
+
+// Set the timer "interrupt" handler (called from a host signal)
+int hostif_set_timer_handler( void ( *phandler )( void ) );
+
+// Fire the timer handler once after the given number of nanoseconds (0 to stop)
+void hostif_set_timer( u64 ns );
+
+// Enable/disable the timer handler, returns the previous state (1 for enabled)
+int hostif_set_timer_int( int enable );
+
+// Returns 1 if the timer handler is enabled, 0 otherwise
+int hostif_get_timer_int();
+
 #endif // __HOSTIO_H__
 
@@ -78,3 +78,70 @@ s64 hostif_gettime()
   return ( s64 )tv.tv_sec * 1000000 + tv.tv_usec;
 }
 
+u64 hostif_gettime_ns()
+{
+  struct host_timespec ts;
+
+  host_clock_gettime( HOST_CLOCK_MONOTONIC, &ts );
+  return ( u64 )ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void hostif_sleep_ns( u64 ns )
+{
+  struct host_timespec req, rem;
+
+  req.tv_sec = ( long )( ns / 1000000000ULL );
+  req.tv_nsec = ( long )( ns % 1000000000ULL );
+  // The timer signal interrupts nanosleep, so keep sleeping if needed
+  while( host_nanosleep( &req, &rem ) == -1 && host_errno == HOST_EINTR )
+    req = rem;
+}
+
+static void ( *hostif_timer_handler )( void );
+
+static void hostif_sigalrm( int sig )
+{
+  hostif_timer_handler();
+}
+
+int hostif_set_timer_handler( void ( *phandler )( void ) )
+{
+  struct host_sigaction sa;
+
+  hostif_timer_handler = phandler;
+  memset( &sa, 0, sizeof( sa ) );
+  sa.handler = hostif_sigalrm;
+  // Restart interrupted system calls (console reads for example)
+  sa.flags = HOST_SA_RESTART | HOST_SA_RESTORER;
+  sa.restorer = host_sigreturn;
+  return host_rt_sigaction( HOST_SIGALRM, &sa, NULL, sizeof( sa.mask ) );
+}
+
+void hostif_set_timer( u64 ns )
+{
+  struct host_itimerval itv;
+
+  memset( &itv, 0, sizeof( itv ) );
+  // A zero value would stop the timer, so wait at least 1us
+  if( ns > 0 && ns < 1000 )
+    ns = 1000;
+  itv.it_value.tv_sec = ( long )( ns / 1000000000ULL );
+  itv.it_value.tv_usec = ( long )( ( ns % 1000000000ULL ) / 1000 );
+  host_setitimer( HOST_ITIMER_REAL, &itv, NULL );
+}
+
+int hostif_set_timer_int( int enable )
+{
+  unsigned long set[ 2 ] = { 1UL << ( HOST_SIGALRM - 1 ), 0 }, old[ 2 ];
+
+  host_rt_sigprocmask( enable ? HOST_SIG_UNBLOCK : HOST_SIG_BLOCK, set, old, sizeof( set ) );
+  return ( old[ 0 ] & set[ 0 ] ) ? 0 : 1;
+}
+
+int hostif_get_timer_int()
+{
+  unsigned long old[ 2 ];
+
+  host_rt_sigprocmask( HOST_SIG_BLOCK, NULL, old, sizeof( old ) );
+  return ( old[ 0 ] & ( 1UL << ( HOST_SIGALRM - 1 ) ) ) ? 0 : 1;
+}
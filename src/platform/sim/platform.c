@@ -11,6 +11,8 @@
 #include <ctype.h>
 #include <stdio.h>
 #include "term.h"
+#include "common.h"
+#include "elua_int.h"
 
 // Platform specific includes
 #include "hostif.h"
@@ -22,6 +24,7 @@
 
 static void i386_term_out( u8 data )
 {
+  std_flush();
   hostif_putc( data );
 }
 
@@ -70,6 +73,21 @@ static void scr_write( int fd, char c )
   hostif_putc( c );
 }
 
+#if STD_TX_BUF_SIZE > 0
+// Send the console output buffer with a single host write
+static void scr_tx_start()
+{
+  char buf[ STD_TX_BUF_SIZE ];
+  unsigned n = 0;
+  int c;
+
+  while( n < STD_TX_BUF_SIZE && ( c = std_tx_get_char() ) != -1 )
+    buf[ n ++ ] = c;
+  if( n > 0 )
+    hostif_write( 1, buf, n );
+}
+#endif // #if STD_TX_BUF_SIZE > 0
+
 static int kb_read( timer_data_type to )
 {
   int res;
@@ -89,11 +107,18 @@ static int kb_read( timer_data_type to )
 void *memory_start_address = 0;
 void *memory_end_address = 0;
 
+static void simh_timer_init();
+static void simh_timer_program();
+static void simh_timer_int();
+
 void platform_ll_init( void )
 {
   // Initialise heap memory region.
   memory_start_address = hostif_getmem( SIM_MEM_SIZE );
   memory_end_address = memory_start_address + SIM_MEM_SIZE;
+  
+  // Initialize the timers
+  simh_timer_init();
 }
 
 int platform_init()
@@ -109,6 +134,9 @@ int platform_init()
   // Set the send/recv functions                          
   std_set_send_func( scr_write );
   std_set_get_func( kb_read );       
+#if STD_TX_BUF_SIZE > 0
+  std_set_tx_start_func( scr_tx_start );
+#endif
 
   // Set term functions
 #ifdef BUILD_TERM  
@@ -121,6 +149,18 @@ int platform_init()
   snprintf( memdata, 80, "RAM size is %u bytes (%uKB)\r\n", (unsigned)SIM_MEM_SIZE, (unsigned)SIM_MEM_SIZE / 1024 );
   hostif_putstr( memdata );
 
+  // Common platform initialization code (interrupts)
+  cmn_platform_init();
+
+  // Start the timer "interrupt" and enable interrupts
+  if( hostif_set_timer_handler( simh_timer_int ) == -1 )
+  {
+    hostif_putstr( "platform_init(): unable to set the timer handler\n" );
+    return PLATFORM_ERR;
+  }
+  simh_timer_program();
+  platform_cpu_set_global_interrupts( PLATFORM_CPU_ENABLE );
+
   // All done
   return PLATFORM_OK;
 }
@@ -148,33 +188,231 @@ int platform_s_uart_set_flow_control( unsigned id, int type )
 }
 
 // ****************************************************************************
-// "Dummy" timer functions
+// Timer functions
+
+// The timers are emulated using the monotonic clock of the host. A timer is
+// an up counter running at the given clock (1MHz by default) with a 32-bit
+// range. Match interrupts and the virtual timers are implemented with the
+// host's timer signal, which acts as the timer interrupt.
+
+#define SIM_TIMER_DEFAULT_CLOCK   1000000
+#define SIM_TIMER_MAX_CLOCK       1000000000
+#define SIM_TIMER_MAX_CNT         0xFFFFFFFFULL
+#define SIM_NS_PER_SEC            1000000000ULL
+
+static u64 sim_start_ns;
+static u64 sim_tmr_base[ NUM_TIMER ];
+static u32 sim_tmr_clock[ NUM_TIMER ];
+
+#ifdef BUILD_INT_HANDLERS
+static u64 sim_tmr_match_next[ NUM_TIMER ];
+static u64 sim_tmr_match_period[ NUM_TIMER ];
+static u8 sim_tmr_match_cyclic[ NUM_TIMER ];
+// Used by the interrupt support code (platform_int.c)
+volatile u8 sim_tmr_int_enabled[ NUM_TIMER ];
+volatile u8 sim_tmr_int_flag[ NUM_TIMER ];
+#endif
+
+#if VTMR_NUM_TIMERS > 0
+#define SIM_VTMR_PERIOD_NS        ( SIM_NS_PER_SEC / VTMR_FREQ_HZ )
+static u64 sim_vtmr_next;
+#endif
+
+// Convert a number of nanoseconds to timer ticks and back
+static u64 simh_ns_to_ticks( unsigned id, u64 ns )
+{
+  u64 clock = sim_tmr_clock[ id ];
+
+  return ( ns / SIM_NS_PER_SEC ) * clock + ( ns % SIM_NS_PER_SEC ) * clock / SIM_NS_PER_SEC;
+}
+
+static u64 simh_ticks_to_ns( unsigned id, u64 ticks )
+{
+  u64 clock = sim_tmr_clock[ id ];
+
+  return ( ticks / clock ) * SIM_NS_PER_SEC + ( ticks % clock ) * SIM_NS_PER_SEC / clock;
+}
+
+static void simh_timer_init()
+{
+  unsigned i;
+
+  sim_start_ns = hostif_gettime_ns();
+  for( i = 0; i < NUM_TIMER; i ++ )
+  {
+    sim_tmr_base[ i ] = sim_start_ns;
+    sim_tmr_clock[ i ] = SIM_TIMER_DEFAULT_CLOCK;
+  }
+#if VTMR_NUM_TIMERS > 0
+  sim_vtmr_next = sim_start_ns + SIM_VTMR_PERIOD_NS;
+#endif
+}
+
+// Program the host timer for the nearest deadline (if any)
+static void simh_timer_program()
+{
+  u64 next = 0, now;
+#ifdef BUILD_INT_HANDLERS
+  unsigned i;
+
+  for( i = 0; i < NUM_TIMER; i ++ )
+    if( sim_tmr_match_period[ i ] && ( next == 0 || sim_tmr_match_next[ i ] < next ) )
+      next = sim_tmr_match_next[ i ];
+#endif
+#if VTMR_NUM_TIMERS > 0
+  if( next == 0 || sim_vtmr_next < next )
+    next = sim_vtmr_next;
+#endif
+  if( next == 0 )
+  {
+    hostif_set_timer( 0 );
+    return;
+  }
+  now = hostif_gettime_ns();
+  // Already expired deadlines must still generate an interrupt
+  hostif_set_timer( next > now ? next - now : 1 );
+}
+
+// Timer "interrupt" handler (called with the timer signal blocked)
+static void simh_timer_int()
+{
+  u64 now = hostif_gettime_ns();
+#ifdef BUILD_INT_HANDLERS
+  unsigned i;
+
+  for( i = 0; i < NUM_TIMER; i ++ )
+  {
+    if( sim_tmr_match_period[ i ] == 0 || sim_tmr_match_next[ i ] > now )
+      continue;
+    if( sim_tmr_match_cyclic[ i ] )
+    {
+      // The counter restarts from 0 on each match
+      sim_tmr_base[ i ] = sim_tmr_match_next[ i ];
+      sim_tmr_match_next[ i ] += sim_tmr_match_period[ i ];
+      if( sim_tmr_match_next[ i ] <= now )
+      {
+        // Missed matches are lost, like on a real timer
+        sim_tmr_base[ i ] = now;
+        sim_tmr_match_next[ i ] = now + sim_tmr_match_period[ i ];
+      }
+    }
+    else
+      sim_tmr_match_period[ i ] = 0;
+    sim_tmr_int_flag[ i ] = 1;
+    if( sim_tmr_int_enabled[ i ] )
+      cmn_int_handler( INT_TMR_MATCH, i );
+  }
+#endif
+#if VTMR_NUM_TIMERS > 0
+  while( sim_vtmr_next <= now )
+  {
+    cmn_virtual_timer_cb();
+    sim_vtmr_next += SIM_VTMR_PERIOD_NS;
+  }
+#endif
+  simh_timer_program();
+}
 
 void platform_s_timer_delay( unsigned id, timer_data_type delay_us )
 {
+  hostif_sleep_ns( ( u64 )delay_us * 1000 );
 }
 
 timer_data_type platform_s_timer_op( unsigned id, int op, timer_data_type data )
 {
-  return 0;
+  timer_data_type res = 0;
+
+  switch( op )
+  {
+    case PLATFORM_TIMER_OP_START:
+      sim_tmr_base[ id ] = hostif_gettime_ns();
+      break;
+
+    case PLATFORM_TIMER_OP_READ:
+      res = ( timer_data_type )( simh_ns_to_ticks( id, hostif_gettime_ns() - sim_tmr_base[ id ] ) & SIM_TIMER_MAX_CNT );
+      break;
+
+    case PLATFORM_TIMER_OP_SET_CLOCK:
+      if( data == 0 )
+        data = 1;
+      else if( data > SIM_TIMER_MAX_CLOCK )
+        data = SIM_TIMER_MAX_CLOCK;
+      sim_tmr_clock[ id ] = data;
+      sim_tmr_base[ id ] = hostif_gettime_ns();
+      res = data;
+      break;
+
+    case PLATFORM_TIMER_OP_GET_CLOCK:
+      res = sim_tmr_clock[ id ];
+      break;
+
+    case PLATFORM_TIMER_OP_GET_MAX_CNT:
+      res = SIM_TIMER_MAX_CNT;
+      break;
+  }
+  return res;
+}
+
+#ifdef BUILD_INT_HANDLERS
+int platform_s_timer_set_match_int( unsigned id, timer_data_type period_us, int type )
+{
+  u64 ticks, now;
+  int prev;
+
+  prev = platform_cpu_set_global_interrupts( PLATFORM_CPU_DISABLE );
+  if( period_us == 0 )
+  {
+    sim_tmr_match_period[ id ] = 0;
+    simh_timer_program();
+    platform_cpu_set_global_interrupts( prev );
+    return PLATFORM_TIMER_INT_OK;
+  }
+  ticks = ( u64 )period_us * sim_tmr_clock[ id ] / 1000000;
+  if( ticks == 0 )
+  {
+    platform_cpu_set_global_interrupts( prev );
+    return PLATFORM_TIMER_INT_TOO_SHORT;
+  }
+  if( ticks > SIM_TIMER_MAX_CNT )
+  {
+    platform_cpu_set_global_interrupts( prev );
+    return PLATFORM_TIMER_INT_TOO_LONG;
+  }
+  now = hostif_gettime_ns();
+  sim_tmr_base[ id ] = now;
+  sim_tmr_match_period[ id ] = simh_ticks_to_ns( id, ticks );
+  sim_tmr_match_next[ id ] = now + sim_tmr_match_period[ id ];
+  sim_tmr_match_cyclic[ id ] = type == PLATFORM_TIMER_INT_CYCLIC;
+  simh_timer_program();
+  platform_cpu_set_global_interrupts( prev );
+  return PLATFORM_TIMER_INT_OK;
 }
+#endif // #ifdef BUILD_INT_HANDLERS
 
 timer_data_type platform_timer_read_sys( void )
 {
-  return hostif_gettime();
+  return ( timer_data_type )( ( ( hostif_gettime_ns() - sim_start_ns ) / 1000 ) % ( PLATFORM_TIMER_SYS_MAX + 1 ) );
 }
 
 // ****************************************************************************
-// "Dummy" CPU functions
+// CPU functions
 
+// Global interrupts are emulated by blocking/unblocking the timer signal
 
 int platform_cpu_set_global_interrupts( int status )
 {
-  return 0;
+  return hostif_set_timer_int( status == PLATFORM_CPU_ENABLE ) ? PLATFORM_CPU_ENABLE : PLATFORM_CPU_DISABLE;
 }
 
 int platform_cpu_get_global_interrupts( void )
 {
-  return 0;
+  return hostif_get_timer_int() ? PLATFORM_CPU_ENABLE : PLATFORM_CPU_DISABLE;
 }
 
+// The timer signal is blocked here, so sleep for a short time only
+#define SIM_IDLE_MAX_US           1000
+
+void platform_cpu_idle( timer_data_type us )
+{
+  hostif_sleep_ns( ( u64 )( us < SIM_IDLE_MAX_US ? us : SIM_IDLE_MAX_US ) * 1000 );
+}
@@ -0,0 +1,57 @@
+// Simulator interrupt support
+
+#include "platform_conf.h"
+#if defined( BUILD_C_INT_HANDLERS ) || defined( BUILD_LUA_INT_HANDLERS )
+
+// Generic headers
+#include "platform.h"
+#include "elua_int.h"
+#include "common.h"
+
+// The timer "interrupt" is generated in platform.c
+extern volatile u8 sim_tmr_int_enabled[];
+extern volatile u8 sim_tmr_int_flag[];
+
+// ****************************************************************************
+// Interrupt: INT_TMR_MATCH
+
+static int int_tmr_match_get_status( elua_int_resnum resnum )
+{
+  return sim_tmr_int_enabled[ resnum ] ? PLATFORM_CPU_ENABLE : PLATFORM_CPU_DISABLE;
+}
+
+static int int_tmr_match_set_status( elua_int_resnum resnum, int status )
+{
+  int prev = int_tmr_match_get_status( resnum );
+
+  sim_tmr_int_enabled[ resnum ] = status == PLATFORM_CPU_ENABLE;
+  return prev;
+}
+
+static int int_tmr_match_get_flag( elua_int_resnum resnum, int clear )
+{
+  int status = sim_tmr_int_flag[ resnum ];
+
+  if( clear )
+    sim_tmr_int_flag[ resnum ] = 0;
+  return status;
+}
+
+// ****************************************************************************
+// Interrupt initialization
+
+void platform_int_init()
+{
+}
+
+// ****************************************************************************
+// Interrupt table
+// Must have a 1-to-1 correspondence with the interrupt enum in platform_ints.h!
+
+const elua_int_descriptor elua_int_table[ INT_ELUA_LAST ] = 
+{
+  { int_tmr_match_set_status, int_tmr_match_get_status, int_tmr_match_get_flag }
+};
+
+#endif // #if defined( BUILD_C_INT_HANDLERS ) || defined( BUILD_LUA_INT_HANDLERS )
+
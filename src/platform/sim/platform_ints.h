@@ -0,0 +1,13 @@
+// Interrupts for this platform
+
+#ifndef __PLATFORM_INTS_H__
+#define __PLATFORM_INTS_H__
+
+#include "elua_int.h"
+
+// Interrupt list
+#define INT_TMR_MATCH         ELUA_INT_FIRST_ID
+#define INT_ELUA_LAST         INT_TMR_MATCH
+
+#endif
+
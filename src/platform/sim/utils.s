@@ -6,6 +6,7 @@
 [BITS 32]                       ; All instructions should be 32-bit.
 
 [GLOBAL longjmp]                 
+[GLOBAL host_sigreturn]
 [SECTION .text]
 
 longjmp:
@@ -31,3 +32,11 @@ longjmp:
 
   ret
 
+; Return from a signal handler (used as the 'restorer' of the host signals)
+; The handlers are installed without SA_SIGINFO, so the kernel builds a
+; non-rt signal frame: pop the signal number and call sigreturn, not
+; rt_sigreturn
+host_sigreturn:
+  pop   eax
+  mov   eax, 119                ; __NR_sigreturn
+  int   0x80
@@ -274,6 +274,10 @@ pio_type platform_pio_op( unsigned port, pio_type pinmask, int op )
 // CAN
 // TODO: Many things
 
+// Set when the RX interrupt handler disabled the RX interrupt because the
+// frames were left in the FIFO (see platform_int.c)
+volatile u8 stm32_can_rx_int_paused;
+
 void cans_init( void )
 {
   // Remap CAN to PB8/9
@@ -406,37 +410,12 @@ int platform_can_send( unsigned id, u32 canid, u8 idtype, u8 len, const u8 *data
   return PLATFORM_OK;
 }
 
-void USB_LP_CAN_RX0_IRQHandler(void)
-{
-/*
-  CanRxMsg RxMessage;
-
-  RxMessage.StdId=0x00;
-  RxMessage.ExtId=0x00;
-  RxMessage.IDE=0;
-  RxMessage.DLC=0;
-  RxMessage.FMI=0;
-  RxMessage.Data[0]=0x00;
-  RxMessage.Data[1]=0x00;
-
-  CAN_Receive(CAN_FIFO0, &RxMessage);
-
-  if((RxMessage.ExtId==0x1234) && (RxMessage.IDE==CAN_ID_EXT)
-     && (RxMessage.DLC==2) && ((RxMessage.Data[1]|RxMessage.Data[0]<<8)==0xDECA))
-  {
-    ret = 1; 
-  }
-  else
-  {
-    ret = 0; 
-  }*/
-}
-
-int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
+int platform_s_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
 {
   CanRxMsg RxMessage;
   const char *s;
   char *d;
+  int res = PLATFORM_UNDERFLOW;
 
   if( CAN_MessagePending( CAN1, CAN_FIFO0 ) > 0 )
   {
@@ -458,10 +437,15 @@ int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
     s = ( const char * )RxMessage.Data;
     d = ( char* )data;
     DUFF_DEVICE_8( RxMessage.DLC,  *d++ = *s++ );
-    return PLATFORM_OK;
+    res = PLATFORM_OK;
   }
-  else
-    return PLATFORM_UNDERFLOW;
+  // Re-enable the RX interrupt once the FIFO is empty
+  if( stm32_can_rx_int_paused && CAN_MessagePending( CAN1, CAN_FIFO0 ) == 0 )
+  {
+    stm32_can_rx_int_paused = 0;
+    CAN_ITConfig( CAN1, CAN_IT_FMP0, ENABLE );
+  }
+  return res;
 }
 
 // ****************************************************************************
@@ -529,6 +513,24 @@ spi_data_type platform_spi_send_recv( unsigned id, spi_data_type data )
   return SPI_I2S_ReceiveData( spi[ id ] );
 }
 
+void platform_spi_transfer( unsigned id, const u8 *out, u8 *in, u32 len )
+{
+  SPI_TypeDef *pspi = spi[ id ];
+  u8 data;
+
+  // Same as platform_spi_send_recv, but with direct register access. The next
+  // byte is sent only after the current one is received, so an interrupt
+  // between the two can't overrun the receiver.
+  while( len -- )
+  {
+    pspi->DR = out ? *out ++ : 0xFF;
+    while( ( pspi->SR & SPI_I2S_FLAG_RXNE ) == 0 );
+    data = ( u8 )pspi->DR;
+    if( in )
+      *in ++ = data;
+  }
+}
+
 void platform_spi_select( unsigned id, int is_select )
 {
   // This platform doesn't have a hardware SS pin, so there's nothing to do here
@@ -1023,6 +1025,14 @@ u32 platform_s_cpu_get_frequency()
   return HCLK;
 }
 
+// Sleep until the next interrupt. SysTick wakes the CPU up at least every
+// SYSTICKMS milliseconds, so don't sleep if 'us' is shorter than that.
+void platform_cpu_idle( timer_data_type us )
+{
+  if( us >= SYSTICKMS * 1000 )
+    __WFI();
+}
+
 // *****************************************************************************
 // ADC specific functions and variables
 
@@ -4,6 +4,8 @@
 #define __PLATFORM_GENERIC_H__
 
 #define PLATFORM_HAS_SYSTIMER
+#define PLATFORM_HAS_SPI_TRANSFER
+#define PLATFORM_HAS_CPU_IDLE
 
 #endif // #ifndef __PLATFORM_GENERIC_H__
 
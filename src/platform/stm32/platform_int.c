@@ -23,10 +23,13 @@ static void all_usart_irqhandler( int resnum )
   int temp;
 
   temp = USART_GetFlagStatus( stm32_usart[ resnum ], USART_FLAG_ORE );
-  cmn_int_handler( INT_UART_RX, resnum );
+  if( temp == SET || USART_GetFlagStatus( stm32_usart[ resnum ], USART_FLAG_RXNE ) == SET )
+    cmn_int_handler( INT_UART_RX, resnum );
   if( temp == SET )
     for( temp = 0; temp < 10; temp ++ )
       platform_s_uart_send( resnum, '@' );
+  if( USART_GetITStatus( stm32_usart[ resnum ], USART_IT_TXE ) == SET )
+    cmn_int_handler( INT_UART_TX, resnum );
 }
 
 void USART1_IRQHandler()
@@ -187,6 +190,21 @@ void TIM8_CC_IRQHandler(void)
   tmr_int_handler( 7 );
 }
 
+extern volatile u8 stm32_can_rx_int_paused;
+
+void USB_LP_CAN1_RX0_IRQHandler(void)
+{
+  cmn_int_handler( INT_CAN_RX, 0 );
+  // If the frames were not read by a C handler the interrupt would fire
+  // again immediately, so disable it until the FIFO is emptied (it is
+  // enabled again by platform_s_can_recv)
+  if( CAN_MessagePending( CAN1, CAN_FIFO0 ) > 0 )
+  {
+    CAN_ITConfig( CAN1, CAN_IT_FMP0, DISABLE );
+    stm32_can_rx_int_paused = 1;
+  }
+}
+
 // ****************************************************************************
 // GPIO helper functions
 
@@ -342,6 +360,50 @@ static int int_uart_rx_get_flag( elua_int_resnum resnum, int clear )
   return status;
 }
 
+// ****************************************************************************
+// Interrupt: INT_UART_TX
+
+static int int_uart_tx_get_status( elua_int_resnum resnum )
+{
+  return ( stm32_usart[ resnum ]->CR1 & USART_CR1_TXEIE ) ? 1 : 0;
+}
+
+static int int_uart_tx_set_status( elua_int_resnum resnum, int status )
+{
+  int prev = int_uart_tx_get_status( resnum );
+  USART_ITConfig( stm32_usart[ resnum ], USART_IT_TXE, status == PLATFORM_CPU_ENABLE ? ENABLE : DISABLE );
+  return prev;
+}
+
+static int int_uart_tx_get_flag( elua_int_resnum resnum, int clear )
+{
+  // The flag is cleared by writing to the data register
+  return USART_GetFlagStatus( stm32_usart[ resnum ], USART_FLAG_TXE ) == SET ? 1 : 0;
+}
+
+// ****************************************************************************
+// Interrupt: INT_CAN_RX
+
+// The interrupt is still enabled while its handler keeps it disabled
+static int int_can_rx_get_status( elua_int_resnum resnum )
+{
+  return ( ( CAN1->IER & CAN_IT_FMP0 ) || stm32_can_rx_int_paused ) ? 1 : 0;
+}
+
+static int int_can_rx_set_status( elua_int_resnum resnum, int status )
+{
+  int prev = int_can_rx_get_status( resnum );
+  stm32_can_rx_int_paused = 0;
+  CAN_ITConfig( CAN1, CAN_IT_FMP0, status == PLATFORM_CPU_ENABLE ? ENABLE : DISABLE );
+  return prev;
+}
+
+static int int_can_rx_get_flag( elua_int_resnum resnum, int clear )
+{
+  // The flag is cleared by reading the frames from the FIFO
+  return CAN_MessagePending( CAN1, CAN_FIFO0 ) > 0 ? 1 : 0;
+}
+
 // ****************************************************************************
 // Initialize interrupt subsystem
 
@@ -389,6 +451,10 @@ void platform_int_init()
     NVIC_Init( &nvic_init_structure );
   }
 
+  // Enable the CAN RX interrupt in the NVIC
+  nvic_init_structure.NVIC_IRQChannel = USB_LP_CAN1_RX0_IRQn;
+  NVIC_Init( &nvic_init_structure );
+
 #ifdef INT_TMR_MATCH
   for( i = 0; i < sizeof( timer_irq_table ) / sizeof( u8 ); i ++ )
   {
@@ -409,5 +475,7 @@ const elua_int_descriptor elua_int_table[ INT_ELUA_LAST ] =
   { int_gpio_posedge_set_status, int_gpio_posedge_get_status, int_gpio_posedge_get_flag },
   { int_gpio_negedge_set_status, int_gpio_negedge_get_status, int_gpio_negedge_get_flag },
   { int_tmr_match_set_status, int_tmr_match_get_status, int_tmr_match_get_flag },
-  { int_uart_rx_set_status, int_uart_rx_get_status, int_uart_rx_get_flag }  
+  { int_uart_rx_set_status, int_uart_rx_get_status, int_uart_rx_get_flag },
+  { int_can_rx_set_status, int_can_rx_get_status, int_can_rx_get_flag },
+  { int_uart_tx_set_status, int_uart_tx_get_status, int_uart_tx_get_flag }
 };
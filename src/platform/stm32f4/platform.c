@@ -1207,7 +1207,7 @@ void USB_LP_CAN_RX0_IRQHandler(void)
   }*/
 }
 
-int platform_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
+int platform_s_can_recv( unsigned id, u32 *canid, u8 *idtype, u8 *len, u8 *data )
 {
   CanRxMsg RxMessage;
   const char *s;
@@ -186,7 +186,8 @@ static const DM_DEVICE rfs_device =
   NULL,                 // mkdir
   NULL,                 // unlink
   NULL,                 // rmdir
-  NULL                  // rename
+  NULL,                 // rename
+  NULL                  // map
 };
 
 int remotefs_init()
@@ -35,6 +35,9 @@ static int wofs_sim_fd;
 // Length of the 'file size' field for both ROMFS/WOFS
 #define ROMFS_SIZE_LEN        4
 
+// Length of the terminator after the data of a ROMFS file (not used on WOFS)
+#define ROMFS_TERM_LEN        1
+
 static int romfs_find_empty_fd(void)
 {
   int i;
@@ -126,6 +129,8 @@ static u8 romfs_open_file( const char* fname, FD* pfd, FSDATA *pfs, u32 *plast,
     // On WOFS, all file names must begin at a multiple of ROMFS_ALIGN
     if( romfsh_is_wofs( pfs ) )
       i = ( i + ROMFS_ALIGN - 1 ) & ~( ROMFS_ALIGN - 1 );
+    else
+      i += ROMFS_TERM_LEN;
   }
   *plast = 0;
   return FS_FILE_NOT_FOUND;
@@ -397,6 +402,8 @@ static struct dm_dirent* romfs_readdir_r( struct _reent *r, void *d, void *pdata
     off += pent->fsize;
     if( romfsh_is_wofs( pfsdata ) )
       off = ( off + ROMFS_ALIGN - 1 ) & ~( ROMFS_ALIGN - 1 );
+    else
+      off += ROMFS_TERM_LEN;
     if( !is_deleted )
       break;
   }
@@ -423,6 +430,24 @@ static const char* romfs_getaddr_r( struct _reent *r, int fd, void *pdata )
     return NULL;
 }
 
+// map
+// Only direct mode ROMFS can be mapped; WOFS data might be erased by a format
+static const char* romfs_map_r( struct _reent *r, int fd, off_t off, size_t *plen, void *pdata )
+{
+  FD* pfd = fd_table + fd;
+  FSDATA *pfsdata = ( FSDATA* )pdata;
+
+  if( ( pfsdata->flags & ROMFS_FS_FLAG_DIRECT ) == 0 || romfsh_is_wofs( pfsdata ) )
+    return NULL;
+  if( off < 0 || ( u32 )off > pfd->size )
+  {
+    r->_errno = EINVAL;
+    return NULL;
+  }
+  *plen = fsmin( *plen, pfd->size - ( u32 )off );
+  return ( const char* )pfsdata->pbase + pfd->baseaddr + off;
+}
+
 // ****************************************************************************
 // Our ROMFS device descriptor structure
 // These functions apply to both ROMFS and WOFS
@@ -441,7 +466,8 @@ static const DM_DEVICE romfs_device =
   NULL,                 // mkdir
   NULL,                 // unlink
   NULL,                 // rmdir
-  NULL                  // rename
+  NULL,                 // rename
+  romfs_map_r           // map
 };
 
 // ****************************************************************************
@@ -260,7 +260,8 @@ static const DM_DEVICE semifs_device =
   NULL,                  // mkdir
   NULL,                  // unlink
   NULL,                  // rmdir                   
-  NULL                   // rename
+  NULL,                  // rename
+  NULL                   // map
 };
 
 int semifs_init()
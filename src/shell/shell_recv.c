@@ -6,6 +6,7 @@
 #include <ctype.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include "shell.h"
 #include "common.h"
 #include "type.h"
@@ -24,11 +25,46 @@ const char shell_help_summary_recv[] = "receive files via XMODEM";
 
 extern char *shell_prog;
 
+// State of the lua_Reader that feeds the XMODEM blocks to the Lua loader
+typedef struct
+{
+  xmodem_stream *ps;
+  long res;
+  u32 total;
+} shell_recv_reader_data;
+
+static const char* shell_recv_reader( lua_State *L, void *data, size_t *size )
+{
+  shell_recv_reader_data *prd = ( shell_recv_reader_data* )data;
+  const u8 *pdata;
+
+  ( void )L;
+  if( ( prd->res = xmodem_stream_next( prd->ps, &pdata ) ) <= 0 )
+    return NULL;
+  *size = prd->res;
+  prd->total += prd->res;
+  return ( const char* )pdata;
+}
+
+static void shell_recv_error( long res )
+{
+  if( res == XMODEM_ERROR_REMOTECANCEL )
+    printf( "cancelled by remote\n" );
+  else
+    printf( "XMODEM error\n" );
+}
+
+// The data is never kept in memory: each XMODEM block is written to the
+// destination file or handed to the Lua loader as soon as it arrives
 void shell_recv( int argc, char **argv )
 {
-  char *p;
-  long actsize;
+  xmodem_stream *ps;
+  const u8 *pdata;
+  long res;
+  u32 total = 0;
   lua_State* L;
+  FILE *foutput;
+  shell_recv_reader_data rd;
 
   if( argc > 2 )
   {
@@ -36,42 +72,44 @@ void shell_recv( int argc, char **argv )
     return;
   }
 
-  if( ( shell_prog = malloc( XMODEM_INITIAL_BUFFER_SIZE ) ) == NULL )
+  if( ( shell_prog = malloc( sizeof( xmodem_stream ) ) ) == NULL )
   {
     printf( "Unable to allocate memory\n" );
     return;
   }
-  printf( "Waiting for file ... " );
-  if( ( actsize = xmodem_receive( &shell_prog ) ) < 0 )
-  {
-    if( actsize == XMODEM_ERROR_OUTOFMEM )
-      printf( "file too big\n" );
-    else
-      printf( "XMODEM error\n" );
-    goto exit;
-  }
-  // Eliminate the XMODEM padding bytes
-  p = shell_prog + actsize - 1;
-  while( *p == '\x1A' )
-    p --;
-  p ++;
-  printf( "done, got %u bytes\n", ( unsigned )( p - shell_prog ) );          
+  ps = ( xmodem_stream* )shell_prog;
+  xmodem_stream_init( ps );
   
-  // we've received an argument, try saving it to a file
+  // we've received an argument, save the data to a file
   if( argc == 2 )
   {
-    FILE *foutput = fopen( argv[ 1 ], "w" );
-    size_t file_sz = p - shell_prog;
-    if( foutput == NULL )
+    if( ( foutput = fopen( argv[ 1 ], "w" ) ) == NULL )
     {
       printf( "unable to open file %s\n", argv[ 1 ] );
       goto exit;
     }
-    if( fwrite( shell_prog, sizeof( char ), file_sz, foutput ) == file_sz )
-      printf( "received and saved as %s\n", argv[ 1 ] );
-    else
-      printf( "unable to save file %s (no space left on target?)\n", argv[ 1 ] );
+    printf( "Waiting for file ... " );
+    while( ( res = xmodem_stream_next( ps, &pdata ) ) > 0 )
+    {
+      if( fwrite( pdata, sizeof( char ), res, foutput ) != ( size_t )res )
+      {
+        xmodem_stream_abort( ps );
+        break;
+      }
+      total += res;
+    }
     fclose( foutput );
+    if( res < 0 )
+      shell_recv_error( res );
+    else if( res > 0 )
+      printf( "unable to save file %s (no space left on target?)\n", argv[ 1 ] );
+    else
+    {
+      printf( "done, got %u bytes\n", ( unsigned )total );
+      printf( "received and saved as %s\n", argv[ 1 ] );
+      goto exit;
+    }
+    unlink( argv[ 1 ] );
   }
   else // no arg, running the file with lua.
   {
@@ -81,11 +119,24 @@ void shell_recv( int argc, char **argv )
       goto exit;
     }
     luaL_openlibs( L );
-    if( luaL_loadbuffer( L, shell_prog, p - shell_prog, "xmodem" ) != 0 )
-      printf( "Error: %s\n", lua_tostring( L, -1 ) );
+    printf( "Waiting for file ... " );
+    rd.ps = ps;
+    rd.res = 0;
+    rd.total = 0;
+    res = lua_load( L, shell_recv_reader, &rd, "xmodem" );
+    // The parser might stop before the end of the data (syntax error)
+    xmodem_stream_abort( ps );
+    if( rd.res < 0 )
+      shell_recv_error( rd.res );
     else
-      if( lua_pcall( L, 0, LUA_MULTRET, 0 ) != 0 )
+    {
+      printf( "done, got %u bytes\n", ( unsigned )rd.total );
+      if( res != 0 )
         printf( "Error: %s\n", lua_tostring( L, -1 ) );
+      else
+        if( lua_pcall( L, 0, LUA_MULTRET, 0 ) != 0 )
+          printf( "Error: %s\n", lua_tostring( L, -1 ) );
+    }
     lua_close( L );
   }
 exit:
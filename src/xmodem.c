@@ -130,85 +130,128 @@ err:
 
 }
 
-// This global function receives a x-modem transmission consisting of
-// (potentially) several blocks.  Returns the number of bytes received or
-// an error code an error
-long xmodem_receive( char **dest )
+// Streaming receive states
+enum
 {
-  int starting = 1, ch;
-  unsigned char packnum = 1, buf[ 1024 + 4 ];
+  XMODEM_STREAM_START,
+  XMODEM_STREAM_RUNNING,
+  XMODEM_STREAM_DONE
+};
+
+// Padding byte used by the sender to fill the last block
+#define XM_PAD  0x1A
+
+void xmodem_stream_init( xmodem_stream *ps )
+{
+  ps->datalen = ps->rxlen = 0;
+  ps->packnum = 1;
+  ps->state = XMODEM_STREAM_START;
+}
+
+// This global function receives a x-modem transmission one block at a time.
+// Returns the number of data bytes available in *pdata (valid until the next
+// call), 0 at the end of the transmission or an error code. A block is
+// acknowledged only when the caller asks for the next one, so the sender waits
+// while the caller consumes the data. Memory usage does not depend on the
+// size of the transmission.
+long xmodem_stream_next( xmodem_stream *ps, const u8 **pdata )
+{
+  int ch;
   unsigned retries = XMODEM_RETRY_LIMIT;
-  u32 limit = XMODEM_INITIAL_BUFFER_SIZE, size = 0;
-  void *p;
   unsigned pack_sz; // TH
-  
+  long res;
+
+  if( ps->state == XMODEM_STREAM_DONE )
+    return 0;
+  // Acknowledge the block received in the previous call
+  if( ps->rxlen )
+  {
+    memcpy( ps->data, ps->rxbuf + 2, ps->rxlen );
+    ps->datalen = ps->rxlen;
+    ps->rxlen = 0;
+    xmodem_out_func( XM_ACK );
+  }
   while( retries-- ) 
   {
-    if( starting )
+    if( ps->state == XMODEM_STREAM_START )
       xmodem_out_func( 'C' );
     if( ( ( ch = xmodem_in_func( XMODEM_TIMEOUT ) ) == -1 ) || ( ch != XM_SOH  && /* TH */ ch != XM_STX && /*TH*/  ch != XM_EOT && ch != XM_CAN ) )
       continue;
       
-    switch(ch) { // TH
-	  case XM_EOT:	  
-    //if( ch == XM_EOT ) 
-    //{
-      // End of transmission
-      xmodem_out_func( XM_ACK );
-      xmodem_flush( XMODEM_FLUSH_ONLY );
-      return size;
-    //}
+    switch( ch )
+    {
+      case XM_EOT:
+        // End of transmission, return the last block without its padding
+        xmodem_out_func( XM_ACK );
+        xmodem_flush( XMODEM_FLUSH_ONLY );
+        ps->state = XMODEM_STREAM_DONE;
+        while( ps->datalen > 0 && ps->data[ ps->datalen - 1 ] == XM_PAD )
+          ps->datalen --;
+        *pdata = ps->data;
+        res = ps->datalen;
+        ps->datalen = 0;
+        return res;
+
       case XM_CAN:
-    //else if( ch == XM_CAN )
-    //{
-      // The remote part ended the transmission
-      xmodem_out_func( XM_ACK );
-      xmodem_flush( XMODEM_FLUSH_ONLY );
-      return XMODEM_ERROR_REMOTECANCEL;      
-    //}
+        // The remote part ended the transmission
+        xmodem_out_func( XM_ACK );
+        xmodem_flush( XMODEM_FLUSH_ONLY );
+        ps->state = XMODEM_STREAM_DONE;
+        return XMODEM_ERROR_REMOTECANCEL;      
+
       case XM_SOH: 
-        pack_sz=128;
+        pack_sz = 128;
         break;
+
       case XM_STX: 
-        pack_sz=1024;
+        pack_sz = XMODEM_MAX_BLOCK_SIZE;
         break;
+
       default: // TH: Should never happen
+        ps->state = XMODEM_STREAM_DONE;
         return XMODEM_ERROR_INTERNAL;
     }       
-    starting = 0;
-    
+    ps->state = XMODEM_STREAM_RUNNING;
     
     // Get XMODEM packet
-    if( !xmodem_get_record( packnum, buf,pack_sz ) )
+    if( !xmodem_get_record( ps->packnum, ps->rxbuf, pack_sz ) )
       continue; // allow for retransmission
     xmodem_flush( XMODEM_FLUSH_ONLY );      
     retries = XMODEM_RETRY_LIMIT;
-    packnum ++;
-      
-    // Got a valid packet
-    if( size + pack_sz > limit )
+    ps->packnum ++;
+
+    // Got a valid packet, keep it and return the previous one (if any)
+    ps->rxlen = pack_sz;
+    if( ps->datalen )
     {
-      limit += XMODEM_INCREMENT_AMMOUNT;
-      if( ( p = realloc( *dest, limit ) ) == NULL )
-      {
-        // Not enough memory, force cancel and return
-        xmodem_flush( XMODEM_FLUSH_AND_XM_CAN );
-        return XMODEM_ERROR_OUTOFMEM;
-      }
-      *dest = ( char* )p;
-    }    
-    // Acknowledge and consume packet
-  
-    memcpy( *dest + size, buf + 2, pack_sz );
-    size += pack_sz;
+      *pdata = ps->data;
+      res = ps->datalen;
+      ps->datalen = 0;
+      return res;
+    }
+    // This was the first packet: hold it back and acknowledge it
+    memcpy( ps->data, ps->rxbuf + 2, pack_sz );
+    ps->datalen = pack_sz;
+    ps->rxlen = 0;
     xmodem_out_func( XM_ACK );
   }
   
   // Exceeded retry count
   xmodem_flush( XMODEM_FLUSH_AND_XM_CAN );
+  ps->state = XMODEM_STREAM_DONE;
   return XMODEM_ERROR_RETRYEXCEED;
 }
 
+// Cancel a transmission (for example when the caller can't consume the data)
+void xmodem_stream_abort( xmodem_stream *ps )
+{
+  if( ps->state != XMODEM_STREAM_DONE )
+  {
+    xmodem_flush( XMODEM_FLUSH_AND_XM_CAN );
+    ps->state = XMODEM_STREAM_DONE;
+  }
+}
+
 #else // #ifdef BUILD_XMODEM
 
 // Dummy init function
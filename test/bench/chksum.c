@@ -0,0 +1,94 @@
+// Microbenchmark: uIP portable chksum() vs. elua_chksum() (UIP_ARCH_CHKSUM)
+// Runs on the same x86 host as the sim platform and reports bytes/cycle.
+// Build and run from the eLua root directory:
+//   gcc -O2 -DELUA_ENDIAN_LITTLE -Iinc/desktop test/bench/chksum.c src/elua_chksum.c -o chksum_bench
+//   ./chksum_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "type.h"
+
+#define ITERATIONS    20000
+
+u16 elua_chksum( u16 sum, const u8 *data, u16 len );
+
+// Copy of the portable implementation from src/uip/uip.c
+static u16 uip_portable_chksum( u16 sum, const u8 *data, u16 len )
+{
+  u16 t;
+  const u8 *dataptr = data;
+  const u8 *last_byte = data + len - 1;
+
+  while( dataptr < last_byte )
+  {
+    t = ( dataptr[ 0 ] << 8 ) + dataptr[ 1 ];
+    sum += t;
+    if( sum < t )
+      sum ++;
+    dataptr += 2;
+  }
+  if( dataptr == last_byte )
+  {
+    t = ( dataptr[ 0 ] << 8 ) + 0;
+    sum += t;
+    if( sum < t )
+      sum ++;
+  }
+  return sum;
+}
+
+static u64 rdtsc()
+{
+  u32 lo, hi;
+
+  __asm__ __volatile__( "rdtsc" : "=a" ( lo ), "=d" ( hi ) );
+  return ( ( u64 )hi << 32 ) | lo;
+}
+
+typedef u16 ( *p_chksum )( u16, const u8*, u16 );
+
+static double bench( p_chksum f, const u8 *data, u16 len )
+{
+  volatile u16 sink = 0;
+  u64 start;
+  unsigned i;
+
+  start = rdtsc();
+  for( i = 0; i < ITERATIONS; i ++ )
+    sink += f( 0, data, len );
+  return ( double )len * ITERATIONS / ( double )( rdtsc() - start );
+}
+
+int main()
+{
+  static u32 buf[ 1600 / 4 ];
+  u8 *data = ( u8* )buf;
+  static const u16 sizes[] = { 20, 64, 536, 1460 };
+  static const unsigned offsets[] = { 0, 1, 2, 14 };
+  unsigned i, j, len, off;
+
+  srand( 1 );
+  for( i = 0; i < sizeof( buf ); i ++ )
+    data[ i ] = rand();
+  // Check that both implementations agree for every length/alignment/initial sum
+  for( off = 0; off < 4; off ++ )
+    for( len = 0; len <= 1500; len ++ )
+      for( i = 0; i < 3; i ++ )
+      {
+        u16 sum = i == 0 ? 0 : i == 1 ? 0xFFFF : ( u16 )rand();
+        if( elua_chksum( sum, data + off, len ) != uip_portable_chksum( sum, data + off, len ) )
+        {
+          printf( "MISMATCH offset=%u len=%u sum=%04X\n", off, len, sum );
+          return 1;
+        }
+      }
+  printf( "%-6s %-6s %12s %12s %8s\n", "offset", "len", "uip B/cyc", "elua B/cyc", "speedup" );
+  for( i = 0; i < sizeof( offsets ) / sizeof( offsets[ 0 ] ); i ++ )
+    for( j = 0; j < sizeof( sizes ) / sizeof( sizes[ 0 ] ); j ++ )
+    {
+      double old = bench( uip_portable_chksum, data + offsets[ i ], sizes[ j ] );
+      double new = bench( elua_chksum, data + offsets[ i ], sizes[ j ] );
+      printf( "%-6u %-6u %12.3f %12.3f %7.2fx\n", offsets[ i ], sizes[ j ], old, new, new / old );
+    }
+  return 0;
+}
@@ -0,0 +1,2 @@
+-- Run the benchmark suite at boot (ROMFS image for test/bench/run_sim_bench.sh)
+dofile( "/rom/bench.lua" )
@@ -0,0 +1,363 @@
+-- eLua benchmark suite
+-- Runs a set of microbenchmarks and prints one line per result:
+--   BENCH <tab> name <tab> value <tab> unit
+-- All the timings use the system timer (tmr.SYS_TIMER). The results are
+-- meant to be collected by test/bench/run_sim_bench.sh, but this file can
+-- also be executed on a real board ("lua /rom/bench.lua").
+
+local tmr, collectgarbage, io = tmr, collectgarbage, io
+local ST = tmr.SYS_TIMER
+
+-- Scale factor for the number of iterations (first argument of the script)
+local scale = ... and tonumber( ... ) or 1
+local N = 20000 * scale
+
+local function report( name, value, unit )
+  print( string.format( "BENCH\t%s\t%s\t%s", name, tostring( value ), unit ) )
+end
+
+-- Run 'f( n )' and report the time per iteration in ns
+local function timeit( name, n, f )
+  collectgarbage( "collect" )
+  local start = tmr.read( ST )
+  f( n )
+  local dt = tmr.getdiffnow( ST, start )
+  report( name, math.floor( dt * 1000 / n ), "ns/op" )
+end
+
+-- Run 'f( n )' with the GC stopped and report the memory allocated per
+-- iteration in bytes (this is the garbage left for the GC to collect)
+local function allocit( name, n, f )
+  collectgarbage( "collect" )
+  collectgarbage( "stop" )
+  local before = collectgarbage( "count" )
+  f( n )
+  local kb = collectgarbage( "count" ) - before
+  collectgarbage( "restart" )
+  report( name, math.floor( kb * 1024 / n ), "B/op" )
+end
+
+-- Empty loop, used as a reference for the other VM benchmarks
+local function empty_loop( n )
+  for i = 1, n do end
+end
+
+-- ****************************************************************************
+-- VM dispatch
+
+local function vm_arith( n )
+  local a, b = 1, 3
+  for i = 1, n do
+    a = ( a + b * i ) % 65536
+  end
+  return a
+end
+
+local function vm_call( n )
+  local function f( x ) return x end
+  for i = 1, n do
+    f( i )
+  end
+end
+
+local function vm_closure( n )
+  for i = 1, n do
+    local f = function() return i end
+  end
+end
+
+local function vm_concat( n )
+  local s
+  for i = 1, n do
+    s = "x" .. i
+  end
+  return s
+end
+
+-- ****************************************************************************
+-- Tables and rotables
+
+local function tbl_array_write( n )
+  local t = {}
+  for i = 1, n do
+    t[ i ] = i
+  end
+end
+
+local function tbl_hash_read( n )
+  local t = { a = 1, b = 2, c = 3, d = 4 }
+  local s = 0
+  for i = 1, n do
+    s = s + t.a + t.d
+  end
+  return s
+end
+
+-- Global lookup of a ROM module and a field of that module
+local function tbl_rotable_read( n )
+  local s
+  for i = 1, n do
+    s = string.len
+  end
+  return s
+end
+
+local function tbl_global_read( n )
+  local s
+  for i = 1, n do
+    s = tostring
+  end
+  return s
+end
+
+-- Fill a sample table (16 array entries and 2 fields) in each iteration:
+-- a new table that grows as it's filled, a new preallocated table and the
+-- same table cleared and reused
+local function tbl_fill_grow( n )
+  local t
+  for i = 1, n do
+    t = {}
+    for j = 1, 16 do t[ j ] = j end
+    t.stamp, t.count = i, 16
+  end
+  return t
+end
+
+local function tbl_fill_new( n )
+  local t
+  for i = 1, n do
+    t = table.new( 16, 2 )
+    for j = 1, 16 do t[ j ] = j end
+    t.stamp, t.count = i, 16
+  end
+  return t
+end
+
+local tbl_sample = table.new( 16, 2 )
+local function tbl_fill_clear( n )
+  local t = tbl_sample
+  for i = 1, n do
+    table.clear( t )
+    for j = 1, 16 do t[ j ] = j end
+    t.stamp, t.count = i, 16
+  end
+  return t
+end
+
+-- ****************************************************************************
+-- Strings
+
+-- New strings, each one must be hashed and interned
+local function str_intern_new( n )
+  local s
+  for i = 1, n do
+    s = tostring( i )
+  end
+  return s
+end
+
+-- Strings that are already interned
+local function str_intern_existing( n )
+  local s
+  for i = 1, n do
+    s = string.sub( "interned string", 1, 8 )
+  end
+  return s
+end
+
+local function str_format( n )
+  local s
+  for i = 1, n do
+    s = string.format( "%d:%s", i, "abc" )
+  end
+  return s
+end
+
+-- Decode a 40 field binary frame with a format string and with a compiled
+-- format (returning the values and storing them in a table)
+local frame_fmt = "<" .. string.rep( "H", 20 ) .. string.rep( "b", 10 ) .. string.rep( "i", 10 )
+local frame_data
+
+local function pack_unpack_str( n )
+  local t
+  for i = 1, n do
+    t = { pack.unpack( frame_data, frame_fmt ) }
+  end
+  return t
+end
+
+local function pack_unpack_compiled( n )
+  local f, t = pack.compile( frame_fmt ), {}
+  for i = 1, n do
+    pack.unpack( frame_data, f, 1, t )
+  end
+  return t
+end
+
+-- ****************************************************************************
+-- GC pauses under the different EGC modes
+
+local egc_modes =
+{
+  { "not_active", elua.EGC_NOT_ACTIVE },
+  { "on_alloc_failure", elua.EGC_ON_ALLOC_FAILURE },
+  { "on_mem_limit", elua.EGC_ON_MEM_LIMIT, 64 * 1024 },
+  { "always", elua.EGC_ALWAYS },
+}
+
+-- Allocate a number of tables (keeping some of them alive) and report the
+-- longest time spent in a single allocation (the GC pause) and the total time
+local function gc_pause( name, mode, limit )
+  local keep = {}
+  local n = 500 * scale
+  elua.egc_setup( mode, limit )
+  collectgarbage( "collect" )
+  local maxdt, total = 0, tmr.read( ST )
+  for i = 1, n do
+    local start = tmr.read( ST )
+    local t = { i, i + 1, i + 2 }
+    local dt = tmr.getdiffnow( ST, start )
+    if dt > maxdt then maxdt = dt end
+    keep[ i % 64 + 1 ] = t
+  end
+  total = tmr.getdiffnow( ST, total )
+  report( "gc." .. name .. ".max_pause", maxdt, "us" )
+  report( "gc." .. name .. ".total", total, "us" )
+end
+
+-- ****************************************************************************
+-- File systems
+
+local fs_block = string.rep( "0123456789abcdef", 32 ) -- 512 bytes
+local fs_size = 32768
+
+local function fs_write( name, fname )
+  local f = io.open( fname, "wb" )
+  if not f then return false end
+  local start = tmr.read( ST )
+  for i = 1, fs_size / #fs_block do
+    f:write( fs_block )
+  end
+  f:close()
+  local dt = tmr.getdiffnow( ST, start )
+  report( "fs." .. name .. ".write", math.floor( fs_size * 1000 / ( dt > 0 and dt or 1 ) ), "KB/s" )
+  return true
+end
+
+local function fs_read( name, fname )
+  local f = io.open( fname, "rb" )
+  if not f then return end
+  local size = 0
+  local start = tmr.read( ST )
+  while true do
+    local d = f:read( #fs_block )
+    if not d then break end
+    size = size + #d
+  end
+  f:close()
+  local dt = tmr.getdiffnow( ST, start )
+  report( "fs." .. name .. ".read", math.floor( size * 1000 / ( dt > 0 and dt or 1 ) ), "KB/s" )
+end
+
+-- Read only file systems are tested with an existing file, the others with
+-- a temporary file that is written first
+local fs_list =
+{
+  { "romfs", "/rom/bench.lua" },
+  { "wofs", "/wo/bench.tmp" },
+  { "mmcfs", "/mmc/bench.tmp" },
+  { "niffs", "/f/bench.tmp" },
+}
+
+-- Sequential SD card throughput with large transfers. The file is written
+-- with blocks larger than the stdio buffer (so they go straight to the file
+-- system) and read through a stdio buffer of the same size, so the FatFs
+-- transfers span several clusters and the disk driver gets multiple block
+-- requests. On the simulator the SD card is emulated by a file (sdcard.img).
+local sd_block = string.rep( fs_block, 32 ) -- 16K
+local sd_size = 262144 * scale
+
+local function sd_seq( fname )
+  local f = io.open( fname, "wb" )
+  if not f then return end
+  local start = tmr.read( ST )
+  for i = 1, sd_size / #sd_block do
+    f:write( sd_block )
+  end
+  f:close()
+  local dt = tmr.getdiffnow( ST, start )
+  report( "sd.seq_write", math.floor( sd_size * 1000 / ( dt > 0 and dt or 1 ) ), "KB/s" )
+  f = io.open( fname, "rb" )
+  f:setvbuf( "full", #sd_block )
+  local size = 0
+  start = tmr.read( ST )
+  while true do
+    local d = f:read( #fs_block )
+    if not d then break end
+    size = size + #d
+  end
+  f:close()
+  dt = tmr.getdiffnow( ST, start )
+  report( "sd.seq_read", math.floor( size * 1000 / ( dt > 0 and dt or 1 ) ), "KB/s" )
+  os.remove( fname )
+end
+
+-- ****************************************************************************
+-- Entry point
+
+report( "info.platform", pd.platform(), "" )
+report( "info.board", pd.board(), "" )
+report( "info.scale", scale, "" )
+
+timeit( "vm.empty_loop", N, empty_loop )
+timeit( "vm.arith", N, vm_arith )
+timeit( "vm.call", N, vm_call )
+timeit( "vm.closure", N, vm_closure )
+timeit( "vm.concat", N, vm_concat )
+
+timeit( "table.array_write", N, tbl_array_write )
+timeit( "table.hash_read", N, tbl_hash_read )
+timeit( "table.rotable_read", N, tbl_rotable_read )
+timeit( "table.global_read", N, tbl_global_read )
+timeit( "table.fill_grow", N / 10, tbl_fill_grow )
+timeit( "table.fill_new", N / 10, tbl_fill_new )
+timeit( "table.fill_clear", N / 10, tbl_fill_clear )
+allocit( "table.fill_grow.alloc", 100, tbl_fill_grow )
+allocit( "table.fill_new.alloc", 100, tbl_fill_new )
+allocit( "table.fill_clear.alloc", 100, tbl_fill_clear )
+
+timeit( "string.intern_new", N, str_intern_new )
+timeit( "string.intern_existing", N, str_intern_existing )
+timeit( "string.format", N, str_format )
+
+if pack then
+  local vals = {}
+  for i = 1, 40 do vals[ i ] = i end
+  frame_data = pack.pack( frame_fmt, unpack( vals ) )
+  timeit( "pack.unpack_str", N / 10, pack_unpack_str )
+  timeit( "pack.unpack_compiled", N / 10, pack_unpack_compiled )
+  allocit( "pack.unpack_str.alloc", 100, pack_unpack_str )
+  allocit( "pack.unpack_compiled.alloc", 100, pack_unpack_compiled )
+end
+
+for _, m in ipairs( egc_modes ) do
+  gc_pause( m[ 1 ], m[ 2 ], m[ 3 ] )
+end
+elua.egc_setup( elua.EGC_NOT_ACTIVE )
+
+for _, fs in ipairs( fs_list ) do
+  local name, fname = fs[ 1 ], fs[ 2 ]
+  if fname:find( "%.tmp$" ) then
+    if fs_write( name, fname ) then
+      fs_read( name, fname )
+      os.remove( fname )
+    end
+  else
+    fs_read( name, fname )
+  end
+end
+sd_seq( "/mmc/sdseq.tmp" )
+
+collectgarbage( "collect" )
+report( "mem.used", collectgarbage( "count" ), "KB" )
+print( "BENCH\tdone" )
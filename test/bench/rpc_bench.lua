@@ -0,0 +1,76 @@
+-- LuaRPC round trip benchmark
+-- Runs on the host (rpc-lua) against a LuaRPC server, which can be an eLua
+-- board running rpc.server( uart_id ) or another rpc-lua instance running
+-- rpc.server( port ). Prints the results in the same format as bench.lua:
+--   BENCH <tab> name <tab> value <tab> unit
+-- Usage:
+--   lua rpc-lua.lua test/bench/rpc_bench.lua <port> [iterations]
+
+local port = arg[ 1 ]
+local n = tonumber( arg[ 2 ] ) or 200
+
+if not port then
+  print( "Usage: rpc_bench.lua <port> [iterations]" )
+  os.exit( 1 )
+end
+
+local slave, err = rpc.connect( port )
+if not slave then
+  print( "Unable to connect: " .. tostring( err ) )
+  os.exit( 1 )
+end
+
+local function report( name, value, unit )
+  print( string.format( "BENCH\t%s\t%s\t%s", name, tostring( value ), unit ) )
+end
+
+-- Wall clock time in seconds. os.clock() only counts the CPU time of this
+-- process, which doesn't include the time spent waiting for the replies.
+-- Use the host's "date" command if possible (popen might not be available).
+local function now()
+  local ok, f = pcall( io.popen, "date +%s.%N" )
+  if not ok or not f then return os.clock() end
+  local t = tonumber( f:read( "*l" ) )
+  f:close()
+  return t or os.clock()
+end
+
+-- Run 'f' n times and report the time per call in us
+local function timeit( name, f )
+  local start = now()
+  for i = 1, n do
+    f( i )
+  end
+  report( name, math.floor( ( now() - start ) * 1000000 / n ), "us/op" )
+end
+
+local function mirror( x ) return x end
+slave.mirror = mirror
+slave.bench = { a = { b = 5 } }
+
+local small = { 1, 2, 3, "four" }
+local big = {}
+for i = 1, 256 do big[ i ] = i end
+local str = string.rep( "0123456789abcdef", 64 )
+
+report( "rpc.iterations", n, "" )
+timeit( "rpc.call_number", function( i ) return slave.mirror( i ) end )
+timeit( "rpc.call_string_1k", function() return slave.mirror( str ) end )
+timeit( "rpc.call_table_small", function() return slave.mirror( small ) end )
+timeit( "rpc.call_table_256", function() return slave.mirror( big ) end )
+timeit( "rpc.call_builtin", function() return slave.string.len( "abc" ) end )
+timeit( "rpc.get_nested", function() return slave.bench.a:get() end )
+if rpc.wait then
+  -- Pipelined calls: issue all the requests, then wait for the replies
+  local start = now()
+  local futures = {}
+  for i = 1, n do
+    futures[ i ] = slave.mirror:async( i )
+  end
+  for i = 1, n do
+    rpc.wait( futures[ i ] )
+  end
+  report( "rpc.call_async", math.floor( ( now() - start ) * 1000000 / n ), "us/op" )
+end
+rpc.close( slave )
+print( "BENCH\tdone" )
@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# Run the eLua benchmark suite on the simulator and print the results
+# (tab separated: name, value, unit). The simulator must be built with the
+# benchmark configuration (no Lua VM profiler) and ROMFS image first (from
+# the eLua root directory):
+#
+#   lua build_elua.lua board=sim board_config_file=test/bench/sim_bench.lua romfs_dir=test/bench/romfs
+#   test/bench/run_sim_bench.sh [results_file] [baseline_file] [max_regression_%]
+#
+# The mmcfs and sd.* benchmarks run only if the simulator finds an SD card
+# image (sdcard.img, a FAT file system) in the current directory, for example:
+#
+#   mkfs.vfat -C sdcard.img 8192
+#
+# If a baseline file (the output of a previous run) is given, the results are
+# compared with it and the script exits with an error if any "ns/op" or "us"
+# result is slower than the baseline by more than max_regression_% (default 20).
+
+SIM=${SIM:-./elua_lua_sim.elf}
+RESULTS=${1:-bench_results.txt}
+BASELINE=$2
+MAXREG=${3:-20}
+
+if [ ! -x "$SIM" ]; then
+  echo "$SIM not found, build the simulator first" >&2
+  exit 1
+fi
+
+# The benchmarks run from /rom/autorun.lua, then the shell reads "exit" from
+# stdin. The timeout protects against a crashed/stuck simulator.
+echo "exit" | timeout ${TIMEOUT:-600} "$SIM" | tr -d '\r' | grep "^BENCH" | cut -f 2- > "$RESULTS"
+
+if ! grep -q "^done" "$RESULTS"; then
+  echo "Benchmark did not complete, partial results in $RESULTS" >&2
+  exit 1
+fi
+sed -i '/^done$/d' "$RESULTS"
+cat "$RESULTS"
+
+if [ -n "$BASELINE" ]; then
+  awk -F '\t' -v maxreg="$MAXREG" '
+    NR == FNR { base[ $1 ] = $2; next }
+    ( $3 == "ns/op" || $3 == "us" ) && ( $1 in base ) && base[ $1 ] > 0 {
+      pct = ( $2 - base[ $1 ] ) * 100 / base[ $1 ]
+      if( pct > maxreg ) {
+        printf( "REGRESSION\t%s\t%s -> %s %s (+%d%%)\n", $1, base[ $1 ], $2, $3, pct )
+        bad = 1
+      }
+    }
+    END { exit bad }
+  ' "$BASELINE" "$RESULTS" >&2 || exit 1
+fi
@@ -0,0 +1,7 @@
+-- eLua simulator configuration for the benchmark suite (test/bench)
+-- Same as the standard simulator, but without the Lua VM profiler, which
+-- adds a check to the execution of every VM instruction
+
+local t = dofile( "boards/known/sim.lua" )
+t.components.luaprof = nil
+return t
@@ -0,0 +1,37 @@
+-- Regression tests for the coroutine stack limits ( coroutine.create( f, maxstack ) )
+-- Run with the eLua interpreter (or any Lua built from src/lua), for example:
+--   lua test/test-costack.lua
+
+local function deep( n ) return 1 + deep( n + 1 ) end
+
+-- A stack overflow is a normal error in a limited coroutine
+for _, lim in ipairs{ 100, 200, 1000 } do
+  local co = coroutine.create( function() return pcall( deep, 1 ) end, lim )
+  local ok, st, msg = coroutine.resume( co )
+  assert( ok and not st and msg:find( "stack overflow" ), "pcall overflow, limit " .. lim )
+end
+
+-- A C error handler (debug.traceback) has enough stack to run
+for _, lim in ipairs{ 100, 200, 1000 } do
+  local co = coroutine.create( function()
+    return xpcall( function() return deep( 1 ) end, debug.traceback )
+  end, lim )
+  local ok, st, msg = coroutine.resume( co )
+  assert( ok and not st, "xpcall overflow, limit " .. lim )
+  assert( msg:find( "stack overflow" ) and msg:find( "stack traceback" ), "traceback, limit " .. lim )
+end
+
+-- An error handler that overflows again gives "error in error handling",
+-- and the coroutine keeps working within its limit afterwards
+local co = coroutine.create( function()
+  local st, msg = xpcall( function() return deep( 1 ) end, function() return deep( 1 ) end )
+  assert( not st and msg == "error in error handling", "overflow in the error handler" )
+  st, msg = pcall( deep, 1 )
+  assert( not st and msg:find( "stack overflow" ), "overflow after the handler" )
+  return "done"
+end, 100 )
+local ok, res = coroutine.resume( co )
+assert( ok and res == "done", res )
+assert( coroutine.stats( co ) <= 100, "stack not restored after the overflow" )
+
+print( "test-costack: OK" )
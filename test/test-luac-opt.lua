@@ -0,0 +1,39 @@
+-- Regression tests for the luac.cross bytecode optimizer (luac.cross -O)
+-- Compile this file with and without -O and run both versions, for example:
+--   luac.cross -O -o test-luac-opt.lc test/test-luac-opt.lua
+--   lua test-luac-opt.lc
+
+local a, b = 2, 1
+
+-- 'cmp and (k or true)' ends with a LOADBOOL that skips the next instruction,
+-- which is unreachable but must not be removed
+local function args( ... ) return select( '#', ... ), ... end
+local n, v = args( ( a < b ) and ( 3 or true ) )
+assert( n == 1 and v == false, "LOADBOOL skip in a call argument" )
+assert( tostring( ( a < b ) and ( 3 or true ) ) == "false", "LOADBOOL skip in a call" )
+n, v = args( ( a > b ) and ( 3 or true ) )
+assert( n == 1 and v == 3, "LOADBOOL skip in a call argument (true branch)" )
+
+local t = { ( a < b ) and ( 3 or true ), 7 }
+assert( #t == 2 and t[ 1 ] == false and t[ 2 ] == 7, "LOADBOOL skip in a table constructor" )
+t = { ( a > b ) and ( 3 or true ), 7 }
+assert( t[ 1 ] == 3 and t[ 2 ] == 7, "LOADBOOL skip in a table constructor (true branch)" )
+
+-- Jumps to jumps and jumps to the next instruction
+local s = 0
+for i = 1, 10 do
+  if i % 2 == 0 then
+    if i % 3 == 0 then s = s + i end
+  else
+    while false do s = s - 1 end
+  end
+end
+assert( s == 6, "threaded jumps" )
+
+-- Moves that swap values back
+local x, y = 1, 2
+x, y = y, x
+x, y = y, x
+assert( x == 1 and y == 2, "swapped moves" )
+
+print( "test-luac-opt: OK" )
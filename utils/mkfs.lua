@@ -143,6 +143,9 @@ function mkfs( dirname, outname, flist, mode, compcmd )
           for i = 1, #filedata do
             _add_data( filedata:byte( i ), outfile )
           end
+          -- Terminate the data with a zero byte (not included in the size) so that
+          -- the file contents can be used in place as a read-only Lua string
+          _add_data( 0, outfile )
           -- Report
           print( sf( "Encoded file %s (%d bytes real size, %d bytes encoded size)", fname, #filedata, _fcnt ) )
         end